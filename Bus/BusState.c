@@ -13,6 +13,13 @@ CSBusState csBus_defaultState(void)
 	CSBusState state;
 
 	state.lineValues = 0xffffffffffffffff;
+#if CSBusExtendedWords
+	for(int word = 0; word < CSBusExtendedWords; word++)
+		state.extendedLineValues[word] = 0xffffffffffffffff;
+#endif
+#if CSBusTracksHighImpedance
+	state.highImpedanceMask = 0xffffffffffffffff;
+#endif
 
 	return state;
 }
@@ -24,7 +31,7 @@ uint64_t csBusCondition_observedLines(CSBusCondition condition)
 
 CSBusCondition csBus_maskCondition(uint64_t observedLines, uint64_t lineMask, uint64_t lineValues, bool signalOnTrueOnly)
 {
-	CSBusCondition test;
+	CSBusCondition test = {0};
 
 	test.changedLines = observedLines;
 	test.lineMask = lineMask;
@@ -36,7 +43,7 @@ CSBusCondition csBus_maskCondition(uint64_t observedLines, uint64_t lineMask, ui
 
 CSBusCondition csBus_testCondition(uint64_t relevantLines, uint64_t lineValues, bool signalOnTrueOnly)
 {
-	CSBusCondition test;
+	CSBusCondition test = {0};
 
 	test.changedLines = 0;
 	test.lineMask = relevantLines;
@@ -48,7 +55,7 @@ CSBusCondition csBus_testCondition(uint64_t relevantLines, uint64_t lineValues,
 
 CSBusCondition csBus_setCondition(uint64_t relevantLines, bool signalOnTrueOnly)
 {
-	CSBusCondition test;
+	CSBusCondition test = {0};
 
 	test.changedLines = 0;
 	test.lineMask = relevantLines;
@@ -60,7 +67,7 @@ CSBusCondition csBus_setCondition(uint64_t relevantLines, bool signalOnTrueOnly)
 
 CSBusCondition csBus_resetCondition(uint64_t relevantLines, bool signalOnTrueOnly)
 {
-	CSBusCondition test;
+	CSBusCondition test = {0};
 
 	test.changedLines = 0;
 	test.lineMask = relevantLines;
@@ -72,7 +79,7 @@ CSBusCondition csBus_resetCondition(uint64_t relevantLines, bool signalOnTrueOnl
 
 CSBusCondition csBus_changeCondition(uint64_t relevantLines)
 {
-	CSBusCondition test;
+	CSBusCondition test = {0};
 
 	test.changedLines = relevantLines;
 	test.lineMask = 0;
@@ -84,7 +91,7 @@ CSBusCondition csBus_changeCondition(uint64_t relevantLines)
 
 CSBusCondition csBus_impossibleCondition(void)
 {
-	CSBusCondition test;
+	CSBusCondition test = {0};
 
 	test.changedLines = 0;
 	test.lineMask = 0;
@@ -100,8 +107,39 @@ bool csBusCondition_isImpossible(CSBusCondition condition)
 	//	(i)		no lines are observed for changes, and
 	//	(ii)	the mask condition requires some lines to be set but the mask doesn't
 	//			allow them to be
+#if CSBusExtendedWords
+	if(csBusCondition_observesExtendedLines(condition)) return false;
+#endif
+
 	return
 		!condition.changedLines &&
 		condition.lineValues &&
 		!(condition.lineMask & condition.lineValues);
 }
+
+#if CSBusExtendedWords
+
+CSBusCondition csBusCondition_extend(CSBusCondition condition, unsigned int word, uint64_t observedLines, uint64_t lineMask, uint64_t lineValues)
+{
+	if(word < CSBusExtendedWords)
+	{
+		condition.extendedChangedLines[word] = observedLines;
+		condition.extendedLineMask[word] = lineMask;
+		condition.extendedLineValues[word] = lineValues;
+	}
+
+	return condition;
+}
+
+bool csBusCondition_observesExtendedLines(CSBusCondition condition)
+{
+	for(int word = 0; word < CSBusExtendedWords; word++)
+	{
+		if(condition.extendedChangedLines[word] | condition.extendedLineMask[word])
+			return true;
+	}
+
+	return false;
+}
+
+#endif
@@ -11,6 +11,34 @@
 
 #include "stdint.h"
 #include "stdbool.h"
+#include "string.h"
+
+// the bus has 64 lines unless built otherwise; wider buses keep the first 64
+// exactly where they always were, in lineValues and so on, and put the rest
+// immediately after, so that the whole lot can be treated as a single run of
+// words wherever that's helpful
+#ifndef CSBusWidth
+#define CSBusWidth 64
+#endif
+
+#if CSBusWidth != 64 && CSBusWidth != 128 && CSBusWidth != 256
+#error CSBusWidth must be 64, 128 or 256
+#endif
+
+#define CSBusWords			(CSBusWidth >> 6)
+#define CSBusExtendedWords	(CSBusWords - 1)
+
+// define CSBusTracksHighImpedance as 1 to have bus states record which lines
+// are actually being driven, allowing the bus to spot any line that's driven
+// high by one component and low by another; it's on by default in debug
+// builds and otherwise costs nothing
+#ifndef CSBusTracksHighImpedance
+#ifdef DEBUG
+#define CSBusTracksHighImpedance 1
+#else
+#define CSBusTracksHighImpedance 0
+#endif
+#endif
 
 // this is the most basic description of bus state
 typedef struct
@@ -18,11 +46,18 @@ typedef struct
 	// current line values; open collector logic means
 	// that unused values should be left high
 	uint64_t lineValues;
+#if CSBusExtendedWords
+	uint64_t extendedLineValues[CSBusExtendedWords];
+#endif
 
+#if CSBusTracksHighImpedance
 	// a bitfield indicating which lines are 'inactive'
 	// in the sense that whoever sent this message isn't
-	// actively loading some value onto them
-//	uint64_t highImpedanceMask;
+	// actively loading some value onto them; a line that's
+	// low is always considered to be loaded, and only the
+	// first 64 lines are tracked
+	uint64_t highImpedanceMask;
+#endif
 
 } CSBusState;
 
@@ -40,8 +75,17 @@ CSBusState csBus_defaultState(void);
 typedef struct
 {
 	uint64_t changedLines;
+#if CSBusExtendedWords
+	uint64_t extendedChangedLines[CSBusExtendedWords];
+#endif
 	uint64_t lineMask;
+#if CSBusExtendedWords
+	uint64_t extendedLineMask[CSBusExtendedWords];
+#endif
 	uint64_t lineValues;
+#if CSBusExtendedWords
+	uint64_t extendedLineValues[CSBusExtendedWords];
+#endif
 
 	bool signalOnTrueOnly;
 
@@ -84,4 +128,145 @@ CSBusCondition csBus_changeCondition(uint64_t relevantLines);
 CSBusCondition csBus_impossibleCondition(void);
 bool csBusCondition_isImpossible(CSBusCondition condition);
 
+#if CSBusExtendedWords
+
+// the quick helpers above all leave the lines beyond the first 64 alone; this
+// adds a test of those in the given word of extendedLineMask and so on, with
+// words counting from 0 for lines 64 to 127
+CSBusCondition csBusCondition_extend(CSBusCondition condition, unsigned int word, uint64_t observedLines, uint64_t lineMask, uint64_t lineValues);
+bool csBusCondition_observesExtendedLines(CSBusCondition condition);
+
+#endif
+
+// operations across the full width of the bus, for the use of the bus itself.
+// With 64 lines these are just the obvious operations on lineValues; otherwise
+// each line value, mask and so on is treated as a single vector of CSBusWords
+// words, which the compiler will keep in SIMD registers where it can. Vectors
+// are only ever locals, so that nothing here depends on the vector calling
+// convention of the target
+#if CSBusExtendedWords
+
+typedef uint64_t CSBusVector __attribute__((vector_size(CSBusWidth >> 3)));
+
+#define csBus_loadVector(vector, words)		memcpy(&(vector), (words), sizeof(CSBusVector))
+#define csBus_storeVector(words, vector)	memcpy((words), &(vector), sizeof(CSBusVector))
+
+#define csBus_vectorIsZero(vector)	\
+	({\
+		uint64_t reduction = (vector)[0];\
+		for(int word = 1; word < CSBusWords; word++) reduction |= (vector)[word];\
+		!reduction;\
+	})
+
+#endif
+
+static inline void csBus_setAllLinesHigh(CSBusState *const state)
+{
+#if CSBusExtendedWords
+	memset(state, 0xff, sizeof(CSBusState));
+#else
+	state->lineValues = ~0llu;
+#if CSBusTracksHighImpedance
+	state->highImpedanceMask = ~0llu;
+#endif
+#endif
+}
+
+// components that actively drive lines high, rather than just leaving them
+// high, should say so via these if they're to be included in checks for
+// conflicts; they do nothing unless high impedance is being tracked
+#if CSBusTracksHighImpedance
+#define csBus_driveLines(state, lines)	((state)->highImpedanceMask &= ~(uint64_t)(lines))
+#define csBus_floatLines(state, lines)	((state)->highImpedanceMask |= (uint64_t)(lines))
+#else
+#define csBus_driveLines(state, lines)	((void)0)
+#define csBus_floatLines(state, lines)	((void)0)
+#endif
+
+// resolves target and source as though both were driving the bus, into target
+static inline void csBus_resolve(CSBusState *const target, const CSBusState *const source)
+{
+#if CSBusExtendedWords
+	CSBusVector targetVector, sourceVector;
+	csBus_loadVector(targetVector, &target->lineValues);
+	csBus_loadVector(sourceVector, &source->lineValues);
+	targetVector &= sourceVector;
+	csBus_storeVector(&target->lineValues, targetVector);
+#else
+	target->lineValues &= source->lineValues;
+#endif
+
+#if CSBusTracksHighImpedance
+	target->highImpedanceMask &= source->highImpedanceMask;
+#endif
+}
+
+#if CSBusTracksHighImpedance
+
+// the lines that are being driven high by source
+static inline uint64_t csBus_linesDrivenHigh(const CSBusState *const source)
+{
+	return source->lineValues & ~source->highImpedanceMask;
+}
+
+#endif
+
+static inline bool csBus_isEqual(const CSBusState *const a, const CSBusState *const b)
+{
+#if CSBusExtendedWords
+	CSBusVector aVector, bVector;
+	csBus_loadVector(aVector, &a->lineValues);
+	csBus_loadVector(bVector, &b->lineValues);
+	aVector ^= bVector;
+	return csBus_vectorIsZero(aVector);
+#else
+	return a->lineValues == b->lineValues;
+#endif
+}
+
+#if CSBusExtendedWords
+
+static inline void csBus_getChangedLines(CSBusState *const changedLines, const CSBusState *const a, const CSBusState *const b)
+{
+	CSBusVector aVector, bVector;
+	csBus_loadVector(aVector, &a->lineValues);
+	csBus_loadVector(bVector, &b->lineValues);
+	aVector ^= bVector;
+	csBus_storeVector(&changedLines->lineValues, aVector);
+}
+
+// is the condition's mask test satisfied by state?
+static inline bool csBusCondition_isTrue(const CSBusCondition *const condition, const CSBusState *const state)
+{
+	CSBusVector stateVector, lineMask, lineValues;
+	csBus_loadVector(stateVector, &state->lineValues);
+	csBus_loadVector(lineMask, &condition->lineMask);
+	csBus_loadVector(lineValues, &condition->lineValues);
+	stateVector = (stateVector & lineMask) ^ lineValues;
+	return csBus_vectorIsZero(stateVector);
+}
+
+// does the condition watch any of changedLines for changes?
+static inline bool csBusCondition_observesChanges(const CSBusCondition *const condition, const CSBusState *const changedLines)
+{
+	CSBusVector changes, observedChanges;
+	csBus_loadVector(changes, &changedLines->lineValues);
+	csBus_loadVector(observedChanges, &condition->changedLines);
+	changes &= observedChanges;
+	return !csBus_vectorIsZero(changes);
+}
+
+// does the condition observe any of changedLines at all?
+static inline bool csBusCondition_isAffectedBy(const CSBusCondition *const condition, const CSBusState *const changedLines)
+{
+	CSBusVector changes, observedChanges, lineMask;
+	csBus_loadVector(changes, &changedLines->lineValues);
+	csBus_loadVector(observedChanges, &condition->changedLines);
+	csBus_loadVector(lineMask, &condition->lineMask);
+	changes &= observedChanges | lineMask;
+	return !csBus_vectorIsZero(changes);
+}
+
+#endif
+
 #endif
@@ -15,7 +15,6 @@ static void csComponent_destroy(void *opaqueComponent)
 	CSBusComponent *component = (CSBusComponent *)opaqueComponent;
 
 	csObject_release(component->context);
-	csObject_release(component->preFilterContext);
 }
 
 void *csComponent_init(void *opaqueComponent, csComponent_handlerFunction function, CSBusCondition necessaryCondition, uint64_t outputLines, void *context)
@@ -32,15 +31,39 @@ void *csComponent_init(void *opaqueComponent, csComponent_handlerFunction functi
 		component->outputLines = outputLines;
 		component->context = csObject_retain(context);
 		component->currentInternalState = csBus_defaultState();
+
+		if(context)
+			component->referenceCountedObject.type = ((CSReferenceCountedObject *)context)->type;
 	}
 
 	return component;
 }
 
-void csComponent_setPreFilter(void *opaqueComponent, csComponent_prefilter filterFunction, void *context)
+void csComponent_setQuiescenceFunctions(void *opaqueComponent, csComponent_horizonFunction horizonFunction, csComponent_bulkAdvanceFunction bulkAdvanceFunction)
+{
+	CSBusComponent *component = (CSBusComponent *)opaqueComponent;
+
+	component->horizonFunction = horizonFunction;
+	component->bulkAdvanceFunction = bulkAdvanceFunction;
+}
+
+void csComponent_setSpecialisationFunction(void *opaqueComponent, csComponent_specialisationFunction specialisationFunction)
+{
+	CSBusComponent *component = (CSBusComponent *)opaqueComponent;
+
+	component->specialisationFunction = specialisationFunction;
+}
+
+void csComponent_setNeedsTimeSinceLaunch(void *opaqueComponent, bool needsTimeSinceLaunch)
+{
+	CSBusComponent *component = (CSBusComponent *)opaqueComponent;
+
+	component->needsTimeSinceLaunch = needsTimeSinceLaunch;
+}
+
+void csComponent_setType(void *opaqueComponent, const char *type)
 {
 	CSBusComponent *component = (CSBusComponent *)opaqueComponent;
 
-	component->preFilterContext = context;
-	component->preFilter = filterFunction;
+	component->referenceCountedObject.type = type;
 }
@@ -36,11 +36,71 @@ typedef void (* csComponent_handlerFunction)(
 												// timeSinceLaunch is a count of the number of nanoseconds since the bus started working.
 												// Components should generally track time by observing the clock line. However for those
 												// components that also have time-dependant characteristics (such as dynamic RAM), it can
-												// be helpful to be able to track real time rather than clock time
+												// be helpful to be able to track real time rather than clock time. It's worked out only
+												// if a component on the bus has declared that it needs it, and is 0 otherwise
 
-// context is not retained in the following; use with care
-void csComponent_setPreFilter(void *component, csComponent_prefilter filterFunction, void *context);
+// components can instead observe a small set of conditions with a single handler,
+// e.g. a memory's read and write conditions; see csFlatBus_createMultiConditionComponent.
+// Bit n of each of the masks refers to condition n, as supplied
+typedef void (* csComponent_multiConditionHandlerFunction)(
+	void *const restrict context,				// as for the standard form
+	CSBusState *const restrict internalState,
+	const CSBusState externalState,
+	const uint32_t trueConditions,				// the conditions that are now true
+	const uint32_t messagedConditions,			// the conditions that have prompted this message: each has just become true
+												// or false, or is true and has seen one of its changed lines change, just as
+												// would prompt a message to a component with that condition alone
+	const CSComponentNanoseconds timeSinceLaunch);
+
+// components that observe the clock can optionally help the bus skip over periods
+// in which nothing but the clock line changes. If every such component supplies
+// these then, whenever the bus has settled, each is asked for its horizon: the
+// number of half cycles, starting from the next, for which — given the external
+// state supplied, with only the clock line toggling — it would neither change its
+// internal state nor do anything other than count. The bus will then step over
+// the shortest such period in one go, asking each component to apply the effect
+// of that many half cycles via its bulk advance function
+typedef unsigned int (* csComponent_horizonFunction)(
+	void *const restrict context,				// as supplied to csComponent_create
+	const CSBusState internalState,				// the component's current internal bus state
+	const CSBusState externalState);			// the external state as it'll be for the next half cycle
+typedef void (* csComponent_bulkAdvanceFunction)(
+	void *const restrict context,
+	const CSBusState externalState,				// the external state as it is for the first of the half cycles
+	const unsigned int halfCycles);				// the number of half cycles to advance by; never more than the horizon
+
+void csComponent_setQuiescenceFunctions(void *component, csComponent_horizonFunction horizonFunction, csComponent_bulkAdvanceFunction bulkAdvanceFunction);
+
+// components can also offer versions of their handler specialised for the lines
+// that something on the bus is actually able to drive — e.g. so as not to sample
+// inputs that can never change. Before running, the bus supplies the union of
+// the output lines of everything attached to it whenever that has grown or a
+// component has been added since it last asked, and the component returns the
+// handler to use from then on. Components on a child bus aren't asked, and
+// keep the handler they were created with
+typedef csComponent_handlerFunction (* csComponent_specialisationFunction)(
+	void *const restrict context,				// as supplied to csComponent_create
+	const uint64_t drivenLines);				// every line that may be driven by something other than the bus itself
+
+void csComponent_setSpecialisationFunction(void *component, csComponent_specialisationFunction specialisationFunction);
+
+// components that use timeSinceLaunch should say so, before the bus next runs;
+// the bus otherwise doesn't go to the trouble of working it out
+void csComponent_setNeedsTimeSinceLaunch(void *component, bool needsTimeSinceLaunch);
+
+// components that have nothing to do for a while can be put to sleep, during which
+// the bus neither tests their conditions nor messages them — clocked components
+// included — though whatever they were last outputting continues to be output.
+// A component that's woken is next messaged when its condition changes, or when a
+// line it observes changes while that condition is true; it isn't told about
+// anything it missed. Either takes effect from the start of the next half cycle
+void csComponent_setAsleep(void *component, bool isAsleep);
+
+// components take the type of their context, if it has one, for the purposes of
+// profiling; this allows a more specific one to be given. The string isn't copied
+void csComponent_setType(void *component, const char *type);
 
 #define csComponent_observer(x)	static void x (void *const restrict context, CSBusState *const restrict internalState, const CSBusState externalState, const bool conditionIsTrue, const CSComponentNanoseconds timeSinceLaunch)
+#define csComponent_multiConditionObserver(x)	static void x (void *const restrict context, CSBusState *const restrict internalState, const CSBusState externalState, const uint32_t trueConditions, const uint32_t messagedConditions, const CSComponentNanoseconds timeSinceLaunch)
 
 #endif
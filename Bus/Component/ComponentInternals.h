@@ -13,6 +13,12 @@
 #include "BusState.h"
 #include "ReferenceCountedObject.h"
 
+// define CSFlatBusProfile as 1 to have the bus count what each component
+// costs it; see csFlatBus_printProfile
+#ifndef CSFlatBusProfile
+#define CSFlatBusProfile 0
+#endif
+
 typedef struct CSBusComponent
 {
 	// this is a reference counted object
@@ -28,11 +34,47 @@ typedef struct CSBusComponent
 	CSBusState currentInternalState;
 	uint64_t lastLineValues;
 	bool lastResult;
+
+	// the bus may file components by condition; this is the
+	// index of this component's condition within its bus
+	unsigned int conditionIndex;
 	
 	// optionally a filter can be applied, which will shuffle
-	// the bus state on the way into the component
-	csComponent_prefilter preFilter;
-	void *preFilterContext;
+	// the bus state on the way into the component; the filter
+	// is owned by the bus, and this is used by it only for
+	// components it doesn't otherwise file by filter
+	void *filter;
+
+	// optionally a component can describe its periods of
+	// inactivity, allowing the bus to skip them
+	csComponent_horizonFunction horizonFunction;
+	csComponent_bulkAdvanceFunction bulkAdvanceFunction;
+
+	// optionally a component can select a handler to suit the
+	// lines that are actually driven
+	csComponent_specialisationFunction specialisationFunction;
+
+	// the bus works out the time in nanoseconds only if
+	// some component says that it needs it
+	bool needsTimeSinceLaunch;
+
+	// the bus notes where it has filed the component, so that
+	// it can find it again to put it to sleep or wake it up;
+	// changes are applied by the bus between half cycles
+	void *bus, *set;
+	unsigned int indexInSet;
+	bool isAsleep, shouldBeAsleep, hasPendingSleepChange;
+
+#if CSFlatBusProfile
+	// how often the bus has tested this component's condition and
+	// found it true, and how often it has called the handler; one
+	// call in every so many is timed
+	struct
+	{
+		uint64_t conditionEvaluations, conditionHits;
+		uint64_t handlerCalls, sampledHandlerCalls, sampledHandlerTicks;
+	} profile;
+#endif
 
 } CSBusComponent;
 
@@ -8,282 +8,3015 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "ReferenceCountedObject.h"
 
 #include "BusState.h"
 #include "StandardBusLines.h"
 
-#include "RateConverter.h"
-#include "AllocatingArray.h"
+#include "PoolAllocator.h"
 
 #include "FlatBus.h"
 #include "ComponentInternals.h"
 
+#if CSFlatBusProfile
+#include <time.h>
+#endif
+
+#include <unistd.h>
+
 #ifdef __BLOCKS__
 #include <dispatch/dispatch.h>
+#else
+#include <pthread.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+struct CSFlatBusComponentSet
+{
+	// components are handed out to their owners, so they're allocated from a
+	// pool in which they'll never move; the pool also keeps a contiguous list
+	// of them, which is what's iterated over
+	void *components;
+	CSBusState state;
+	CSBusState lastExternalState;
+	uint64_t allObservedSetLines, allObservedResetLines, allObservedChangeLines;
+
+	// the number of awake components that observe each line in each of the
+	// ways above, which allows the summaries to follow components as they
+	// sleep and wake
+	unsigned int observedSetLineCounts[64], observedResetLineCounts[64], observedChangeLineCounts[64];
+
+	// sets that aren't dispatched by condition, such as the clocked set, are
+	// run in full; so they keep a list of just the components that are awake,
+	// in the same order as the pool, and the combined output of the others
+	bool isDispatchedByCondition;
+	CSBusComponent **awakeComponents;
+	unsigned int numberOfAwakeComponents;
+	CSBusState sleepingState;
+
+	// the conditions of all components, mirrored into separate arrays so that
+	// they can be tested in bulk, and the result of each when last tested;
+	// the arrays are padded to a multiple of 64 entries with the impossible
+	// condition and componentLastResults is a bitfield, which mirrors each
+	// component's own lastResult when the set is tested in bulk
+	uint64_t *componentLineMasks, *componentLineValues, *componentChangedLines;
+	uint64_t *componentLastResults;
+	unsigned int componentWords;
+
+	// small sets are just scanned in full whenever they might need to be
+	// messaged; that's cheaper than consulting an index until there are
+	// more than a handful of components
+	bool isIndexed;
+
+	// the index: each distinct condition in use by this set is
+	// stored exactly once in conditions, so that it's evaluated exactly once;
+	// lineSubscribers then holds, for each group of eight lines and each
+	// possible pattern of changes within that group, a bitfield of the conditions
+	// that observe any of the changed lines; conditionSubscribers holds, for
+	// each condition, a bitfield of the components that use it
+	CSBusCondition *conditions;
+	unsigned int numberOfConditions;
+	unsigned int conditionWords;
+	uint64_t allObservedLines;
+	uint64_t *lineSubscribers;
+	uint64_t *conditionSubscribers;
+
+	// the result of each condition when last evaluated, and the conditions
+	// that have acquired a new component since the last dispatch
+	uint64_t *conditionLastResults;
+	uint64_t *pendingConditions;
+	bool hasPendingConditions;
+
+#if CSFlatBusProfile
+	// how often the set was run, and how often it was skipped
+	// because none of the lines it observes had changed
+	uint64_t profileRuns, profileSkips;
+#endif
+};
+
+// a filter presents components with an altered view of the bus; components
+// with conditions that observe any of the lines it may alter are kept in
+// sets of its own, so that their conditions are tested against what they'll
+// actually see. Others are filed as normal and see the filter's output only
+// when messaged
+struct CSFlatBusFilter
+{
+	csComponent_prefilter function;
+	void *context;
+	uint64_t alteredLines;
+
+	// the filter is evaluated only if its input has changed since last time,
+	// or if it has been invalidated
+	CSBusState input, output;
+	bool needsEvaluation;
+
+	// the filtered state as last dispatched to the components
+	CSBusState lastExternalState;
+	uint64_t allObservedLines;
+	struct CSFlatBusComponentSet trueFalseComponents, trueComponents;
+};
+
+// a clock domain is a clock derived from the bus's own at a fixed ratio; the
+// intervals, in bus half cycles, between its edges repeat and are worked out
+// when it's created, so that running it is just a matter of counting down
+struct CSFlatBusClockDomain
+{
+	const char *name;
+	struct CSFlatBusComponentSet clockedComponents;
+
+	unsigned int *edgeIntervals;
+	unsigned int numberOfEdgeIntervals, nextEdgeInterval;
+	unsigned int halfCyclesToEdge;
+	bool clockLevel;
+};
+
+// a passive observer collects history records into one buffer while the
+// other is being processed; asynchronous processing happens on a serial queue
+// of the observer's own where blocks are available, and otherwise on a thread
+// of its own
+struct CSFlatBusPassiveObserver
+{
+	CSBusCondition condition;
+	csFlatBus_historyHandler handler;
+	void *context;
+
+	CSFlatBusHistoryRecord *records, *spareRecords;
+	unsigned int numberOfRecords, capacity;
+
+	bool isAsynchronous;
+#ifdef __BLOCKS__
+	dispatch_queue_t queue;
+#else
+	// the thread owns pendingRecords from when they're handed over until it
+	// sets them back to NULL; the bus and the thread never wait at the same
+	// time, so a single condition variable serves both
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t handover;
+	CSFlatBusHistoryRecord *pendingRecords;
+	unsigned int numberOfPendingRecords;
+	bool isFinishing;
+#endif
+};
+
+typedef struct
+{
+	CSReferenceCountedObject referenceCountedObject;
+
+	struct CSFlatBusComponentSet clockedComponents, trueFalseComponents, trueComponents;
+	bool isFrozen;
+
+	CSBusState currentBusState;
+	uint64_t halfCyclesToDate;
+	uint32_t ticksPerSecond;
+	unsigned int bulkAdvanceBackoff, bulkAdvanceCountdown;
+
+	// the time in nanoseconds is worked out only if some component needs it
+	bool needsTimeSinceLaunch;
+
+	// pending events, as a binary heap ordered by time and then by the
+	// order in which they were scheduled; nextEventTime is the time of the
+	// first, or as far into the future as possible if there are none
+	struct CSFlatBusEvent
+	{
+		uint64_t time;
+		unsigned int sequenceNumber;
+		csFlatBus_eventHandler handler;
+		void *context;
+	} *events;
+	unsigned int numberOfEvents, allocatedEvents;
+	unsigned int nextEventSequenceNumber;
+	uint64_t nextEventTime;
+
+	// all filters, and the one currently applied to new components, if any;
+	// filteredState is the combined output of those components that are filed
+	// by filter, if there are any
+	struct CSFlatBusFilter **filters;
+	unsigned int numberOfFilters;
+	bool hasFilteredSets;
+	struct CSFlatBusFilter *modalFilter;
+	CSBusState filteredState;
+
+	// all clock domains, and the one currently applied to new clocked components,
+	// if any; clockDomainState is the combined output of their components, which
+	// is resolved into that of the clocked set
+	struct CSFlatBusClockDomain **clockDomains;
+	unsigned int numberOfClockDomains;
+	struct CSFlatBusClockDomain *modalClockDomain;
+	CSBusState clockDomainState;
+
+#if CSBusExtendedWords
+	// components that observe any of the lines beyond the first 64 are kept apart
+	// from all the others, and tested across the full width of the bus
+	struct CSFlatBusComponentSet wideComponents;
+#endif
+
+	// the union of the output lines of everything attached, and whether
+	// components need to be asked to specialise before the next run
+	uint64_t drivenLines;
+	bool needsSpecialisation;
+
+	// components that have been put to sleep or woken since the last half cycle
+	CSBusComponent **pendingSleepChanges;
+	unsigned int numberOfPendingSleepChanges, allocatedPendingSleepChanges;
+
+	// passive observers, and the bus state as they last saw it
+	struct CSFlatBusPassiveObserver **passiveObservers;
+	unsigned int numberOfPassiveObservers;
+	CSBusState passiveObserverLastState;
+
+#if CSBusTracksHighImpedance
+	// runs of half cycles in which components were found to be driving the
+	// same lines to different levels, and the total number of such half
+	// cycles, including any beyond the runs that could be kept
+	struct CSFlatBusConflict
+	{
+		uint64_t firstHalfCycle, numberOfHalfCycles;
+		uint64_t lines;
+		const CSBusComponent *componentDrivingHigh, *componentDrivingLow;
+	} *conflicts;
+	unsigned int numberOfConflicts;
+	uint64_t conflictingHalfCycles;
+#endif
+} CSFlatBus;
+
+// sets with fewer components than this are just scanned in full
+#ifndef kCSFlatBusMinimumComponentsForIndex
+#define kCSFlatBusMinimumComponentsForIndex	32
+#endif
+
+// ... and, where SIMD is available, those with at least this many have their
+// conditions tested in bulk rather than one by one
+#ifndef kCSFlatBusMinimumComponentsForBulkEvaluation
+#define kCSFlatBusMinimumComponentsForBulkEvaluation	16
+#endif
+
+// after the components decline to be bulk advanced, the bus waits for up to
+// this many half cycles before asking again
+#ifndef kCSFlatBusMaximumBulkAdvanceBackoff
+#define kCSFlatBusMaximumBulkAdvanceBackoff	3
+#endif
+
+#if kCSFlatBusMinimumComponentsForIndex > 64
+#error Sets of more than 64 components must be indexed
+#endif
+
+#define csFlatBus_setBit(field, index)	(field)[(index) >> 6] |= (1llu << ((index)&63))
+#define csFlatBus_clearBit(field, index)	(field)[(index) >> 6] &= ~(1llu << ((index)&63))
+#define csFlatBus_testBit(field, index)	((field)[(index) >> 6] & (1llu << ((index)&63)))
+
+// re-lays out a table of bitfields, each row of which has grown from oldWords to newWords
+static uint64_t *csFlatBus_widenTable(uint64_t *table, unsigned int numberOfRows, unsigned int oldWords, unsigned int newWords)
+{
+	uint64_t *newTable = (uint64_t *)calloc(numberOfRows * newWords, sizeof(uint64_t));
+
+	if(newTable && table)
+	{
+		for(unsigned int row = 0; row < numberOfRows; row++)
+			memcpy(&newTable[row * newWords], &table[row * oldWords], oldWords * sizeof(uint64_t));
+	}
+
+	free(table);
+	return newTable;
+}
+
+static unsigned int csFlatBus_indexOfCondition(struct CSFlatBusComponentSet *set, CSBusCondition condition, bool lastResult)
+{
+	// is this a condition we've seen before? If so then it can be shared, provided
+	// the components attached to it all have the same idea of its last result
+	for(unsigned int index = 0; index < set->numberOfConditions; index++)
+	{
+		if(
+			!csFlatBus_testBit(set->conditionLastResults, index) == !lastResult &&
+			set->conditions[index].lineMask == condition.lineMask &&
+			set->conditions[index].lineValues == condition.lineValues &&
+			set->conditions[index].changedLines == condition.changedLines)
+			return index;
+	}
+
+	// if not then we'll need to add it, making room for another bit in
+	// the per-line bitfields if necessary
+	if(set->numberOfConditions == set->conditionWords << 6)
+	{
+		unsigned int newConditionWords = set->conditionWords + 1;
+
+		set->lineSubscribers = csFlatBus_widenTable(set->lineSubscribers, 8*256, set->conditionWords, newConditionWords);
+		set->conditionLastResults = csFlatBus_widenTable(set->conditionLastResults, 1, set->conditionWords, newConditionWords);
+		set->pendingConditions = csFlatBus_widenTable(set->pendingConditions, 1, set->conditionWords, newConditionWords);
+		set->conditions = (CSBusCondition *)realloc(set->conditions, sizeof(CSBusCondition) * (newConditionWords << 6));
+
+		// the per-condition table just gains more rows
+		set->conditionSubscribers = (uint64_t *)realloc(set->conditionSubscribers, sizeof(uint64_t) * (newConditionWords << 6) * set->componentWords);
+		memset(&set->conditionSubscribers[(set->conditionWords << 6) * set->componentWords], 0, sizeof(uint64_t) * 64 * set->componentWords);
+
+		set->conditionWords = newConditionWords;
+	}
+
+	unsigned int index = set->numberOfConditions;
+	set->numberOfConditions++;
+	set->conditions[index] = condition;
+	if(lastResult) csFlatBus_setBit(set->conditionLastResults, index);
+
+	uint64_t observedLines = csBusCondition_observedLines(condition);
+	set->allObservedLines |= observedLines;
+	for(unsigned int group = 0; group < 8; group++)
+	{
+		uint8_t observedLinesInGroup = (uint8_t)(observedLines >> (group << 3));
+		if(!observedLinesInGroup) continue;
+
+		for(unsigned int changes = 1; changes < 256; changes++)
+		{
+			if(changes & observedLinesInGroup)
+				csFlatBus_setBit(&set->lineSubscribers[((group << 8) | changes) * set->conditionWords], index);
+		}
+	}
+
+	return index;
+}
+
+static void csFlatBus_indexComponent(struct CSFlatBusComponentSet *set, CSBusComponent *component, unsigned int componentIndex)
+{
+	// file the component under its condition, and make sure that condition is
+	// evaluated at the next opportunity in case the component is yet to get
+	// its first message
+	component->conditionIndex = csFlatBus_indexOfCondition(set, component->condition, component->lastResult);
+	csFlatBus_setBit(&set->conditionSubscribers[component->conditionIndex * set->componentWords], componentIndex);
+	csFlatBus_setBit(set->pendingConditions, component->conditionIndex);
+	set->hasPendingConditions = true;
+}
+
+// extends an array of per-component values by another 64 entries, each set to value
+static uint64_t *csFlatBus_extendArray(uint64_t *array, unsigned int oldLength, uint64_t value)
+{
+	array = (uint64_t *)realloc(array, sizeof(uint64_t) * (oldLength + 64));
+	for(unsigned int index = oldLength; index < oldLength + 64; index++)
+		array[index] = value;
+	return array;
+}
+
+// adds delta to the count of each line, updating the summary to match
+static void csFlatBus_countLines(unsigned int *const counts, uint64_t *const summary, uint64_t lines, const int delta)
+{
+	while(lines)
+	{
+		const unsigned int line = (unsigned int)__builtin_ctzll(lines);
+		lines &= lines - 1;
+
+		counts[line] += (unsigned int)delta;
+		if(counts[line])
+			*summary |= 1llu << line;
+		else
+			*summary &= ~(1llu << line);
+	}
+}
+
+// adds to or removes from the set's summaries the lines observed by condition
+static void csFlatBus_countObservedLines(struct CSFlatBusComponentSet *set, const CSBusCondition condition, const int delta)
+{
+	uint64_t setLineMask = condition.lineMask & condition.lineValues;
+	uint64_t resetLineMask = condition.lineMask & ~condition.lineValues;
+	uint64_t changeLineMask = condition.changedLines &~ (setLineMask | resetLineMask);
+
+	csFlatBus_countLines(set->observedSetLineCounts, &set->allObservedSetLines, setLineMask, delta);
+	csFlatBus_countLines(set->observedResetLineCounts, &set->allObservedResetLines, resetLineMask, delta);
+	csFlatBus_countLines(set->observedChangeLineCounts, &set->allObservedChangeLines, changeLineMask, delta);
+}
+
+static void csFlatBus_updateSetForNewComponent(struct CSFlatBusComponentSet *set, CSBusComponent *component, bool isDispatchedByCondition)
+{
+	unsigned int numberOfComponents;
+	CSBusComponent *const *const components = (CSBusComponent **)csPoolAllocator_getObjects(set->components, &numberOfComponents);
+	unsigned int componentIndex = numberOfComponents - 1;
+
+	component->set = set;
+	component->indexInSet = componentIndex;
+	set->isDispatchedByCondition = isDispatchedByCondition;
+
+	// update the summaries
+	uint64_t changedLines = component->condition.changedLines;
+	uint64_t lineMask = component->condition.lineMask;
+	uint64_t lineValues = component->condition.lineValues;
+	csFlatBus_countObservedLines(set, component->condition, 1);
+
+	// sets that aren't dispatched by condition, such as the clocked set, need
+	// only to add the component to those that are run
+	if(!isDispatchedByCondition)
+	{
+		CSBusComponent **const awakeComponents = (CSBusComponent **)realloc(set->awakeComponents, sizeof(CSBusComponent *) * numberOfComponents);
+		if(awakeComponents)
+		{
+			set->awakeComponents = awakeComponents;
+			set->awakeComponents[set->numberOfAwakeComponents++] = component;
+		}
+		return;
+	}
+
+	// make sure there's room for this component in the per-component arrays;
+	// padding is the impossible condition — no lines masked, yet expecting one
+	if(componentIndex == set->componentWords << 6)
+	{
+		unsigned int oldLength = set->componentWords << 6;
+		set->componentLineMasks = csFlatBus_extendArray(set->componentLineMasks, oldLength, 0);
+		set->componentLineValues = csFlatBus_extendArray(set->componentLineValues, oldLength, 1);
+		set->componentChangedLines = csFlatBus_extendArray(set->componentChangedLines, oldLength, 0);
+		set->componentLastResults = csFlatBus_widenTable(set->componentLastResults, 1, set->componentWords, set->componentWords + 1);
+		set->conditionSubscribers = csFlatBus_widenTable(set->conditionSubscribers, set->conditionWords << 6, set->componentWords, set->componentWords + 1);
+		set->componentWords++;
+	}
+
+	set->componentLineMasks[componentIndex] = lineMask;
+	set->componentLineValues[componentIndex] = lineValues;
+	set->componentChangedLines[componentIndex] = changedLines;
+
+	// components that are tested one by one keep their own last result, so
+	// make sure the bitfield used when testing in bulk is up to date
+	memset(set->componentLastResults, 0, sizeof(uint64_t) * set->componentWords);
+	for(unsigned int index = 0; index < numberOfComponents; index++)
+	{
+		if(components[index]->lastResult) csFlatBus_setBit(set->componentLastResults, index);
+	}
+
+	// update the index, creating it if this set has just become large enough to need one
+	if(set->isIndexed)
+	{
+		csFlatBus_indexComponent(set, component, componentIndex);
+	}
+	else if(numberOfComponents >= kCSFlatBusMinimumComponentsForIndex)
+	{
+		set->isIndexed = true;
+		for(componentIndex = 0; componentIndex < numberOfComponents; componentIndex++)
+			csFlatBus_indexComponent(set, components[componentIndex], componentIndex);
+	}
+}
+
+static void csFlatBus_initialiseSet(struct CSFlatBusComponentSet *set)
+{
+	set->components = csPoolAllocator_createWithObjectSize(sizeof(CSBusComponent), true);
+	set->state = csBus_defaultState();
+	set->lastExternalState = csBus_defaultState();
+	set->sleepingState = csBus_defaultState();
+}
+
+static void csFlatBus_destroySet(struct CSFlatBusComponentSet *set)
+{
+	csObject_release(set->components);
+
+	free(set->conditions);
+	free(set->lineSubscribers);
+	free(set->conditionSubscribers);
+	free(set->conditionLastResults);
+	free(set->pendingConditions);
+
+	free(set->componentLineMasks);
+	free(set->componentLineValues);
+	free(set->componentChangedLines);
+	free(set->componentLastResults);
+
+	free(set->awakeComponents);
+}
+
+void *csFlatBus_createFilter(
+	void *opaqueBus,
+	csComponent_prefilter filterFunction,
+	uint64_t alteredLines,
+	void *context)
+{
+	CSFlatBus *flatBus = (CSFlatBus *)opaqueBus;
+
+	struct CSFlatBusFilter **newFilters = (struct CSFlatBusFilter **)realloc(flatBus->filters, sizeof(struct CSFlatBusFilter *) * (flatBus->numberOfFilters + 1));
+	if(!newFilters) return NULL;
+	flatBus->filters = newFilters;
+
+	struct CSFlatBusFilter *filter = (struct CSFlatBusFilter *)calloc(1, sizeof(struct CSFlatBusFilter));
+	if(!filter) return NULL;
+	flatBus->filters[flatBus->numberOfFilters] = filter;
+	flatBus->numberOfFilters++;
+
+	filter->function = filterFunction;
+	filter->context = context;
+	filter->alteredLines = alteredLines;
+	filter->needsEvaluation = true;
+	filter->lastExternalState = csBus_defaultState();
+	csFlatBus_initialiseSet(&filter->trueComponents);
+	csFlatBus_initialiseSet(&filter->trueFalseComponents);
+
+	return filter;
+}
+
+void csFlatBus_invalidateFilter(void *opaqueFilter)
+{
+	((struct CSFlatBusFilter *)opaqueFilter)->needsEvaluation = true;
+}
+
+void csFlatBus_setModalComponentFilter(
+	void *opaqueBus,
+	void *filter)
+{
+	CSFlatBus *flatBus = (CSFlatBus *)opaqueBus;
+	flatBus->modalFilter = (struct CSFlatBusFilter *)filter;
+}
+
+// domains longer than this before their edges repeat aren't supported
+#define kCSFlatBusMaximumClockDomainEdgeIntervals	65536
+
+static unsigned int csFlatBus_greatestCommonDivisor(unsigned int a, unsigned int b)
+{
+	while(b)
+	{
+		unsigned int remainder = a % b;
+		a = b;
+		b = remainder;
+	}
+	return a;
+}
+
+void *csFlatBus_createClockDomain(
+	void *opaqueBus,
+	const char *name,
+	unsigned int numerator,
+	unsigned int denominator)
+{
+	CSFlatBus *flatBus = (CSFlatBus *)opaqueBus;
+
+	// the domain's clock can't be faster than the bus's, and its edges
+	// need to repeat within a reasonable span
+	if(!numerator || numerator > denominator) return NULL;
+	const unsigned int divisor = csFlatBus_greatestCommonDivisor(numerator, denominator);
+	numerator /= divisor;
+	denominator /= divisor;
+	if(numerator > kCSFlatBusMaximumClockDomainEdgeIntervals) return NULL;
+
+	struct CSFlatBusClockDomain **newClockDomains = (struct CSFlatBusClockDomain **)realloc(flatBus->clockDomains, sizeof(struct CSFlatBusClockDomain *) * (flatBus->numberOfClockDomains + 1));
+	if(!newClockDomains) return NULL;
+	flatBus->clockDomains = newClockDomains;
+
+	struct CSFlatBusClockDomain *clockDomain = (struct CSFlatBusClockDomain *)calloc(1, sizeof(struct CSFlatBusClockDomain));
+	if(!clockDomain) return NULL;
+
+	clockDomain->edgeIntervals = (unsigned int *)malloc(sizeof(unsigned int) * numerator);
+	if(!clockDomain->edgeIntervals)
+	{
+		free(clockDomain);
+		return NULL;
+	}
+
+	// edge n of the domain occurs at the end of bus half cycle floor(n * denominator / numerator),
+	// so numerator edges occur every denominator half cycles, and no two in the same one
+	unsigned int lastEdge = 0;
+	for(unsigned int edge = 1; edge <= numerator; edge++)
+	{
+		const unsigned int nextEdge = (unsigned int)(((uint64_t)edge * denominator) / numerator);
+		clockDomain->edgeIntervals[edge - 1] = nextEdge - lastEdge;
+		lastEdge = nextEdge;
+	}
+
+	clockDomain->name = name;
+	clockDomain->numberOfEdgeIntervals = numerator;
+	clockDomain->nextEdgeInterval = 1 % numerator;
+	clockDomain->halfCyclesToEdge = clockDomain->edgeIntervals[0];
+	clockDomain->clockLevel = true;
+	csFlatBus_initialiseSet(&clockDomain->clockedComponents);
+
+	flatBus->clockDomains[flatBus->numberOfClockDomains] = clockDomain;
+	flatBus->numberOfClockDomains++;
+
+	return clockDomain;
+}
+
+void csFlatBus_setModalClockDomain(
+	void *opaqueBus,
+	void *clockDomain)
+{
+	CSFlatBus *flatBus = (CSFlatBus *)opaqueBus;
+	flatBus->modalClockDomain = (struct CSFlatBusClockDomain *)clockDomain;
+}
+
+// returns the filter's output for the given input, evaluating it only if necessary
+static inline CSBusState csFlatBus_applyFilter(struct CSFlatBusFilter *const filter, const CSBusState input)
+{
+	if(filter->needsEvaluation || !csBus_isEqual(&filter->input, &input))
+	{
+		filter->input = input;
+		filter->output = filter->function(filter->context, input);
+		filter->needsEvaluation = false;
+	}
+
+	return filter->output;
+}
+
+void *csFlatBus_createComponent(
+	void *opaqueBus,
+	csComponent_handlerFunction function,
+	CSBusCondition necessaryCondition,
+	uint64_t outputLines,
+	void *context)
+
+{
+	CSFlatBus *flatBus = (CSFlatBus *)opaqueBus;
+	CSBusComponent *component;
+	struct CSFlatBusComponentSet *set;
+	struct CSFlatBusFilter *const filter = flatBus->modalFilter;
+
+	// a frozen bus can't acquire new components
+	if(flatBus->isFrozen) return NULL;
+
+	// components that view the bus through a filter need to have their conditions
+	// tested against its output only if they observe lines that it may alter
+	const bool isFilteredBeforeTesting = filter && (csBusCondition_observedLines(necessaryCondition) & filter->alteredLines);
+
+	// add the new component to the clocked set if it observes the clock line —
+	// being the modal clock domain's if there is one — or the unclocked set
+	// otherwise, being the filter's own if necessary. Only the unclocked sets
+	// are dispatched by condition
+	bool isDispatchedByCondition = false;
+#if CSBusExtendedWords
+	if(csBusCondition_observesExtendedLines(necessaryCondition))
+	{
+		set = &flatBus->wideComponents;
+	}
+	else
 #endif
+	if(csBusCondition_observedLines(necessaryCondition) == CSBusStandardClockLine)
+	{
+		set = flatBus->modalClockDomain ? &flatBus->modalClockDomain->clockedComponents : &flatBus->clockedComponents;
+	}
+	else
+	{
+		if(necessaryCondition.signalOnTrueOnly)
+			set = isFilteredBeforeTesting ? &filter->trueComponents : &flatBus->trueComponents;
+		else
+			set = isFilteredBeforeTesting ? &filter->trueFalseComponents : &flatBus->trueFalseComponents;
+		isDispatchedByCondition = true;
+	}
+
+	component = csPoolAllocator_newObject(set->components);
+	csComponent_init(component, function, necessaryCondition, outputLines, context);
+	component->bus = flatBus;
+	csFlatBus_updateSetForNewComponent(set, component, isDispatchedByCondition);
+
+	flatBus->drivenLines |= outputLines;
+	flatBus->needsSpecialisation = true;
+
+	if(filter)
+	{
+		if(set == &filter->trueComponents || set == &filter->trueFalseComponents)
+		{
+			filter->allObservedLines |= csBusCondition_observedLines(necessaryCondition);
+			flatBus->hasFilteredSets = true;
+		}
+		else
+			component->filter = filter;
+	}
+
+	return component;
+}
+
+// this is declared with the rest of the component's interface, but it's for the
+// bus to work out what going to sleep or waking up means; it does so between half
+// cycles, so that nothing changes underneath it while components are being messaged
+void csComponent_setAsleep(void *opaqueComponent, bool isAsleep)
+{
+	CSBusComponent *const component = (CSBusComponent *)opaqueComponent;
+	CSFlatBus *const flatBus = (CSFlatBus *)component->bus;
+
+	component->shouldBeAsleep = isAsleep;
+	if(component->hasPendingSleepChange || component->isAsleep == isAsleep) return;
+
+	if(flatBus->numberOfPendingSleepChanges == flatBus->allocatedPendingSleepChanges)
+	{
+		const unsigned int allocatedPendingSleepChanges = flatBus->allocatedPendingSleepChanges ? flatBus->allocatedPendingSleepChanges << 1 : 8;
+		CSBusComponent **const pendingSleepChanges = (CSBusComponent **)realloc(flatBus->pendingSleepChanges, sizeof(CSBusComponent *) * allocatedPendingSleepChanges);
+		if(!pendingSleepChanges) return;
+
+		flatBus->pendingSleepChanges = pendingSleepChanges;
+		flatBus->allocatedPendingSleepChanges = allocatedPendingSleepChanges;
+	}
+
+	flatBus->pendingSleepChanges[flatBus->numberOfPendingSleepChanges++] = component;
+	component->hasPendingSleepChange = true;
+}
+
+uint64_t csFlatBus_getDrivenLines(void *opaqueBus)
+{
+	return ((CSFlatBus *)opaqueBus)->drivenLines;
+}
+
+void csFlatBus_addEventOutputLines(void *opaqueBus, uint64_t outputLines)
+{
+	CSFlatBus *const flatBus = (CSFlatBus *)opaqueBus;
+
+	if(outputLines &~ flatBus->drivenLines)
+	{
+		flatBus->drivenLines |= outputLines;
+		flatBus->needsSpecialisation = true;
+	}
+}
+
+static void csFlatBus_specialiseSet(struct CSFlatBusComponentSet *const set, const uint64_t drivenLines)
+{
+	unsigned int numberOfComponents;
+	CSBusComponent *const *const components = (CSBusComponent **)csPoolAllocator_getObjects(set->components, &numberOfComponents);
+
+	for(unsigned int componentIndex = 0; componentIndex < numberOfComponents; componentIndex++)
+	{
+		if(components[componentIndex]->specialisationFunction)
+			components[componentIndex]->handlerFunction = components[componentIndex]->specialisationFunction(components[componentIndex]->context, drivenLines);
+	}
+}
+
+static bool csFlatBus_needsTimeSinceLaunch(CSFlatBus *const flatBus);
+
+// offers every component that wants it the chance to pick a handler suited to
+// the lines that are currently driven, and checks whether any now needs the time
+static void csFlatBus_specialise(CSFlatBus *const flatBus)
+{
+	csFlatBus_specialiseSet(&flatBus->clockedComponents, flatBus->drivenLines);
+	csFlatBus_specialiseSet(&flatBus->trueComponents, flatBus->drivenLines);
+	csFlatBus_specialiseSet(&flatBus->trueFalseComponents, flatBus->drivenLines);
+#if CSBusExtendedWords
+	csFlatBus_specialiseSet(&flatBus->wideComponents, flatBus->drivenLines);
+#endif
+
+	for(unsigned int filterIndex = 0; filterIndex < flatBus->numberOfFilters; filterIndex++)
+	{
+		csFlatBus_specialiseSet(&flatBus->filters[filterIndex]->trueComponents, flatBus->drivenLines);
+		csFlatBus_specialiseSet(&flatBus->filters[filterIndex]->trueFalseComponents, flatBus->drivenLines);
+	}
+
+	for(unsigned int clockDomainIndex = 0; clockDomainIndex < flatBus->numberOfClockDomains; clockDomainIndex++)
+		csFlatBus_specialiseSet(&flatBus->clockDomains[clockDomainIndex]->clockedComponents, flatBus->drivenLines);
+
+	flatBus->needsTimeSinceLaunch = csFlatBus_needsTimeSinceLaunch(flatBus);
+	flatBus->needsSpecialisation = false;
+}
+
+uint64_t csFlatBus_getHalfCyclesToDate(void *opaqueBus)
+{
+	return ((CSFlatBus *)opaqueBus)->halfCyclesToDate;
+}
+
+// the number of nanoseconds in the given number of half cycles, if the
+// bus knows its rate; this is split so as not to overflow the multiply
+static CSComponentNanoseconds csFlatBus_getTimeSinceLaunch(const CSFlatBus *const flatBus, const uint64_t halfCycles)
+{
+	const uint64_t halfCyclesPerSecond = (uint64_t)flatBus->ticksPerSecond << 1;
+	if(!halfCyclesPerSecond) return 0;
+
+	return
+		(halfCycles / halfCyclesPerSecond) * 1000000000 +
+		((halfCycles % halfCyclesPerSecond) * 1000000000) / halfCyclesPerSecond;
+}
+
+// events are ordered by time then by the order in which they were scheduled;
+// time is 64-bit, so it won't wrap around
+static inline bool csFlatBus_eventPrecedes(const struct CSFlatBusEvent *a, const struct CSFlatBusEvent *b)
+{
+	if(a->time != b->time) return a->time < b->time;
+	return (int)(a->sequenceNumber - b->sequenceNumber) < 0;
+}
+
+static void csFlatBus_siftEventDown(CSFlatBus *const flatBus, unsigned int index)
+{
+	struct CSFlatBusEvent *const events = flatBus->events;
+	while(1)
+	{
+		unsigned int earliest = index;
+		unsigned int child = (index << 1) + 1;
+
+		if(child < flatBus->numberOfEvents && csFlatBus_eventPrecedes(&events[child], &events[earliest])) earliest = child;
+		child++;
+		if(child < flatBus->numberOfEvents && csFlatBus_eventPrecedes(&events[child], &events[earliest])) earliest = child;
+
+		if(earliest == index) return;
+
+		struct CSFlatBusEvent temporaryEvent = events[index];
+		events[index] = events[earliest];
+		events[earliest] = temporaryEvent;
+		index = earliest;
+	}
+}
+
+static void csFlatBus_updateNextEventTime(CSFlatBus *const flatBus)
+{
+	flatBus->nextEventTime = flatBus->numberOfEvents ? flatBus->events[0].time : UINT64_MAX;
+}
+
+void csFlatBus_scheduleEvent(
+	void *opaqueBus,
+	uint64_t halfCycleTime,
+	csFlatBus_eventHandler handler,
+	void *context)
+{
+	CSFlatBus *const flatBus = (CSFlatBus *)opaqueBus;
+
+	// events can't happen in the past
+	if(halfCycleTime < flatBus->halfCyclesToDate)
+		halfCycleTime = flatBus->halfCyclesToDate;
+
+	if(flatBus->numberOfEvents == flatBus->allocatedEvents)
+	{
+		unsigned int newAllocatedEvents = flatBus->allocatedEvents ? flatBus->allocatedEvents << 1 : 16;
+		struct CSFlatBusEvent *newEvents = (struct CSFlatBusEvent *)realloc(flatBus->events, sizeof(struct CSFlatBusEvent) * newAllocatedEvents);
+		if(!newEvents) return;
+
+		flatBus->events = newEvents;
+		flatBus->allocatedEvents = newAllocatedEvents;
+	}
+
+	// add to the end of the heap and sift up
+	struct CSFlatBusEvent *const events = flatBus->events;
+	unsigned int index = flatBus->numberOfEvents;
+	flatBus->numberOfEvents++;
+
+	events[index].time = halfCycleTime;
+	events[index].sequenceNumber = flatBus->nextEventSequenceNumber++;
+	events[index].handler = handler;
+	events[index].context = context;
+
+	while(index)
+	{
+		unsigned int parent = (index - 1) >> 1;
+		if(!csFlatBus_eventPrecedes(&events[index], &events[parent])) break;
+
+		struct CSFlatBusEvent temporaryEvent = events[index];
+		events[index] = events[parent];
+		events[parent] = temporaryEvent;
+		index = parent;
+	}
+
+	csFlatBus_updateNextEventTime(flatBus);
+}
+
+void csFlatBus_cancelEvents(
+	void *opaqueBus,
+	csFlatBus_eventHandler handler,
+	void *context)
+{
+	CSFlatBus *const flatBus = (CSFlatBus *)opaqueBus;
+
+	// strip out the relevant events, then rebuild the heap from what's left
+	unsigned int numberOfEvents = 0;
+	for(unsigned int index = 0; index < flatBus->numberOfEvents; index++)
+	{
+		if(flatBus->events[index].handler != handler || flatBus->events[index].context != context)
+			flatBus->events[numberOfEvents++] = flatBus->events[index];
+	}
+	flatBus->numberOfEvents = numberOfEvents;
+
+	for(unsigned int index = numberOfEvents >> 1; index--;)
+		csFlatBus_siftEventDown(flatBus, index);
+
+	csFlatBus_updateNextEventTime(flatBus);
+}
+
+// performs all events that are due now; the bus itself is the owner of
+// currentBusState so that's where events' outputs go
+static void __attribute__((noinline)) csFlatBus_performEvents(CSFlatBus *const flatBus)
+{
+	while(flatBus->numberOfEvents && flatBus->events[0].time == flatBus->halfCyclesToDate)
+	{
+		struct CSFlatBusEvent event = flatBus->events[0];
+
+		flatBus->numberOfEvents--;
+		flatBus->events[0] = flatBus->events[flatBus->numberOfEvents];
+		csFlatBus_siftEventDown(flatBus, 0);
+
+		event.handler(event.context, &flatBus->currentBusState, event.time);
+	}
+
+	csFlatBus_updateNextEventTime(flatBus);
+}
+
+#ifndef __BLOCKS__
+static void *csFlatBus_passiveObserverThread(void *opaqueObserver)
+{
+	struct CSFlatBusPassiveObserver *const observer = (struct CSFlatBusPassiveObserver *)opaqueObserver;
+
+	pthread_mutex_lock(&observer->mutex);
+	while(1)
+	{
+		while(!observer->pendingRecords && !observer->isFinishing)
+			pthread_cond_wait(&observer->handover, &observer->mutex);
+		if(!observer->pendingRecords) break;
+
+		// the lock isn't held while the handler runs, so that the bus can
+		// carry on collecting into the other buffer
+		pthread_mutex_unlock(&observer->mutex);
+		observer->handler(observer->context, observer->pendingRecords, observer->numberOfPendingRecords);
+		pthread_mutex_lock(&observer->mutex);
+
+		observer->pendingRecords = NULL;
+		pthread_cond_signal(&observer->handover);
+	}
+	pthread_mutex_unlock(&observer->mutex);
+
+	return NULL;
+}
+
+// waits until the observer's thread has finished with whatever it was last given;
+// returns with the lock held
+static void csFlatBus_lockIdlePassiveObserver(struct CSFlatBusPassiveObserver *const observer)
+{
+	pthread_mutex_lock(&observer->mutex);
+	while(observer->pendingRecords)
+		pthread_cond_wait(&observer->handover, &observer->mutex);
+}
+#endif
+
+void *csFlatBus_addPassiveObserver(
+	void *opaqueBus,
+	CSBusCondition condition,
+	unsigned int capacity,
+	bool isAsynchronous,
+	csFlatBus_historyHandler handler,
+	void *context)
+{
+	CSFlatBus *const flatBus = (CSFlatBus *)opaqueBus;
+	if(!capacity) return NULL;
+
+	// with only one processor the handler can't run alongside the bus, so
+	// handing the records over would just add a switch per flush
+	if(sysconf(_SC_NPROCESSORS_ONLN) <= 1) isAsynchronous = false;
+
+	struct CSFlatBusPassiveObserver **newObservers = (struct CSFlatBusPassiveObserver **)realloc(flatBus->passiveObservers, sizeof(struct CSFlatBusPassiveObserver *) * (flatBus->numberOfPassiveObservers + 1));
+	if(!newObservers) return NULL;
+	flatBus->passiveObservers = newObservers;
+
+	struct CSFlatBusPassiveObserver *const observer = (struct CSFlatBusPassiveObserver *)calloc(1, sizeof(struct CSFlatBusPassiveObserver));
+	if(!observer) return NULL;
+
+	observer->records = (CSFlatBusHistoryRecord *)malloc(sizeof(CSFlatBusHistoryRecord) * capacity);
+	observer->spareRecords = isAsynchronous ? (CSFlatBusHistoryRecord *)malloc(sizeof(CSFlatBusHistoryRecord) * capacity) : NULL;
+	if(!observer->records || (isAsynchronous && !observer->spareRecords))
+	{
+		free(observer->records);
+		free(observer->spareRecords);
+		free(observer);
+		return NULL;
+	}
+
+	observer->condition = condition;
+	observer->handler = handler;
+	observer->context = context;
+	observer->capacity = capacity;
+	observer->isAsynchronous = isAsynchronous;
+#ifdef __BLOCKS__
+	if(isAsynchronous) observer->queue = dispatch_queue_create("Clock Signal passive bus observer", DISPATCH_QUEUE_SERIAL);
+#else
+	if(isAsynchronous)
+	{
+		pthread_mutex_init(&observer->mutex, NULL);
+		pthread_cond_init(&observer->handover, NULL);
+
+		// if there's no thread to be had then the records are just
+		// handed over synchronously
+		if(pthread_create(&observer->thread, NULL, csFlatBus_passiveObserverThread, observer))
+		{
+			pthread_mutex_destroy(&observer->mutex);
+			pthread_cond_destroy(&observer->handover);
+			observer->isAsynchronous = false;
+		}
+	}
+#endif
+
+	// the observer starts from the bus as it is now
+	if(!flatBus->numberOfPassiveObservers)
+		flatBus->passiveObserverLastState = flatBus->clockedComponents.lastExternalState;
+
+	flatBus->passiveObservers[flatBus->numberOfPassiveObservers] = observer;
+	flatBus->numberOfPassiveObservers++;
+
+	return observer;
+}
+
+// hands whatever records the observer has collected to its handler; if the
+// handler runs asynchronously then it gets the current buffer once the
+// previous one is finished with, and collection continues in the other
+static void csFlatBus_flushPassiveObserver(struct CSFlatBusPassiveObserver *const observer)
+{
+	if(!observer->numberOfRecords) return;
+
+#ifdef __BLOCKS__
+	if(observer->isAsynchronous)
+	{
+		dispatch_sync(observer->queue, ^{});
+
+		CSFlatBusHistoryRecord *const records = observer->records;
+		const unsigned int numberOfRecords = observer->numberOfRecords;
+		const csFlatBus_historyHandler handler = observer->handler;
+		void *const context = observer->context;
+		dispatch_async(observer->queue, ^{ handler(context, records, numberOfRecords); });
+
+		observer->records = observer->spareRecords;
+		observer->spareRecords = records;
+		observer->numberOfRecords = 0;
+		return;
+	}
+#else
+	if(observer->isAsynchronous)
+	{
+		CSFlatBusHistoryRecord *const records = observer->records;
+
+		csFlatBus_lockIdlePassiveObserver(observer);
+		observer->pendingRecords = records;
+		observer->numberOfPendingRecords = observer->numberOfRecords;
+		pthread_cond_signal(&observer->handover);
+		pthread_mutex_unlock(&observer->mutex);
+
+		observer->records = observer->spareRecords;
+		observer->spareRecords = records;
+		observer->numberOfRecords = 0;
+		return;
+	}
+#endif
+
+	observer->handler(observer->context, observer->records, observer->numberOfRecords);
+	observer->numberOfRecords = 0;
+}
+
+static void csFlatBus_destroyPassiveObserver(struct CSFlatBusPassiveObserver *const observer)
+{
+	csFlatBus_flushPassiveObserver(observer);
+
+#ifdef __BLOCKS__
+	if(observer->isAsynchronous)
+	{
+		dispatch_sync(observer->queue, ^{});
+		dispatch_release(observer->queue);
+	}
+#else
+	if(observer->isAsynchronous)
+	{
+		csFlatBus_lockIdlePassiveObserver(observer);
+		observer->isFinishing = true;
+		pthread_cond_signal(&observer->handover);
+		pthread_mutex_unlock(&observer->mutex);
+
+		pthread_join(observer->thread, NULL);
+		pthread_mutex_destroy(&observer->mutex);
+		pthread_cond_destroy(&observer->handover);
+	}
+#endif
+
+	free(observer->records);
+	free(observer->spareRecords);
+	free(observer);
+}
+
+void csFlatBus_removePassiveObserver(void *opaqueBus, void *opaqueObserver)
+{
+	CSFlatBus *const flatBus = (CSFlatBus *)opaqueBus;
+
+	for(unsigned int index = 0; index < flatBus->numberOfPassiveObservers; index++)
+	{
+		if(flatBus->passiveObservers[index] == opaqueObserver)
+		{
+			csFlatBus_destroyPassiveObserver(flatBus->passiveObservers[index]);
+
+			flatBus->numberOfPassiveObservers--;
+			memmove(&flatBus->passiveObservers[index], &flatBus->passiveObservers[index+1], sizeof(struct CSFlatBusPassiveObserver *) * (flatBus->numberOfPassiveObservers - index));
+			return;
+		}
+	}
+}
+
+// appends a record to every passive observer that wants one, for the bus as
+// the unclocked components have just seen it
+static void __attribute__((noinline)) csFlatBus_recordHistory(
+	CSFlatBus *const restrict flatBus,
+	const CSBusState *const restrict totalState,
+	const uint64_t halfCycle)
+{
+#if CSBusExtendedWords
+	CSBusState changedLines;
+	csBus_getChangedLines(&changedLines, &flatBus->passiveObserverLastState, totalState);
+#else
+	const uint64_t changedLines = flatBus->passiveObserverLastState.lineValues ^ totalState->lineValues;
+	if(!changedLines) return;
+#endif
+	flatBus->passiveObserverLastState = *totalState;
+
+	for(unsigned int index = 0; index < flatBus->numberOfPassiveObservers; index++)
+	{
+		struct CSFlatBusPassiveObserver *const observer = flatBus->passiveObservers[index];
+		const CSBusCondition *const condition = &observer->condition;
+
+#if CSBusExtendedWords
+		if(!csBusCondition_isAffectedBy(condition, &changedLines) || !csBusCondition_isTrue(condition, totalState)) continue;
+#else
+		if(!((condition->changedLines | condition->lineMask) & changedLines) || condition->lineValues != (condition->lineMask & totalState->lineValues)) continue;
+#endif
+
+		CSFlatBusHistoryRecord *const record = &observer->records[observer->numberOfRecords];
+		record->halfCycle = halfCycle;
+		record->state = *totalState;
+
+		observer->numberOfRecords++;
+		if(observer->numberOfRecords == observer->capacity) csFlatBus_flushPassiveObserver(observer);
+	}
+}
+
+#define callHandlerUnprofiled(x, status) \
+	x.handlerFunction(\
+		x.context,\
+		&x.currentInternalState,\
+		x.filter ? csFlatBus_applyFilter((struct CSFlatBusFilter *)x.filter, totalState) : totalState,\
+		status,\
+		timeSinceLaunch)
+
+#if CSFlatBusProfile
+
+// timing every handler call would cost more than most handlers do, so
+// only one in every so many is timed
+#define kCSFlatBusProfileSampleInterval	16
+
+static inline uint64_t csFlatBus_readProfileTimer(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __builtin_ia32_rdtsc();
+#else
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (uint64_t)time.tv_sec * 1000000000 + (uint64_t)time.tv_nsec;
+#endif
+}
+
+#define callHandler(x, status) \
+	do\
+	{\
+		CSBusComponent *const profiledComponent = &(x);\
+		if(!(profiledComponent->profile.handlerCalls++ % kCSFlatBusProfileSampleInterval))\
+		{\
+			const uint64_t startTime = csFlatBus_readProfileTimer();\
+			callHandlerUnprofiled(x, status);\
+			profiledComponent->profile.sampledHandlerTicks += csFlatBus_readProfileTimer() - startTime;\
+			profiledComponent->profile.sampledHandlerCalls++;\
+		}\
+		else\
+			callHandlerUnprofiled(x, status);\
+	} while(0)
+
+#define csFlatBus_profileEvaluation(component, result) \
+	do\
+	{\
+		(component)->profile.conditionEvaluations++;\
+		(component)->profile.conditionHits += !!(result);\
+	} while(0)
+
+#define csFlatBus_profileSet(set, wasRun) \
+	do\
+	{\
+		if(wasRun) (set)->profileRuns++; else (set)->profileSkips++;\
+	} while(0)
+
+// a bulk evaluation tests every condition in the set
+static void csFlatBus_profileBulkEvaluation(CSBusComponent *const *const components, const unsigned int numberOfComponents, const uint64_t results)
+{
+	for(unsigned int componentIndex = 0; componentIndex < numberOfComponents; componentIndex++)
+		csFlatBus_profileEvaluation(components[componentIndex], results & (1llu << componentIndex));
+}
+
+// an indexed set tests each condition once on behalf of all the components that use it
+static void csFlatBus_profileConditionEvaluation(
+	const struct CSFlatBusComponentSet *const set,
+	CSBusComponent *const *const components,
+	const unsigned int conditionIndex,
+	const bool result,
+	const unsigned int componentWords)
+{
+	const uint64_t *const subscribers = &set->conditionSubscribers[conditionIndex * componentWords];
+	for(unsigned int word = 0; word < componentWords; word++)
+	{
+		uint64_t candidates = subscribers[word];
+		while(candidates)
+		{
+			csFlatBus_profileEvaluation(components[(word << 6) + (unsigned int)__builtin_ctzll(candidates)], result);
+			candidates &= candidates - 1;
+		}
+	}
+}
+
+#else
+
+#define callHandler(x, status)	callHandlerUnprofiled(x, status)
+#define csFlatBus_profileEvaluation(component, result)
+#define csFlatBus_profileSet(set, wasRun)
+#define csFlatBus_profileBulkEvaluation(components, numberOfComponents, results)
+#define csFlatBus_profileConditionEvaluation(set, components, conditionIndex, result, componentWords)
+
+#endif
+
+// Smaller sets — never more than 64 components — are just scanned in full. Where
+// SIMD is available and there are enough components to make it worthwhile, all
+// conditions are tested in bulk first, producing bitfields of those that are true
+// and of those that observe one of the lines that has just changed, from which
+// follow the components to message. Otherwise each is tested in turn.
+
+#if defined(__AVX2__) || defined(__SSE2__)
+
+// tests conditions [0, numberOfConditions) against the bus state, returning a bitfield
+// with a bit set for each that is true and setting a bit in touched for each with
+// sensitiveLines that include any of changedLines; the arrays are padded with the
+// impossible condition so this may safely read a little beyond numberOfConditions
+static inline __attribute__((always_inline)) uint64_t csFlatBus_evaluateConditions(
+	const uint64_t *const restrict lineMasks,
+	const uint64_t *const restrict lineValues,
+	const uint64_t *const restrict sensitiveLines,
+	const unsigned int numberOfConditions,
+	const uint64_t busState,
+	const uint64_t changedLines,
+	uint64_t *const restrict touched)
+{
+	uint64_t results = 0;
+	*touched = 0;
+
+#if defined(__AVX2__)
+	const __m256i bus = _mm256_set1_epi64x((long long)busState);
+	const __m256i changed = _mm256_set1_epi64x((long long)changedLines);
+	const __m256i zero = _mm256_setzero_si256();
+
+	for(unsigned int index = 0; index < numberOfConditions; index += 4)
+	{
+		const __m256i masks = _mm256_loadu_si256((const __m256i *)&lineMasks[index]);
+		const __m256i values = _mm256_loadu_si256((const __m256i *)&lineValues[index]);
+		const __m256i sensitivities = _mm256_loadu_si256((const __m256i *)&sensitiveLines[index]);
+
+		const __m256i isTrue = _mm256_cmpeq_epi64(_mm256_and_si256(masks, bus), values);
+		const __m256i isUntouched = _mm256_cmpeq_epi64(_mm256_and_si256(sensitivities, changed), zero);
+
+		results |= (uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(isTrue)) << index;
+		*touched |= (uint64_t)(_mm256_movemask_pd(_mm256_castsi256_pd(isUntouched)) ^ 0xf) << index;
+	}
+#else
+	// SSE2 can compare only 32-bit quantities, so each 64-bit comparison
+	// is the AND of two halves
+	const __m128i bus = _mm_set1_epi64x((long long)busState);
+	const __m128i changed = _mm_set1_epi64x((long long)changedLines);
+	const __m128i zero = _mm_setzero_si128();
+
+	for(unsigned int index = 0; index < numberOfConditions; index += 2)
+	{
+		const __m128i masks = _mm_loadu_si128((const __m128i *)&lineMasks[index]);
+		const __m128i values = _mm_loadu_si128((const __m128i *)&lineValues[index]);
+		const __m128i sensitivities = _mm_loadu_si128((const __m128i *)&sensitiveLines[index]);
+
+		__m128i isTrue = _mm_cmpeq_epi32(_mm_and_si128(masks, bus), values);
+		__m128i isUntouched = _mm_cmpeq_epi32(_mm_and_si128(sensitivities, changed), zero);
+		isTrue = _mm_and_si128(isTrue, _mm_shuffle_epi32(isTrue, _MM_SHUFFLE(2, 3, 0, 1)));
+		isUntouched = _mm_and_si128(isUntouched, _mm_shuffle_epi32(isUntouched, _MM_SHUFFLE(2, 3, 0, 1)));
+
+		results |= (uint64_t)_mm_movemask_pd(_mm_castsi128_pd(isTrue)) << index;
+		*touched |= (uint64_t)(_mm_movemask_pd(_mm_castsi128_pd(isUntouched)) ^ 0x3) << index;
+	}
+#endif
+
+	return results;
+}
+
+// messages the nominated components in descending order, recomputing the set's output
+// as it goes and, if requested, recording the results with the components
+static inline __attribute__((always_inline)) void csFlatBus_messageComponents(
+	struct CSFlatBusComponentSet *const restrict set,
+	CSBusComponent *const *const restrict components,
+	const unsigned int numberOfComponents,
+	const uint64_t messagedComponents,
+	const uint64_t componentResults,
+	const bool recordResults,
+	const CSBusState totalState,
+	const CSComponentNanoseconds timeSinceLaunch)
+{
+	csBus_setAllLinesHigh(&set->state);
+
+	unsigned int componentIndex = numberOfComponents;
+	while(componentIndex--)
+	{
+		if(messagedComponents & (1llu << componentIndex))
+		{
+			const bool result = !!(componentResults & (1llu << componentIndex));
+			if(recordResults) components[componentIndex]->lastResult = result;
+			callHandler((*components[componentIndex]), result);
+		}
+
+		csBus_resolve(&set->state, &components[componentIndex]->currentInternalState);
+	}
+}
+
+#endif
+
+static inline void csFlatBus_scanTrueSet(
+	struct CSFlatBusComponentSet *const restrict set,
+	CSBusComponent *const *const restrict components,
+	const unsigned int numberOfComponents,
+	const CSBusState totalState,
+	const uint64_t changedLines,
+	const CSComponentNanoseconds timeSinceLaunch)
+{
+	const uint64_t *const restrict lineMasks = set->componentLineMasks;
+	const uint64_t *const restrict lineValues = set->componentLineValues;
+
+	// if one of the monitored lines just changed and the condition is now true,
+	// it can't have been before so this is a time to message
+#if defined(__AVX2__) || defined(__SSE2__)
+	if(numberOfComponents >= kCSFlatBusMinimumComponentsForBulkEvaluation)
+	{
+		uint64_t touched;
+		uint64_t results = csFlatBus_evaluateConditions(lineMasks, lineValues, lineMasks, numberOfComponents, totalState.lineValues, changedLines, &touched);
+		csFlatBus_profileBulkEvaluation(components, numberOfComponents, results);
+
+		if(results & touched)
+			csFlatBus_messageComponents(set, components, numberOfComponents, results & touched, results, false, totalState, timeSinceLaunch);
+		return;
+	}
+#endif
+
+	csBus_setAllLinesHigh(&set->state);
+
+	unsigned int componentIndex = numberOfComponents;
+	while(componentIndex--)
+	{
+		if(lineMasks[componentIndex]&changedLines)
+		{
+			const bool isTrue = lineValues[componentIndex] == (lineMasks[componentIndex]&totalState.lineValues);
+			csFlatBus_profileEvaluation(components[componentIndex], isTrue);
+			if(isTrue)
+			{
+				callHandler((*components[componentIndex]), true);
+			}
+		}
+
+		csBus_resolve(&set->state, &components[componentIndex]->currentInternalState);
+	}
+}
+
+static inline void csFlatBus_scanTrueFalseSet(
+	struct CSFlatBusComponentSet *const restrict set,
+	CSBusComponent *const *const restrict components,
+	const unsigned int numberOfComponents,
+	const CSBusState totalState,
+	const uint64_t changedLines,
+	const CSComponentNanoseconds timeSinceLaunch)
+{
+	const uint64_t *const restrict lineMasks = set->componentLineMasks;
+	const uint64_t *const restrict lineValues = set->componentLineValues;
+	const uint64_t *const restrict changedLineMasks = set->componentChangedLines;
+
+	// so, logic is: message if
+	//
+	//		mask condition has changed, or
+	//		mask condition is true and one of the other monitored lines has changed
+#if defined(__AVX2__) || defined(__SSE2__)
+	if(numberOfComponents >= kCSFlatBusMinimumComponentsForBulkEvaluation)
+	{
+		uint64_t touched;
+		uint64_t results = csFlatBus_evaluateConditions(lineMasks, lineValues, changedLineMasks, numberOfComponents, totalState.lineValues, changedLines, &touched);
+		csFlatBus_profileBulkEvaluation(components, numberOfComponents, results);
+		uint64_t messaged = (results ^ set->componentLastResults[0]) | (results & touched);
+		set->componentLastResults[0] = results;
+
+		if(messaged)
+			csFlatBus_messageComponents(set, components, numberOfComponents, messaged, results, true, totalState, timeSinceLaunch);
+		return;
+	}
+#endif
+
+	csBus_setAllLinesHigh(&set->state);
+
+	unsigned int componentIndex = numberOfComponents;
+	while(componentIndex--)
+	{
+		const bool newEvaluation = lineValues[componentIndex] == (lineMasks[componentIndex]&totalState.lineValues);
+		csFlatBus_profileEvaluation(components[componentIndex], newEvaluation);
+
+		if(
+			(newEvaluation != components[componentIndex]->lastResult) || (newEvaluation && changedLineMasks[componentIndex]&changedLines))
+		{
+			callHandler((*components[componentIndex]), newEvaluation);
+			components[componentIndex]->lastResult = newEvaluation;
+		}
+
+		csBus_resolve(&set->state, &components[componentIndex]->currentInternalState);
+	}
+}
+
+// Larger sets use their index to find the conditions that observe the lines that
+// have changed, evaluate each of those just once, then message the components
+// attached to whichever conditions warrant it.
+//
+// The dispatchers are written in terms of a number of words of conditions and
+// of components so that they can be instantiated separately for the common case
+// of a set with no more than 64 of each, in which case all the bitfields collapse
+// into single integers.
+
+// gathers all those conditions that observe any of the nominated lines, plus any
+// that are pending; returns false if there aren't any
+static inline __attribute__((always_inline)) bool csFlatBus_gatherCandidateConditions(
+	struct CSFlatBusComponentSet *const restrict set,
+	uint64_t *const restrict candidates,
+	uint64_t changedLines,
+	const unsigned int conditionWords)
+{
+	uint64_t anyCandidates = 0;
+
+	if(set->hasPendingConditions)
+	{
+		for(unsigned int word = 0; word < conditionWords; word++)
+		{
+			candidates[word] = set->pendingConditions[word];
+			set->pendingConditions[word] = 0;
+		}
+		set->hasPendingConditions = false;
+	}
+	else
+	{
+		for(unsigned int word = 0; word < conditionWords; word++)
+			candidates[word] = 0;
+	}
+
+	// look up each group of eight lines in turn; doing all eight unconditionally
+	// is cheaper than branching on those that have changed
+	changedLines &= set->allObservedLines;
+	for(unsigned int group = 0; group < 8; group++)
+	{
+		const uint64_t *const restrict subscribers = &set->lineSubscribers[((group << 8) | (uint8_t)(changedLines >> (group << 3))) * conditionWords];
+		for(unsigned int word = 0; word < conditionWords; word++)
+			candidates[word] |= subscribers[word];
+	}
+
+	for(unsigned int word = 0; word < conditionWords; word++)
+		anyCandidates |= candidates[word];
+
+	return !!anyCandidates;
+}
+
+// messages all components attached to the nominated conditions, in descending order
+static inline __attribute__((always_inline)) void csFlatBus_messageSubscribers(
+	struct CSFlatBusComponentSet *const restrict set,
+	CSBusComponent *const *const restrict components,
+	unsigned int numberOfComponents,
+	const uint64_t *const restrict messagedConditions,
+	const uint64_t *const restrict conditionResults,
+	const CSBusState totalState,
+	const CSComponentNanoseconds timeSinceLaunch,
+	const unsigned int conditionWords,
+	const unsigned int componentWords)
+{
+	uint64_t candidateComponents[componentWords];
+	for(unsigned int word = 0; word < componentWords; word++) candidateComponents[word] = 0;
+
+	for(unsigned int word = 0; word < conditionWords; word++)
+	{
+		uint64_t conditions = messagedConditions[word];
+		while(conditions)
+		{
+			const unsigned int conditionIndex = (word << 6) + (unsigned int)__builtin_ctzll(conditions);
+			conditions &= conditions - 1;
+
+			const uint64_t *const restrict subscribers = &set->conditionSubscribers[conditionIndex * componentWords];
+			for(unsigned int componentWord = 0; componentWord < componentWords; componentWord++)
+				candidateComponents[componentWord] |= subscribers[componentWord];
+		}
+	}
+
+	for(unsigned int word = componentWords; word--;)
+	{
+		uint64_t candidates = candidateComponents[word];
+		while(candidates)
+		{
+			const unsigned int bit = 63 - (unsigned int)__builtin_clzll(candidates);
+			CSBusComponent *const component = components[(word << 6) + bit];
+			candidates ^= 1llu << bit;
+
+			callHandler((*component), !!csFlatBus_testBit(conditionResults, component->conditionIndex));
+		}
+	}
+
+	csBus_setAllLinesHigh(&set->state);
+	while(numberOfComponents--)
+		csBus_resolve(&set->state, &components[numberOfComponents]->currentInternalState);
+}
+
+static inline __attribute__((always_inline)) void csFlatBus_dispatchTrueSet(
+	struct CSFlatBusComponentSet *const restrict set,
+	CSBusComponent *const *const restrict components,
+	unsigned int numberOfComponents,
+	const CSBusState totalState,
+	const uint64_t changedLines,
+	const CSComponentNanoseconds timeSinceLaunch,
+	const unsigned int conditionWords,
+	const unsigned int componentWords)
+{
+	uint64_t candidateConditions[conditionWords];
+	uint64_t messagedConditions[conditionWords];
+
+	if(!csFlatBus_gatherCandidateConditions(set, candidateConditions, changedLines, conditionWords)) return;
+
+	// if one of the monitored lines just changed and the condition is now true,
+	// it can't have been before so this is a time to message
+	uint64_t anyMessaged = 0;
+	for(unsigned int word = 0; word < conditionWords; word++)
+	{
+		uint64_t candidates = candidateConditions[word];
+		uint64_t messaged = 0;
+
+		while(candidates)
+		{
+			const unsigned int bit = (unsigned int)__builtin_ctzll(candidates);
+			const CSBusCondition *const condition = &set->conditions[(word << 6) + bit];
+			candidates &= candidates - 1;
+
+			messaged |= (uint64_t)(
+				!!(condition->lineMask&changedLines) &
+				(condition->lineValues == (condition->lineMask&totalState.lineValues))) << bit;
+			csFlatBus_profileConditionEvaluation(set, components, (word << 6) + bit, messaged & (1llu << bit), componentWords);
+		}
+
+		messagedConditions[word] = messaged;
+		anyMessaged |= messaged;
+	}
+
+	if(anyMessaged)
+		csFlatBus_messageSubscribers(set, components, numberOfComponents, messagedConditions, messagedConditions, totalState, timeSinceLaunch, conditionWords, componentWords);
+}
+
+static inline __attribute__((always_inline)) void csFlatBus_dispatchTrueFalseSet(
+	struct CSFlatBusComponentSet *const restrict set,
+	CSBusComponent *const *const restrict components,
+	unsigned int numberOfComponents,
+	const CSBusState totalState,
+	const uint64_t changedLines,
+	const CSComponentNanoseconds timeSinceLaunch,
+	const unsigned int conditionWords,
+	const unsigned int componentWords)
+{
+	uint64_t candidateConditions[conditionWords];
+	uint64_t conditionResults[conditionWords];
+	uint64_t messagedConditions[conditionWords];
+
+	if(!csFlatBus_gatherCandidateConditions(set, candidateConditions, changedLines, conditionWords)) return;
+
+	// message if the condition has changed, or if it is true and one of the
+	// other monitored lines has changed
+	uint64_t anyMessaged = 0;
+	for(unsigned int word = 0; word < conditionWords; word++)
+	{
+		uint64_t candidates = candidateConditions[word];
+		uint64_t results = 0, mutations = 0;
+
+		while(candidates)
+		{
+			const unsigned int bit = (unsigned int)__builtin_ctzll(candidates);
+			const CSBusCondition *const condition = &set->conditions[(word << 6) + bit];
+			candidates &= candidates - 1;
+
+			const uint64_t result = condition->lineValues == (condition->lineMask&totalState.lineValues);
+			csFlatBus_profileConditionEvaluation(set, components, (word << 6) + bit, result, componentWords);
+			results |= result << bit;
+			mutations |= (result & !!(condition->changedLines&changedLines)) << bit;
+		}
+
+		messagedConditions[word] = ((results ^ set->conditionLastResults[word]) & candidateConditions[word]) | mutations;
+		set->conditionLastResults[word] ^= results ^ (set->conditionLastResults[word] & candidateConditions[word]);
+		conditionResults[word] = results;
+		anyMessaged |= messagedConditions[word];
+	}
+
+	if(anyMessaged)
+		csFlatBus_messageSubscribers(set, components, numberOfComponents, messagedConditions, conditionResults, totalState, timeSinceLaunch, conditionWords, componentWords);
+}
+
+// picks the appropriate means of dispatch for each set
+static inline __attribute__((always_inline)) void csFlatBus_runTrueSet(
+	struct CSFlatBusComponentSet *const restrict set,
+	CSBusComponent *const *const restrict components,
+	const unsigned int numberOfComponents,
+	const CSBusState totalState,
+	const uint64_t changedLines,
+	const CSComponentNanoseconds timeSinceLaunch)
+{
+	if(!set->isIndexed)
+		csFlatBus_scanTrueSet(set, components, numberOfComponents, totalState, changedLines, timeSinceLaunch);
+	else if(set->conditionWords == 1 && set->componentWords == 1)
+		csFlatBus_dispatchTrueSet(set, components, numberOfComponents, totalState, changedLines, timeSinceLaunch, 1, 1);
+	else
+		csFlatBus_dispatchTrueSet(set, components, numberOfComponents, totalState, changedLines, timeSinceLaunch, set->conditionWords, set->componentWords);
+}
+
+static inline __attribute__((always_inline)) void csFlatBus_runTrueFalseSet(
+	struct CSFlatBusComponentSet *const restrict set,
+	CSBusComponent *const *const restrict components,
+	const unsigned int numberOfComponents,
+	const CSBusState totalState,
+	const uint64_t changedLines,
+	const CSComponentNanoseconds timeSinceLaunch)
+{
+	if(!set->isIndexed)
+		csFlatBus_scanTrueFalseSet(set, components, numberOfComponents, totalState, changedLines, timeSinceLaunch);
+	else if(set->conditionWords == 1 && set->componentWords == 1)
+		csFlatBus_dispatchTrueFalseSet(set, components, numberOfComponents, totalState, changedLines, timeSinceLaunch, 1, 1);
+	else
+		csFlatBus_dispatchTrueFalseSet(set, components, numberOfComponents, totalState, changedLines, timeSinceLaunch, set->conditionWords, set->componentWords);
+}
+
+// applies a filter and messages those components behind it that need to be told
+// about the result, in the same way as for those that see the bus directly
+static void __attribute__((noinline)) csFlatBus_runFilteredSets(
+	struct CSFlatBusFilter *const restrict filter,
+	const CSBusState unfilteredState,
+	const CSComponentNanoseconds timeSinceLaunch)
+{
+	const CSBusState totalState = csFlatBus_applyFilter(filter, unfilteredState);
+	const uint64_t changedLines = filter->lastExternalState.lineValues ^ totalState.lineValues;
+	filter->lastExternalState = totalState;
+
+	const uint64_t setLines = totalState.lineValues & changedLines;
+	const uint64_t resetLines = setLines ^ changedLines;
+
+	struct CSFlatBusComponentSet *const trueSet = &filter->trueComponents;
+	const bool trueSetMayChange = trueSet->allObservedSetLines&setLines || trueSet->allObservedResetLines&resetLines;
+	csFlatBus_profileSet(trueSet, trueSetMayChange);
+	if(trueSetMayChange)
+	{
+		unsigned int numberOfComponents;
+		CSBusComponent *const *const components = (CSBusComponent **)csPoolAllocator_getObjects(trueSet->components, &numberOfComponents);
+		csFlatBus_runTrueSet(trueSet, components, numberOfComponents, totalState, changedLines, timeSinceLaunch);
+	}
+
+	struct CSFlatBusComponentSet *const trueFalseSet = &filter->trueFalseComponents;
+	const bool trueFalseSetMayChange = !!((trueFalseSet->allObservedSetLines | trueFalseSet->allObservedResetLines | trueFalseSet->allObservedChangeLines)&changedLines);
+	csFlatBus_profileSet(trueFalseSet, trueFalseSetMayChange);
+	if(trueFalseSetMayChange)
+	{
+		unsigned int numberOfComponents;
+		CSBusComponent *const *const components = (CSBusComponent **)csPoolAllocator_getObjects(trueFalseSet->components, &numberOfComponents);
+		csFlatBus_runTrueFalseSet(trueFalseSet, components, numberOfComponents, totalState, changedLines, timeSinceLaunch);
+	}
+}
+
+#if CSBusExtendedWords
+
+// components that observe lines beyond the first 64 are few, so they're just
+// scanned in full whenever anything changes, in the same order as any other set
+// and with the same tests, just across the full width of the bus
+static void __attribute__((noinline)) csFlatBus_runWideSet(
+	struct CSFlatBusComponentSet *const restrict set,
+	const CSBusState totalState,
+	const CSComponentNanoseconds timeSinceLaunch)
+{
+	CSBusState changedLines;
+	csBus_getChangedLines(&changedLines, &set->lastExternalState, &totalState);
+	set->lastExternalState = totalState;
+
+	CSBusComponent *const *const components = set->awakeComponents;
+	set->state = set->sleepingState;
+	unsigned int componentIndex = set->numberOfAwakeComponents;
+	while(componentIndex--)
+	{
+		CSBusComponent *const component = components[componentIndex];
+		if(csBusCondition_isAffectedBy(&component->condition, &changedLines))
+		{
+			const bool newEvaluation = csBusCondition_isTrue(&component->condition, &totalState);
+			csFlatBus_profileEvaluation(component, newEvaluation);
+
+			if(component->condition.signalOnTrueOnly)
+			{
+				if(newEvaluation)
+				{
+					callHandler((*component), true);
+				}
+			}
+			else if(newEvaluation != component->lastResult || (newEvaluation && csBusCondition_observesChanges(&component->condition, &changedLines)))
+			{
+				component->lastResult = newEvaluation;
+				callHandler((*component), newEvaluation);
+			}
+		}
+
+		csBus_resolve(&set->state, &component->currentInternalState);
+	}
+}
+
+#endif
+
+// the bus state as last seen by the components of the nominated set
+static const CSBusState *csFlatBus_getLastExternalState(CSFlatBus *const flatBus, struct CSFlatBusComponentSet *const set)
+{
+	for(unsigned int filterIndex = 0; filterIndex < flatBus->numberOfFilters; filterIndex++)
+	{
+		struct CSFlatBusFilter *const filter = flatBus->filters[filterIndex];
+		if(set == &filter->trueComponents || set == &filter->trueFalseComponents)
+			return &filter->lastExternalState;
+	}
+
+	// the true and true/false sets share a single record
+	if(set == &flatBus->trueFalseComponents) return &flatBus->trueComponents.lastExternalState;
+	return &set->lastExternalState;
+}
+
+// a component in a set that's dispatched by condition is put to sleep by giving it
+// the impossible condition wherever the set mirrors it, and by removing it from the
+// index, if there is one; it's woken by restoring it, with its condition taken to
+// have its current value
+static void csFlatBus_updateDispatchedComponent(CSFlatBus *const flatBus, struct CSFlatBusComponentSet *const set, CSBusComponent *const component)
+{
+	const unsigned int componentIndex = component->indexInSet;
+
+	if(component->isAsleep)
+	{
+		component->lastResult = false;
+		set->componentLineMasks[componentIndex] = 0;
+		set->componentLineValues[componentIndex] = 1;
+		set->componentChangedLines[componentIndex] = 0;
+
+		if(set->isIndexed)
+			csFlatBus_clearBit(&set->conditionSubscribers[component->conditionIndex * set->componentWords], componentIndex);
+	}
+	else
+	{
+		const CSBusState *const externalState = csFlatBus_getLastExternalState(flatBus, set);
+		component->lastResult = component->condition.lineValues == (component->condition.lineMask & externalState->lineValues);
+		set->componentLineMasks[componentIndex] = component->condition.lineMask;
+		set->componentLineValues[componentIndex] = component->condition.lineValues;
+		set->componentChangedLines[componentIndex] = component->condition.changedLines;
+
+		if(set->isIndexed)
+		{
+			component->conditionIndex = csFlatBus_indexOfCondition(set, component->condition, component->lastResult);
+			csFlatBus_setBit(&set->conditionSubscribers[component->conditionIndex * set->componentWords], componentIndex);
+		}
+	}
+
+	if(component->lastResult)
+		csFlatBus_setBit(set->componentLastResults, componentIndex);
+	else
+		csFlatBus_clearBit(set->componentLastResults, componentIndex);
+
+}
+
+// lists the awake components of a set that isn't dispatched by condition,
+// and combines the output of those that are asleep
+static void csFlatBus_updateAwakeComponents(struct CSFlatBusComponentSet *const set)
+{
+	unsigned int numberOfComponents;
+	CSBusComponent *const *const components = (CSBusComponent **)csPoolAllocator_getObjects(set->components, &numberOfComponents);
+
+	set->numberOfAwakeComponents = 0;
+	csBus_setAllLinesHigh(&set->sleepingState);
+	for(unsigned int componentIndex = 0; componentIndex < numberOfComponents; componentIndex++)
+	{
+		if(components[componentIndex]->isAsleep)
+			csBus_resolve(&set->sleepingState, &components[componentIndex]->currentInternalState);
+		else
+			set->awakeComponents[set->numberOfAwakeComponents++] = components[componentIndex];
+	}
+}
+
+// puts to sleep or wakes whichever components have asked since the last half cycle
+static void __attribute__((noinline)) csFlatBus_applySleepChanges(CSFlatBus *const flatBus)
+{
+	for(unsigned int index = 0; index < flatBus->numberOfPendingSleepChanges; index++)
+	{
+		CSBusComponent *const component = flatBus->pendingSleepChanges[index];
+		struct CSFlatBusComponentSet *const set = (struct CSFlatBusComponentSet *)component->set;
+
+		component->hasPendingSleepChange = false;
+		if(component->isAsleep == component->shouldBeAsleep) continue;
+		component->isAsleep = component->shouldBeAsleep;
+
+		csFlatBus_countObservedLines(set, component->condition, component->isAsleep ? -1 : 1);
+		if(set->isDispatchedByCondition)
+		{
+			csFlatBus_updateDispatchedComponent(flatBus, set, component);
+		}
+		else
+		{
+#if CSBusExtendedWords
+			if(set == &flatBus->wideComponents)
+				component->lastResult = !component->isAsleep && csBusCondition_isTrue(&component->condition, &set->lastExternalState);
+#endif
+			csFlatBus_updateAwakeComponents(set);
+		}
+	}
+
+	flatBus->numberOfPendingSleepChanges = 0;
+}
+
+// gets the total state of the bus, as output by all components and the bus itself
+static inline __attribute__((always_inline)) void csFlatBus_resolveComponentOutputs(CSFlatBus *const restrict flatBus, CSBusState *const restrict state)
+{
+	csBus_resolve(state, &flatBus->trueComponents.state);
+	csBus_resolve(state, &flatBus->trueFalseComponents.state);
+	csBus_resolve(state, &flatBus->clockedComponents.state);
+	csBus_resolve(state, &flatBus->filteredState);
+#if CSBusExtendedWords
+	csBus_resolve(state, &flatBus->wideComponents.state);
+#endif
+}
+
+static inline __attribute__((always_inline)) void csFlatBus_getTotalState(CSFlatBus *const restrict flatBus, CSBusState *const restrict totalState)
+{
+	*totalState = flatBus->currentBusState;
+	csFlatBus_resolveComponentOutputs(flatBus, totalState);
+}
+
+// the bus has settled if the last half cycle changed nothing
+static inline __attribute__((always_inline)) bool csFlatBus_hasSettled(CSFlatBus *const restrict flatBus)
+{
+	if(!csBus_isEqual(&flatBus->trueComponents.lastExternalState, &flatBus->clockedComponents.lastExternalState)) return false;
+
+	CSBusState totalState;
+	csFlatBus_getTotalState(flatBus, &totalState);
+	return csBus_isEqual(&flatBus->clockedComponents.lastExternalState, &totalState);
+}
+
+// the bus can skip periods in which only the clock changes if every clocked
+// component can describe its quiet periods, and nothing else watches the clock
+// whether any of the set's awake components watches the clock line
+static bool csFlatBus_setObservesClock(const struct CSFlatBusComponentSet *const set)
+{
+	return !!((set->allObservedSetLines | set->allObservedResetLines | set->allObservedChangeLines) & CSBusStandardClockLine);
+}
+
+static bool csFlatBus_mayBulkAdvance(CSFlatBus *const flatBus)
+{
+	// only those that are awake need be asked
+	unsigned int numberOfClockedComponents = flatBus->clockedComponents.numberOfAwakeComponents;
+	CSBusComponent *const *const clockedComponents = flatBus->clockedComponents.awakeComponents;
+
+	if(!numberOfClockedComponents) return false;
+	while(numberOfClockedComponents--)
+	{
+		if(!clockedComponents[numberOfClockedComponents]->horizonFunction) return false;
+	}
+
+	for(unsigned int clockDomainIndex = 0; clockDomainIndex < flatBus->numberOfClockDomains; clockDomainIndex++)
+	{
+		unsigned int numberOfComponents = flatBus->clockDomains[clockDomainIndex]->clockedComponents.numberOfAwakeComponents;
+		CSBusComponent *const *const components = flatBus->clockDomains[clockDomainIndex]->clockedComponents.awakeComponents;
+		while(numberOfComponents--)
+		{
+			if(!components[numberOfComponents]->horizonFunction) return false;
+		}
+	}
+
+	const struct CSFlatBusComponentSet *const sets[] =
+	{
+		&flatBus->trueComponents, &flatBus->trueFalseComponents,
+#if CSBusExtendedWords
+		&flatBus->wideComponents,
+#endif
+	};
+	for(unsigned int index = 0; index < sizeof(sets) / sizeof(*sets); index++)
+	{
+		if(csFlatBus_setObservesClock(sets[index])) return false;
+	}
+
+	// including those that view the bus through a filter
+	for(unsigned int filterIndex = 0; filterIndex < flatBus->numberOfFilters; filterIndex++)
+	{
+		if(
+			csFlatBus_setObservesClock(&flatBus->filters[filterIndex]->trueComponents) ||
+			csFlatBus_setObservesClock(&flatBus->filters[filterIndex]->trueFalseComponents))
+			return false;
+	}
+
+	for(unsigned int index = 0; index < flatBus->numberOfPassiveObservers; index++)
+	{
+		if(csBusCondition_observedLines(flatBus->passiveObservers[index]->condition) & CSBusStandardClockLine)
+			return false;
+	}
+
+	return true;
+}
+
+// returns the number of bus half cycles before the domain's clock has ticked
+// edges times and is about to tick again, or something beyond limit if that's sooner
+static unsigned int csFlatBus_getClockDomainHorizon(const struct CSFlatBusClockDomain *const clockDomain, unsigned int edges, const unsigned int limit)
+{
+	unsigned int halfCycles = clockDomain->halfCyclesToEdge;
+	unsigned int edgeInterval = clockDomain->nextEdgeInterval;
+
+	while(edges && halfCycles <= limit)
+	{
+		halfCycles += clockDomain->edgeIntervals[edgeInterval];
+		edgeInterval++;
+		if(edgeInterval == clockDomain->numberOfEdgeIntervals) edgeInterval = 0;
+		edges--;
+	}
+
+	return halfCycles - 1;
+}
+
+// advances the domain's clock over the given number of bus half cycles, having
+// its components apply the effect of however many edges that amounts to
+static void csFlatBus_bulkAdvanceClockDomain(struct CSFlatBusClockDomain *const clockDomain, unsigned int halfCycles, const CSBusState totalState)
+{
+	unsigned int edges = 0;
+	while(clockDomain->halfCyclesToEdge <= halfCycles)
+	{
+		halfCycles -= clockDomain->halfCyclesToEdge;
+		edges++;
+
+		clockDomain->halfCyclesToEdge = clockDomain->edgeIntervals[clockDomain->nextEdgeInterval];
+		clockDomain->nextEdgeInterval++;
+		if(clockDomain->nextEdgeInterval == clockDomain->numberOfEdgeIntervals) clockDomain->nextEdgeInterval = 0;
+	}
+	clockDomain->halfCyclesToEdge -= halfCycles;
+	if(!edges) return;
+
+	clockDomain->clockLevel ^= (edges&1);
+
+	CSBusComponent *const *const components = clockDomain->clockedComponents.awakeComponents;
+	for(unsigned int componentIndex = 0; componentIndex < clockDomain->clockedComponents.numberOfAwakeComponents; componentIndex++)
+	{
+		const CSBusComponent *const component = components[componentIndex];
+		component->bulkAdvanceFunction(
+			component->context,
+			component->filter ? csFlatBus_applyFilter((struct CSFlatBusFilter *)component->filter, totalState) : totalState,
+			edges);
+	}
+}
+
+// asks every clocked component how long it'll be until it next has something to
+// do, supposing that nothing but the clock changes, and if that's long enough to
+// be worth it then has each advance over that period; returns the number of half
+// cycles advanced, if any. Components in clock domains count in their own half
+// cycles, so their answers are converted. The caller should check that the bus
+// has settled first
+static unsigned int __attribute__((noinline)) csFlatBus_bulkAdvance(
+	CSFlatBus *const restrict flatBus,
+	CSBusComponent *const *const restrict clockedComponents,
+	const unsigned int numberOfClockedComponents,
+	const unsigned int maximumHalfCycles)
+{
+	// components that have yet to be told about their conditions mean
+	// the bus isn't really settled, as does a filter that has been
+	// invalidated, since the components behind it may now see something
+	// different
+	if(flatBus->trueComponents.hasPendingConditions || flatBus->trueFalseComponents.hasPendingConditions) return 0;
+	for(unsigned int filterIndex = 0; filterIndex < flatBus->numberOfFilters; filterIndex++)
+	{
+		const struct CSFlatBusFilter *const filter = flatBus->filters[filterIndex];
+		if(filter->needsEvaluation || filter->trueComponents.hasPendingConditions || filter->trueFalseComponents.hasPendingConditions) return 0;
+	}
+
+	CSBusState totalState = flatBus->clockedComponents.lastExternalState;
+	totalState.lineValues ^= CSBusStandardClockLine;
+
+	// nothing can be skipped beyond the next event
+	unsigned int horizon = maximumHalfCycles;
+	if(flatBus->nextEventTime - flatBus->halfCyclesToDate < horizon) horizon = (unsigned int)(flatBus->nextEventTime - flatBus->halfCyclesToDate);
+	for(unsigned int componentIndex = 0; componentIndex < numberOfClockedComponents && horizon > 1; componentIndex++)
+	{
+		const CSBusComponent *const component = clockedComponents[componentIndex];
+		unsigned int componentHorizon =
+			component->horizonFunction(
+				component->context,
+				component->currentInternalState,
+				component->filter ? csFlatBus_applyFilter((struct CSFlatBusFilter *)component->filter, totalState) : totalState);
+
+		if(componentHorizon < horizon) horizon = componentHorizon;
+	}
+
+	for(unsigned int clockDomainIndex = 0; clockDomainIndex < flatBus->numberOfClockDomains && horizon > 1; clockDomainIndex++)
+	{
+		const struct CSFlatBusClockDomain *const clockDomain = flatBus->clockDomains[clockDomainIndex];
+
+		CSBusComponent *const *const components = clockDomain->clockedComponents.awakeComponents;
+		for(unsigned int componentIndex = 0; componentIndex < clockDomain->clockedComponents.numberOfAwakeComponents && horizon > 1; componentIndex++)
+		{
+			const CSBusComponent *const component = components[componentIndex];
+			unsigned int componentHorizon =
+				csFlatBus_getClockDomainHorizon(
+					clockDomain,
+					component->horizonFunction(
+						component->context,
+						component->currentInternalState,
+						component->filter ? csFlatBus_applyFilter((struct CSFlatBusFilter *)component->filter, totalState) : totalState),
+					horizon);
+
+			if(componentHorizon < horizon) horizon = componentHorizon;
+		}
+	}
+
+	// a single half cycle is just as easily run normally
+	if(horizon < 2)
+	{
+		flatBus->bulkAdvanceBackoff = (flatBus->bulkAdvanceBackoff << 1) | 1;
+		if(flatBus->bulkAdvanceBackoff > kCSFlatBusMaximumBulkAdvanceBackoff) flatBus->bulkAdvanceBackoff = kCSFlatBusMaximumBulkAdvanceBackoff;
+		flatBus->bulkAdvanceCountdown = flatBus->bulkAdvanceBackoff;
+		return 0;
+	}
+	flatBus->bulkAdvanceBackoff = 0;
+
+	for(unsigned int componentIndex = 0; componentIndex < numberOfClockedComponents; componentIndex++)
+	{
+		const CSBusComponent *const component = clockedComponents[componentIndex];
+		component->bulkAdvanceFunction(
+			component->context,
+			component->filter ? csFlatBus_applyFilter((struct CSFlatBusFilter *)component->filter, totalState) : totalState,
+			horizon);
+	}
+
+	for(unsigned int clockDomainIndex = 0; clockDomainIndex < flatBus->numberOfClockDomains; clockDomainIndex++)
+		csFlatBus_bulkAdvanceClockDomain(flatBus->clockDomains[clockDomainIndex], horizon, totalState);
+
+	// the clock line will have toggled once per half cycle, and the bus
+	// is otherwise as it was
+	if(horizon&1)
+	{
+		flatBus->currentBusState.lineValues ^= CSBusStandardClockLine;
+		flatBus->trueComponents.lastExternalState.lineValues ^= CSBusStandardClockLine;
+		flatBus->clockedComponents.lastExternalState.lineValues ^= CSBusStandardClockLine;
+#if CSBusExtendedWords
+		flatBus->wideComponents.lastExternalState.lineValues ^= CSBusStandardClockLine;
+#endif
+	}
+
+	flatBus->halfCyclesToDate += horizon;
+	return horizon;
+}
+
+// messages whichever of the components that aren't clocked need to be told about
+// the bus having reached totalState; that's every component on a child bus
+static inline __attribute__((always_inline)) void csFlatBus_messageUnclockedComponents(
+	CSFlatBus *const restrict flatBus,
+	CSBusComponent *const *const restrict trueComponents,
+	const unsigned int numberOfTrueComponents,
+	CSBusComponent *const *const restrict trueFalseComponents,
+	const unsigned int numberOfTrueFalseComponents,
+	const CSBusState totalState,
+	const CSComponentNanoseconds timeSinceLaunch)
+{
+	// get the changed, set and reset lines
+	const uint64_t changedLines = flatBus->trueComponents.lastExternalState.lineValues ^ totalState.lineValues;
+	flatBus->trueComponents.lastExternalState = totalState;
+
+	const uint64_t setLines = totalState.lineValues & changedLines;
+	const uint64_t resetLines = setLines ^ changedLines;
+
+	// is it possible some are now true that weren't a moment ago from the true set?
+	// if so then message only those components with a condition that observes one
+	// of the lines that changed
+	const bool trueSetMayChange = flatBus->trueComponents.allObservedSetLines&setLines || flatBus->trueComponents.allObservedResetLines&resetLines;
+	csFlatBus_profileSet(&flatBus->trueComponents, trueSetMayChange);
+	if(trueSetMayChange)
+		csFlatBus_runTrueSet(&flatBus->trueComponents, trueComponents, numberOfTrueComponents, totalState, changedLines, timeSinceLaunch);
+
+	// maybe some have gone true, gone false or mutated while true from the true/false set?
+	const bool trueFalseSetMayChange =
+		!!((flatBus->trueFalseComponents.allObservedSetLines | flatBus->trueFalseComponents.allObservedResetLines | flatBus->trueFalseComponents.allObservedChangeLines)&changedLines);
+	csFlatBus_profileSet(&flatBus->trueFalseComponents, trueFalseSetMayChange);
+	if(trueFalseSetMayChange)
+		csFlatBus_runTrueFalseSet(&flatBus->trueFalseComponents, trueFalseComponents, numberOfTrueFalseComponents, totalState, changedLines, timeSinceLaunch);
+
+	// then there are those that view the bus through a filter; they need
+	// attention only if the filter might have changed what they can see
+	if(flatBus->hasFilteredSets)
+	{
+		bool anyFilterWasRun = false;
+		for(unsigned int filterIndex = 0; filterIndex < flatBus->numberOfFilters; filterIndex++)
+		{
+			struct CSFlatBusFilter *const filter = flatBus->filters[filterIndex];
+			if(filter->allObservedLines && (filter->needsEvaluation || (filter->allObservedLines & changedLines)))
+			{
+				csFlatBus_runFilteredSets(filter, totalState, timeSinceLaunch);
+				anyFilterWasRun = true;
+			}
+		}
+
+		if(anyFilterWasRun)
+		{
+			csBus_setAllLinesHigh(&flatBus->filteredState);
+			for(unsigned int filterIndex = 0; filterIndex < flatBus->numberOfFilters; filterIndex++)
+			{
+				csBus_resolve(&flatBus->filteredState, &flatBus->filters[filterIndex]->trueComponents.state);
+				csBus_resolve(&flatBus->filteredState, &flatBus->filters[filterIndex]->trueFalseComponents.state);
+			}
+		}
+	}
+
+#if CSBusExtendedWords
+	// and finally those that observe the lines beyond the first 64
+	if(!csBus_isEqual(&flatBus->wideComponents.lastExternalState, &totalState))
+		csFlatBus_runWideSet(&flatBus->wideComponents, totalState, timeSinceLaunch);
+#endif
+}
+
+// counts down to the next edge of each clock domain, messaging the components
+// of those that have reached one, as the bus's own clocked components have just been
+static void __attribute__((noinline)) csFlatBus_runClockDomains(
+	CSFlatBus *const restrict flatBus,
+	const CSBusState totalState,
+	const CSComponentNanoseconds timeSinceLaunch)
+{
+	bool anyClockDomainWasRun = false;
+
+	for(unsigned int clockDomainIndex = 0; clockDomainIndex < flatBus->numberOfClockDomains; clockDomainIndex++)
+	{
+		struct CSFlatBusClockDomain *const clockDomain = flatBus->clockDomains[clockDomainIndex];
+		if(--clockDomain->halfCyclesToEdge) continue;
+
+		clockDomain->halfCyclesToEdge = clockDomain->edgeIntervals[clockDomain->nextEdgeInterval];
+		clockDomain->nextEdgeInterval++;
+		if(clockDomain->nextEdgeInterval == clockDomain->numberOfEdgeIntervals) clockDomain->nextEdgeInterval = 0;
+		clockDomain->clockLevel ^= true;
+
+		struct CSFlatBusComponentSet *const set = &clockDomain->clockedComponents;
+		set->lastExternalState = totalState;
+		set->state = set->sleepingState;
+
+		CSBusComponent *const *const components = set->awakeComponents;
+		const bool newClockLine = clockDomain->clockLevel;
+		unsigned int componentIndex = set->numberOfAwakeComponents;
+		while(componentIndex--)
+		{
+			if(newClockLine || !components[componentIndex]->condition.signalOnTrueOnly)
+			{
+				callHandler((*components[componentIndex]), newClockLine);
+			}
+
+			csBus_resolve(&set->state, &components[componentIndex]->currentInternalState);
+		}
+
+		anyClockDomainWasRun = true;
+	}
+
+	if(anyClockDomainWasRun)
+	{
+		csBus_setAllLinesHigh(&flatBus->clockDomainState);
+		for(unsigned int clockDomainIndex = 0; clockDomainIndex < flatBus->numberOfClockDomains; clockDomainIndex++)
+			csBus_resolve(&flatBus->clockDomainState, &flatBus->clockDomains[clockDomainIndex]->clockedComponents.state);
+	}
+}
+
+#if CSBusTracksHighImpedance
+static void csFlatBus_detectConflicts(CSFlatBus *const flatBus, const uint64_t halfCycle);
+static void csFlatBus_continueConflicts(CSFlatBus *const flatBus, const uint64_t halfCycle, const unsigned int halfCycles);
+#endif
+
+// does the bus state satisfy the stop condition, given the lines that
+// have changed since it was last tested?
+static inline bool csFlatBus_meetsStopCondition(const CSBusCondition *const stopCondition, const CSBusState *const state, const CSBusState *const previousState)
+{
+#if CSBusExtendedWords
+	if(!csBusCondition_isTrue(stopCondition, state)) return false;
+
+	CSBusState changedLines;
+	csBus_setAllLinesHigh(&changedLines);
+	if(!csBusCondition_observesChanges(stopCondition, &changedLines)) return true;
+
+	csBus_getChangedLines(&changedLines, state, previousState);
+	return csBusCondition_observesChanges(stopCondition, &changedLines);
+#else
+	if(stopCondition->lineValues != (stopCondition->lineMask & state->lineValues)) return false;
+	return !stopCondition->changedLines || (stopCondition->changedLines & (state->lineValues ^ previousState->lineValues));
+#endif
+}
+
+// runs for up to the given number of half cycles, stopping early if there's a stop
+// condition or predicate and it's met; returns the number of half cycles run. Each of
+// the public entry points supplies constant arguments for all but one of the means
+// of stopping, so that the others are compiled away
+static inline __attribute__((always_inline)) unsigned int csFlatBus_run(
+	CSFlatBus *const restrict flatBus,
+	unsigned int halfCycles,
+	const CSBusCondition *const stopCondition,
+	const csFlatBus_stopPredicate stopPredicate,
+	void *const stopPredicateContext)
+{
+	CSBusState totalState, stopState;
+	const unsigned int requestedHalfCycles = halfCycles;
+
+	if(flatBus->needsSpecialisation) csFlatBus_specialise(flatBus);
+	const bool needsTimeSinceLaunch = flatBus->needsTimeSinceLaunch;
+	const bool hasClockDomains = !!flatBus->numberOfClockDomains;
+	uint64_t halfCyclesToDate = flatBus->halfCyclesToDate;
+
+	// the clocked components that are awake can change between half cycles
+	unsigned int numberOfClockedComponents = flatBus->clockedComponents.numberOfAwakeComponents;
+	CSBusComponent *const *restrict clockedComponents = flatBus->clockedComponents.awakeComponents;
+
+	unsigned int numberOfTrueFalseComponents;
+	CSBusComponent *const *const restrict trueFalseComponents = (CSBusComponent **)csPoolAllocator_getObjects(flatBus->trueFalseComponents.components, &numberOfTrueFalseComponents);
+
+	unsigned int numberOfTrueComponents;
+	CSBusComponent *const *const restrict trueComponents = (CSBusComponent **)csPoolAllocator_getObjects(flatBus->trueComponents.components, &numberOfTrueComponents);
+
+	unsigned int componentIndex;
+
+	// the bus can't know what a predicate depends on, so it mustn't skip
+	// anything while one is in use; a stop condition can't become true
+	// while the bus is settled unless it observes the clock
+	const bool mayEverBulkAdvance =
+		!stopPredicate &&
+		!(stopCondition && (csBusCondition_observedLines(*stopCondition) & CSBusStandardClockLine));
+	bool mayBulkAdvance = mayEverBulkAdvance && csFlatBus_mayBulkAdvance(flatBus);
+	if(stopCondition) csFlatBus_getTotalState(flatBus, &stopState);
+
+	while(halfCycles)
+	{
+		// components go to sleep and wake up only between half cycles
+		if(flatBus->numberOfPendingSleepChanges)
+		{
+			csFlatBus_applySleepChanges(flatBus);
+			numberOfClockedComponents = flatBus->clockedComponents.numberOfAwakeComponents;
+			clockedComponents = flatBus->clockedComponents.awakeComponents;
+			mayBulkAdvance = mayEverBulkAdvance && csFlatBus_mayBulkAdvance(flatBus);
+		}
+
+		// if the last half cycle changed nothing then the bus has settled, so the next
+		// will differ only in the clock line; see whether the whole lot can be advanced
+		// over a period in which there's nothing else to do. Asking isn't free, so
+		// back off for a while after each time the answer is no
+		if(
+			mayBulkAdvance &&
+			!(flatBus->bulkAdvanceCountdown && flatBus->bulkAdvanceCountdown--) &&
+			csFlatBus_hasSettled(flatBus))
+		{
+			unsigned int quietHalfCycles = csFlatBus_bulkAdvance(flatBus, clockedComponents, numberOfClockedComponents, halfCycles);
+			if(quietHalfCycles)
+			{
+#if CSBusTracksHighImpedance
+				csFlatBus_continueConflicts(flatBus, halfCyclesToDate, quietHalfCycles);
+#endif
+				halfCycles -= quietHalfCycles;
+				halfCyclesToDate += quietHalfCycles;
+				continue;
+			}
+		}
+
+		halfCycles--;
+		const CSComponentNanoseconds timeSinceLaunch = needsTimeSinceLaunch ? csFlatBus_getTimeSinceLaunch(flatBus, halfCyclesToDate) : 0;
+		flatBus->currentBusState.lineValues ^= CSBusStandardClockLine;
+
+		// get total state as viewed from the true and true/false components
+		csFlatBus_getTotalState(flatBus, &totalState);
+
+		csFlatBus_messageUnclockedComponents(
+			flatBus,
+			trueComponents, numberOfTrueComponents,
+			trueFalseComponents, numberOfTrueFalseComponents,
+			totalState, timeSinceLaunch);
+
+		if(flatBus->numberOfPassiveObservers)
+			csFlatBus_recordHistory(flatBus, &totalState, halfCyclesToDate);
+
+		// get total state as viewed from the true and true/false components
+		csFlatBus_getTotalState(flatBus, &totalState);
+
+		// hence get the changed, set and reset lines
+		flatBus->clockedComponents.lastExternalState = totalState;
+		flatBus->clockedComponents.state = flatBus->clockedComponents.sleepingState;
+
+		componentIndex = numberOfClockedComponents;
+		bool newClockLine = !!(flatBus->currentBusState.lineValues & CSBusStandardClockLine);
+		while(componentIndex--)
+		{
+			if(newClockLine || !clockedComponents[componentIndex]->condition.signalOnTrueOnly)
+			{
+				callHandler((*clockedComponents[componentIndex]), newClockLine);
+			}
+
+			csBus_resolve(&flatBus->clockedComponents.state, &clockedComponents[componentIndex]->currentInternalState);
+		}
+
+		// the clock domains' output is carried along with that of the bus's own
+		// clocked components, as both change only on clock edges
+		if(hasClockDomains)
+		{
+			csFlatBus_runClockDomains(flatBus, totalState, timeSinceLaunch);
+			csBus_resolve(&flatBus->clockedComponents.state, &flatBus->clockDomainState);
+		}
+
+		if(halfCyclesToDate == flatBus->nextEventTime)
+			csFlatBus_performEvents(flatBus);
+
+#if CSBusTracksHighImpedance
+		csFlatBus_detectConflicts(flatBus, halfCyclesToDate);
+#endif
+
+		halfCyclesToDate++;
+		flatBus->halfCyclesToDate = halfCyclesToDate;
+
+		if(stopPredicate && stopPredicate(stopPredicateContext)) break;
+		if(stopCondition)
+		{
+			const CSBusState previousStopState = stopState;
+			csFlatBus_getTotalState(flatBus, &stopState);
+			if(csFlatBus_meetsStopCondition(stopCondition, &stopState, &previousStopState)) break;
+		}
+	}
+
+	// passive observers catch up once the bus has stopped
+	for(unsigned int index = 0; index < flatBus->numberOfPassiveObservers; index++)
+		csFlatBus_flushPassiveObserver(flatBus->passiveObservers[index]);
+
+	return requestedHalfCycles - halfCycles;
+}
+
+void csFlatBus_runForHalfCycles(void *bus, unsigned int halfCycles)
+{
+	csFlatBus_run((CSFlatBus *)bus, halfCycles, NULL, NULL, NULL);
+}
+
+unsigned int csFlatBus_runUntil(void *bus, unsigned int maxHalfCycles, CSBusCondition stopCondition)
+{
+	return csFlatBus_run((CSFlatBus *)bus, maxHalfCycles, &stopCondition, NULL, NULL);
+}
+
+unsigned int csFlatBus_runUntilPredicate(void *bus, unsigned int maxHalfCycles, csFlatBus_stopPredicate predicate, void *context)
+{
+	return csFlatBus_run((CSFlatBus *)bus, maxHalfCycles, NULL, predicate, context);
+}
+
+// a bridge is a component on the parent bus that steps the child bus whenever
+// it is messaged, and outputs whatever the components on the child bus output
+// for as long as its condition is true
+typedef struct
+{
+	CSReferenceCountedObject referenceCountedObject;
+
+	CSFlatBus *parent, *child;
+} CSFlatBusBridge;
+
+static void csFlatBus_destroyBridge(void *opaqueBridge)
+{
+	CSFlatBusBridge *bridge = (CSFlatBusBridge *)opaqueBridge;
+	csObject_release(bridge->child);
+}
 
-typedef struct
+csComponent_observer(csFlatBus_observeBridge)
 {
-	CSReferenceCountedObject referenceCountedObject;
+	CSFlatBusBridge *const bridge = (CSFlatBusBridge *)context;
+	CSFlatBus *const child = bridge->child;
 
-	struct CSFlatBusComponentSet
-	{
-		void *components;
-		CSBusState state;
-		CSBusState lastExternalState;
-		uint64_t allObservedSetLines, allObservedResetLines, allObservedChangeLines;
-	} clockedComponents, trueFalseComponents, trueComponents;
+	// the child sees the parent bus as its own, as of the parent's time
+	child->halfCyclesToDate = bridge->parent->halfCyclesToDate;
+	child->currentBusState = externalState;
+	if(child->numberOfPendingSleepChanges) csFlatBus_applySleepChanges(child);
 
-	CSBusState currentBusState;
-	unsigned int halfCyclesToDate;
-	CSRateConverterState time;
+	// child buses are always frozen, so their sets are as they were when bridged
+	unsigned int numberOfTrueComponents, numberOfTrueFalseComponents;
+	CSBusComponent *const *const trueComponents = (CSBusComponent **)csPoolAllocator_getObjects(child->trueComponents.components, &numberOfTrueComponents);
+	CSBusComponent *const *const trueFalseComponents = (CSBusComponent **)csPoolAllocator_getObjects(child->trueFalseComponents.components, &numberOfTrueFalseComponents);
 
-	csComponent_prefilter filterFunction;
-	void *filterFunctionContext;
-} CSFlatBus;
+	CSBusState totalState;
+	csFlatBus_getTotalState(child, &totalState);
+	csFlatBus_messageUnclockedComponents(
+		child,
+		trueComponents, numberOfTrueComponents,
+		trueFalseComponents, numberOfTrueFalseComponents,
+		totalState, timeSinceLaunch);
 
-static void csFlatBus_updateSetForNewComponent(struct CSFlatBusComponentSet *set)
-{
-	set->allObservedSetLines = 0;
-	set->allObservedResetLines = 0;
-	set->allObservedChangeLines = 0;
+	// once deselected, the child bus is disconnected from its parent; its
+	// components have had one last look so that they can notice as much
+	csBus_setAllLinesHigh(internalState);
+	if(conditionIsTrue)
+		csFlatBus_resolveComponentOutputs(child, internalState);
+}
 
+// a bus needs to work out the time if any of its components need it,
+// including those on a child bus, which receive it via their bridge
+static bool csFlatBus_setNeedsTimeSinceLaunch(const struct CSFlatBusComponentSet *const set)
+{
 	unsigned int numberOfComponents;
-	CSBusComponent *components = (CSBusComponent *)csAllocatingArray_getCArray(set->components, &numberOfComponents);
-	for(unsigned int c = 0; c < numberOfComponents; c++)
+	CSBusComponent *const *const components = (CSBusComponent **)csPoolAllocator_getObjects(set->components, &numberOfComponents);
+
+	for(unsigned int componentIndex = 0; componentIndex < numberOfComponents; componentIndex++)
 	{
-		uint64_t changedLines = components[c].condition.changedLines;
-		uint64_t lineMask = components[c].condition.lineMask;
-		uint64_t lineValues = components[c].condition.lineValues;
+		if(components[componentIndex]->needsTimeSinceLaunch) return true;
+		if(
+			components[componentIndex]->handlerFunction == csFlatBus_observeBridge &&
+			csFlatBus_needsTimeSinceLaunch(((CSFlatBusBridge *)components[componentIndex]->context)->child))
+			return true;
+	}
+
+	return false;
+}
+
+static bool csFlatBus_needsTimeSinceLaunch(CSFlatBus *const flatBus)
+{
+	if(
+		csFlatBus_setNeedsTimeSinceLaunch(&flatBus->clockedComponents) ||
+		csFlatBus_setNeedsTimeSinceLaunch(&flatBus->trueComponents) ||
+		csFlatBus_setNeedsTimeSinceLaunch(&flatBus->trueFalseComponents))
+		return true;
+#if CSBusExtendedWords
+	if(csFlatBus_setNeedsTimeSinceLaunch(&flatBus->wideComponents)) return true;
+#endif
 
-		uint64_t setLineMask = lineMask & lineValues;
-		uint64_t resetLineMask = lineMask & ~lineValues;
-		uint64_t changeLineMask = changedLines &~ (setLineMask | resetLineMask);
+	for(unsigned int filterIndex = 0; filterIndex < flatBus->numberOfFilters; filterIndex++)
+	{
+		if(
+			csFlatBus_setNeedsTimeSinceLaunch(&flatBus->filters[filterIndex]->trueComponents) ||
+			csFlatBus_setNeedsTimeSinceLaunch(&flatBus->filters[filterIndex]->trueFalseComponents))
+			return true;
+	}
 
-		set->allObservedSetLines |= setLineMask;// | changeLineMask;
-		set->allObservedResetLines |= resetLineMask;// | changeLineMask;
-		set->allObservedChangeLines |= changeLineMask;
+	for(unsigned int clockDomainIndex = 0; clockDomainIndex < flatBus->numberOfClockDomains; clockDomainIndex++)
+	{
+		if(csFlatBus_setNeedsTimeSinceLaunch(&flatBus->clockDomains[clockDomainIndex]->clockedComponents))
+			return true;
 	}
+
+	return false;
 }
 
-static void csFlatBus_initialiseSet(struct CSFlatBusComponentSet *set)
+void *csFlatBus_createBridge(
+	void *opaqueParentBus,
+	void *opaqueChildBus,
+	CSBusCondition selectionCondition,
+	uint64_t outputLines)
 {
-	set->components = csAllocatingArray_createWithObjectSize(sizeof(CSBusComponent), true);
-	set->state = csBus_defaultState();
-	set->lastExternalState = csBus_defaultState();
+	CSFlatBus *const parent = (CSFlatBus *)opaqueParentBus;
+	CSFlatBus *const child = (CSFlatBus *)opaqueChildBus;
+
+	// the child bus can't acquire any more components from here on, so
+	// it can be frozen now, and its observed lines are known
+	csFlatBus_freeze(child);
+
+	CSFlatBusBridge *const bridge = (CSFlatBusBridge *)calloc(1, sizeof(CSFlatBusBridge));
+	if(!bridge) return NULL;
+
+	csObject_init(bridge);
+	bridge->referenceCountedObject.dealloc = csFlatBus_destroyBridge;
+	bridge->referenceCountedObject.type = "bus bridge";
+	bridge->parent = parent;
+	bridge->child = csObject_retain(child);
+
+	// the bridge needs to be told when it's deselected, and about any change
+	// to the lines that the components on the child bus observe while selected
+	selectionCondition.signalOnTrueOnly = false;
+	selectionCondition.changedLines |=
+		child->trueComponents.allObservedSetLines | child->trueComponents.allObservedResetLines | child->trueComponents.allObservedChangeLines |
+		child->trueFalseComponents.allObservedSetLines | child->trueFalseComponents.allObservedResetLines | child->trueFalseComponents.allObservedChangeLines;
+	for(unsigned int filterIndex = 0; filterIndex < child->numberOfFilters; filterIndex++)
+		selectionCondition.changedLines |= child->filters[filterIndex]->allObservedLines;
+
+#if CSBusExtendedWords
+	unsigned int numberOfWideComponents;
+	CSBusComponent *const *const wideComponents = (CSBusComponent **)csPoolAllocator_getObjects(child->wideComponents.components, &numberOfWideComponents);
+	for(unsigned int componentIndex = 0; componentIndex < numberOfWideComponents; componentIndex++)
+	{
+		selectionCondition.changedLines |= csBusCondition_observedLines(wideComponents[componentIndex]->condition);
+		for(int word = 0; word < CSBusExtendedWords; word++)
+			selectionCondition.extendedChangedLines[word] |=
+				wideComponents[componentIndex]->condition.extendedChangedLines[word] | wideComponents[componentIndex]->condition.extendedLineMask[word];
+	}
+#endif
+
+	void *component = csFlatBus_createComponent(parent, csFlatBus_observeBridge, selectionCondition, outputLines, bridge);
+	csObject_release(bridge);
+
+	return component;
 }
 
-static void csFlatBus_destroySet(struct CSFlatBusComponentSet *set)
+// a multi-condition component is filed under a condition of its own: the lines
+// that all of its conditions test, with the values that they all expect, and a
+// watch for changes on everything else that any of them observes. Its handler
+// then tests each condition and passes on whatever would have been messaged
+typedef struct
 {
-	csObject_release(set->components);
+	CSReferenceCountedObject referenceCountedObject;
+
+	csComponent_multiConditionHandlerFunction function;
+	void *context;
+
+	CSBusCondition conditions[kCSFlatBusMaximumConditions];
+	unsigned int numberOfConditions;
+	uint32_t trueConditions, signalOnTrueOnlyConditions;
+	CSBusState lastExternalState;
+} CSFlatBusMultiCondition;
+
+static void csFlatBus_destroyMultiCondition(void *opaqueMultiCondition)
+{
+	CSFlatBusMultiCondition *multiCondition = (CSFlatBusMultiCondition *)opaqueMultiCondition;
+	csObject_release(multiCondition->context);
 }
 
-void csFlatBus_setModalComponentFilter(
-	void *opaqueBus,
-	csComponent_prefilter filterFunction,
-	void *context)
+csComponent_observer(csFlatBus_observeMultipleConditions)
 {
-	CSFlatBus *flatBus = (CSFlatBus *)opaqueBus;
-	flatBus->filterFunctionContext = context;
-	flatBus->filterFunction = filterFunction;
+	CSFlatBusMultiCondition *const multiCondition = (CSFlatBusMultiCondition *)context;
+	const uint32_t wereTrue = multiCondition->trueConditions;
+	uint32_t trueConditions = 0, observedChanges = 0;
+
+	// if the common condition is false then so are all the others;
+	// otherwise each needs to be tested
+	if(conditionIsTrue)
+	{
+#if CSBusExtendedWords
+		CSBusState changedLines;
+		csBus_getChangedLines(&changedLines, &multiCondition->lastExternalState, &externalState);
+#else
+		const uint64_t changedLines = multiCondition->lastExternalState.lineValues ^ externalState.lineValues;
+#endif
+
+		for(unsigned int index = 0; index < multiCondition->numberOfConditions; index++)
+		{
+			const CSBusCondition *const condition = &multiCondition->conditions[index];
+#if CSBusExtendedWords
+			trueConditions |= (uint32_t)csBusCondition_isTrue(condition, &externalState) << index;
+			observedChanges |= (uint32_t)csBusCondition_observesChanges(condition, &changedLines) << index;
+#else
+			trueConditions |= (uint32_t)(condition->lineValues == (condition->lineMask&externalState.lineValues)) << index;
+			observedChanges |= (uint32_t)!!(condition->changedLines&changedLines) << index;
+#endif
+		}
+	}
+
+	multiCondition->lastExternalState = externalState;
+	multiCondition->trueConditions = trueConditions;
+
+	// as for any other component, those conditions that asked to be told only
+	// about becoming true are told about nothing else; the others are told about
+	// becoming true or false, and about changes while true
+	const uint32_t signalOnTrueOnlyConditions = multiCondition->signalOnTrueOnlyConditions;
+	const uint32_t messagedConditions =
+		(trueConditions & ~wereTrue) |
+		(((wereTrue & ~trueConditions) | (trueConditions & observedChanges)) & ~signalOnTrueOnlyConditions);
+
+	if(messagedConditions)
+		multiCondition->function(multiCondition->context, internalState, externalState, trueConditions, messagedConditions, timeSinceLaunch);
 }
 
-void *csFlatBus_createComponent(
+void *csFlatBus_createMultiConditionComponent(
 	void *opaqueBus,
-	csComponent_handlerFunction function,
-	CSBusCondition necessaryCondition,
+	csComponent_multiConditionHandlerFunction function,
+	const CSBusCondition *conditions,
+	unsigned int numberOfConditions,
 	uint64_t outputLines,
 	void *context)
-
 {
-	CSFlatBus *flatBus = (CSFlatBus *)opaqueBus;
-	CSBusComponent *component;
-	struct CSFlatBusComponentSet *set;
+	if(numberOfConditions > kCSFlatBusMaximumConditions) return NULL;
 
-	// add the new component to the clocked set if it observes the clock line,
-	// the unclocked set otherwise
-	if(csBusCondition_observedLines(necessaryCondition) == CSBusStandardClockLine)
+	CSFlatBusMultiCondition *const multiCondition = (CSFlatBusMultiCondition *)calloc(1, sizeof(CSFlatBusMultiCondition));
+	if(!multiCondition) return NULL;
+
+	// the component takes its type from the multi-condition, which
+	// takes it from the context
+	csObject_init(multiCondition);
+	multiCondition->referenceCountedObject.dealloc = csFlatBus_destroyMultiCondition;
+	if(context) multiCondition->referenceCountedObject.type = ((CSReferenceCountedObject *)context)->type;
+	multiCondition->function = function;
+	multiCondition->context = csObject_retain(context);
+	multiCondition->numberOfConditions = numberOfConditions;
+	multiCondition->lastExternalState = csBus_defaultState();
+
+	// find the lines that every possible condition tests for the same value,
+	// and all those that any of them observes
+	uint64_t commonLines = ~0llu, commonValues = 0, observedLines = 0;
+	bool anyIsPossible = false;
+	for(unsigned int index = 0; index < numberOfConditions; index++)
 	{
-		set = &flatBus->clockedComponents;
+		multiCondition->conditions[index] = conditions[index];
+		if(conditions[index].signalOnTrueOnly) multiCondition->signalOnTrueOnlyConditions |= 1u << index;
+		if(csBusCondition_isImpossible(conditions[index])) continue;
+
+		const uint64_t lineValues = conditions[index].lineValues & conditions[index].lineMask;
+		if(!anyIsPossible) commonValues = lineValues;
+		anyIsPossible = true;
+
+		commonLines &= conditions[index].lineMask & ~(lineValues ^ commonValues);
+		observedLines |= conditions[index].lineMask | conditions[index].changedLines;
 	}
-	else
+
+	CSBusCondition condition = csBus_impossibleCondition();
+	if(anyIsPossible)
 	{
-		if(necessaryCondition.signalOnTrueOnly)
-			set = &flatBus->trueComponents;
-		else
-			set = &flatBus->trueFalseComponents;
+		condition = csBus_maskCondition(observedLines & ~commonLines, commonLines, commonValues & commonLines, false);
+
+#if CSBusExtendedWords
+		// lines beyond the first 64 are just watched for changes
+		for(unsigned int index = 0; index < numberOfConditions; index++)
+		{
+			if(csBusCondition_isImpossible(conditions[index])) continue;
+			for(int word = 0; word < CSBusExtendedWords; word++)
+				condition.extendedChangedLines[word] |= conditions[index].extendedLineMask[word] | conditions[index].extendedChangedLines[word];
+		}
+#endif
 	}
 
-	component = csAllocatingArray_newObject(set->components);
-	csComponent_init(component, function, necessaryCondition, outputLines, context);
-	csFlatBus_updateSetForNewComponent(set);
+	void *component = csFlatBus_createComponent(opaqueBus, csFlatBus_observeMultipleConditions, condition, outputLines, multiCondition);
+	csObject_release(multiCondition);
+
+	return component;
+}
+
+#if CSFlatBusProfile
+
+// the profile is collected into one row per type of component
+struct CSFlatBusProfileRow
+{
+	const char *type;
+	unsigned int numberOfComponents;
+	uint64_t conditionEvaluations, conditionHits, handlerCalls;
+	double handlerTicks;
+};
 
-	if(flatBus->filterFunction)
+struct CSFlatBusProfileReport
+{
+	struct CSFlatBusProfileRow *rows;
+	unsigned int numberOfRows;
+	double totalHandlerTicks;
+};
+
+static void csFlatBus_collectComponentProfile(struct CSFlatBusProfileReport *const profile, const CSBusComponent *const component)
+{
+	const char *const type = component->referenceCountedObject.type ? component->referenceCountedObject.type : "(untyped)";
+
+	unsigned int rowIndex = 0;
+	while(rowIndex < profile->numberOfRows && strcmp(profile->rows[rowIndex].type, type)) rowIndex++;
+	if(rowIndex == profile->numberOfRows)
 	{
-		csComponent_setPreFilter(component, flatBus->filterFunction, flatBus->filterFunctionContext);
+		struct CSFlatBusProfileRow *const newRows = (struct CSFlatBusProfileRow *)realloc(profile->rows, sizeof(struct CSFlatBusProfileRow) * (profile->numberOfRows + 1));
+		if(!newRows) return;
+		profile->rows = newRows;
+		memset(&profile->rows[rowIndex], 0, sizeof(struct CSFlatBusProfileRow));
+		profile->rows[rowIndex].type = type;
+		profile->numberOfRows++;
 	}
 
-	return component;
+	// only some calls were timed, so scale up from those
+	struct CSFlatBusProfileRow *const row = &profile->rows[rowIndex];
+	const double handlerTicks = component->profile.sampledHandlerCalls ?
+		(double)component->profile.sampledHandlerTicks * (double)component->profile.handlerCalls / (double)component->profile.sampledHandlerCalls : 0.0;
+
+	row->numberOfComponents++;
+	row->conditionEvaluations += component->profile.conditionEvaluations;
+	row->conditionHits += component->profile.conditionHits;
+	row->handlerCalls += component->profile.handlerCalls;
+	row->handlerTicks += handlerTicks;
 }
 
-unsigned int csFlatBus_getHalfCyclesToDate(void *opaqueBus)
+// visits every component set on the bus and, via their bridges, on its child buses;
+// the visitor is given a name for each set, for the purposes of reporting
+typedef void (* csFlatBus_profileSetVisitor)(struct CSFlatBusComponentSet *set, const char *name, unsigned int depth, void *context);
+
+static void csFlatBus_visitProfileSets(CSFlatBus *const flatBus, csFlatBus_profileSetVisitor visitor, unsigned int depth, void *context)
 {
-	return ((CSFlatBus *)opaqueBus)->halfCyclesToDate;
+	struct CSFlatBusComponentSet *sets[] =
+	{
+		&flatBus->clockedComponents, &flatBus->trueComponents, &flatBus->trueFalseComponents,
+#if CSBusExtendedWords
+		&flatBus->wideComponents,
+#endif
+	};
+	const char *const names[] =
+	{
+		"clocked", "true", "true/false",
+#if CSBusExtendedWords
+		"wide",
+#endif
+	};
+
+	for(unsigned int setIndex = 0; setIndex < sizeof(sets) / sizeof(sets[0]); setIndex++)
+		visitor(sets[setIndex], names[setIndex], depth, context);
+
+	for(unsigned int filterIndex = 0; filterIndex < flatBus->numberOfFilters; filterIndex++)
+	{
+		visitor(&flatBus->filters[filterIndex]->trueComponents, "filtered true", depth, context);
+		visitor(&flatBus->filters[filterIndex]->trueFalseComponents, "filtered true/false", depth, context);
+	}
+
+	for(unsigned int clockDomainIndex = 0; clockDomainIndex < flatBus->numberOfClockDomains; clockDomainIndex++)
+		visitor(&flatBus->clockDomains[clockDomainIndex]->clockedComponents, flatBus->clockDomains[clockDomainIndex]->name, depth, context);
+
+	for(unsigned int setIndex = 0; setIndex < sizeof(sets) / sizeof(sets[0]); setIndex++)
+	{
+		unsigned int numberOfComponents;
+		CSBusComponent *const *const components = (CSBusComponent **)csPoolAllocator_getObjects(sets[setIndex]->components, &numberOfComponents);
+		for(unsigned int componentIndex = 0; componentIndex < numberOfComponents; componentIndex++)
+		{
+			if(components[componentIndex]->handlerFunction == csFlatBus_observeBridge)
+				csFlatBus_visitProfileSets(((CSFlatBusBridge *)components[componentIndex]->context)->child, visitor, depth+1, context);
+		}
+	}
 }
 
-void csFlatBus_runForHalfCycles(void *context, unsigned int halfCycles)
+static void csFlatBus_collectSetProfile(struct CSFlatBusComponentSet *set, const char *name, unsigned int depth, void *context)
 {
-	CSFlatBus *const restrict flatBus = (CSFlatBus *)context;
-	CSBusState totalState;
-	uint64_t changedLines, setLines, resetLines;
-	CSRateConverterState time = flatBus->time;
-	unsigned int halfCyclesToDate = flatBus->halfCyclesToDate;
+	unsigned int numberOfComponents;
+	CSBusComponent *const *const components = (CSBusComponent **)csPoolAllocator_getObjects(set->components, &numberOfComponents);
+	for(unsigned int componentIndex = 0; componentIndex < numberOfComponents; componentIndex++)
+		csFlatBus_collectComponentProfile((struct CSFlatBusProfileReport *)context, components[componentIndex]);
+}
 
-	unsigned int numberOfClockedComponents;
-	CSBusComponent *const restrict clockedComponents = (CSBusComponent *)csAllocatingArray_getCArray(flatBus->clockedComponents.components, &numberOfClockedComponents);
+static void csFlatBus_printSetProfile(struct CSFlatBusComponentSet *set, const char *name, unsigned int depth, void *context)
+{
+	// the clocked set and the wide set are never skipped, so aren't counted
+	unsigned int numberOfComponents;
+	csPoolAllocator_getObjects(set->components, &numberOfComponents);
+	const uint64_t total = set->profileRuns + set->profileSkips;
+	if(!numberOfComponents || !total) return;
 
-	unsigned int numberOfTrueFalseComponents;
-	CSBusComponent *const restrict trueFalseComponents = (CSBusComponent *)csAllocatingArray_getCArray(flatBus->trueFalseComponents.components, &numberOfTrueFalseComponents);
+	fprintf((FILE *)context, "%*s%-*s %10u %14llu %14llu %7.1f%%\n",
+		depth*2, "", 28 - depth*2, name,
+		numberOfComponents,
+		(unsigned long long)set->profileRuns,
+		(unsigned long long)set->profileSkips,
+		100.0 * (double)set->profileSkips / (double)total);
+}
 
-	unsigned int numberOfTrueComponents;
-	CSBusComponent *const restrict trueComponents = (CSBusComponent *)csAllocatingArray_getCArray(flatBus->trueComponents.components, &numberOfTrueComponents);
+static void csFlatBus_resetSetProfile(struct CSFlatBusComponentSet *set, const char *name, unsigned int depth, void *context)
+{
+	unsigned int numberOfComponents;
+	CSBusComponent *const *const components = (CSBusComponent **)csPoolAllocator_getObjects(set->components, &numberOfComponents);
+	for(unsigned int componentIndex = 0; componentIndex < numberOfComponents; componentIndex++)
+		memset(&components[componentIndex]->profile, 0, sizeof(components[componentIndex]->profile));
 
-	unsigned int componentIndex;
+	set->profileRuns = set->profileSkips = 0;
+}
 
-#define callHandler(x, status) \
-	x.handlerFunction(\
-		x.context,\
-		&x.currentInternalState,\
-		x.preFilter ? x.preFilter(x.preFilterContext, totalState ) : totalState,\
-		status,\
-		csRateConverter_getLocation(time))
+static int csFlatBus_compareProfileRows(const void *a, const void *b)
+{
+	const double ticksA = ((const struct CSFlatBusProfileRow *)a)->handlerTicks;
+	const double ticksB = ((const struct CSFlatBusProfileRow *)b)->handlerTicks;
+	return (ticksA < ticksB) - (ticksA > ticksB);
+}
+
+void csFlatBus_printProfile(void *opaqueBus, FILE *stream)
+{
+	struct CSFlatBusProfileReport profile = {NULL, 0, 0.0};
+	csFlatBus_visitProfileSets((CSFlatBus *)opaqueBus, csFlatBus_collectSetProfile, 0, &profile);
+
+	qsort(profile.rows, profile.numberOfRows, sizeof(struct CSFlatBusProfileRow), csFlatBus_compareProfileRows);
+	for(unsigned int rowIndex = 0; rowIndex < profile.numberOfRows; rowIndex++)
+		profile.totalHandlerTicks += profile.rows[rowIndex].handlerTicks;
 
-	while(halfCycles--)
+	fprintf(stream, "%-40s %5s %14s %14s %14s %16s %10s %7s\n",
+		"component type", "count", "evaluations", "hits", "calls", "handler ticks", "per call", "share");
+	for(unsigned int rowIndex = 0; rowIndex < profile.numberOfRows; rowIndex++)
 	{
-		flatBus->currentBusState.lineValues ^= CSBusStandardClockLine;
+		const struct CSFlatBusProfileRow *const row = &profile.rows[rowIndex];
+		fprintf(stream, "%-40s %5u %14llu %14llu %14llu %16.0f %10.1f %6.1f%%\n",
+			row->type,
+			row->numberOfComponents,
+			(unsigned long long)row->conditionEvaluations,
+			(unsigned long long)row->conditionHits,
+			(unsigned long long)row->handlerCalls,
+			row->handlerTicks,
+			row->handlerCalls ? row->handlerTicks / (double)row->handlerCalls : 0.0,
+			profile.totalHandlerTicks > 0.0 ? 100.0 * row->handlerTicks / profile.totalHandlerTicks : 0.0);
+	}
+	free(profile.rows);
 
-		// get total state as viewed from the true and true/false components
-		totalState.lineValues = flatBus->currentBusState.lineValues & flatBus->trueComponents.state.lineValues & flatBus->trueFalseComponents.state.lineValues & flatBus->clockedComponents.state.lineValues;
+	fprintf(stream, "\n%-28s %10s %14s %14s %8s\n", "set (child buses indented)", "components", "runs", "skips", "skipped");
+	csFlatBus_visitProfileSets((CSFlatBus *)opaqueBus, csFlatBus_printSetProfile, 0, stream);
+}
 
-		// hence get the changed, set and reset lines
-		changedLines = flatBus->trueComponents.lastExternalState.lineValues ^ totalState.lineValues;
-		flatBus->trueComponents.lastExternalState = totalState;
+void csFlatBus_resetProfile(void *opaqueBus)
+{
+	csFlatBus_visitProfileSets((CSFlatBus *)opaqueBus, csFlatBus_resetSetProfile, 0, NULL);
+}
 
-		setLines = totalState.lineValues & changedLines;
-		resetLines = setLines ^ changedLines;
+#else
 
-		// is it possible some are now true that weren't a moment ago from the true set?
-		if(flatBus->trueComponents.allObservedSetLines&setLines || flatBus->trueComponents.allObservedResetLines&resetLines)
-		{
-			flatBus->trueComponents.state.lineValues = ~0llu;
+void csFlatBus_printProfile(void *opaqueBus, FILE *stream)
+{
+	fprintf(stream, "bus profiling isn't available; build with CSFlatBusProfile defined as 1\n");
+}
 
-			componentIndex = numberOfTrueComponents;
-			while(componentIndex--)
-			{
-				// if one of the monitored lines just changed and the condition is now true,
-				// it can't have been before so this is a time to message
-				if(
-					(trueComponents[componentIndex].condition.lineMask&changedLines) &&
-					(trueComponents[componentIndex].condition.lineValues == (trueComponents[componentIndex].condition.lineMask&totalState.lineValues)))
-				{
-					callHandler(trueComponents[componentIndex], true);
-				}
+void csFlatBus_resetProfile(void *opaqueBus)
+{
+}
 
-				flatBus->trueComponents.state.lineValues &= trueComponents[componentIndex].currentInternalState.lineValues;
-			}
+#endif
+
+#if CSBusTracksHighImpedance
+
+// the log of conflicts keeps at most this many runs of half cycles
+#ifndef kCSFlatBusMaximumConflicts
+#define kCSFlatBusMaximumConflicts	1024
+#endif
+
+// visits every component on the bus that's currently able to drive it, including
+// those on any child bus that's currently selected; the bridge itself is skipped
+typedef void (* csFlatBus_driverVisitor)(const CSBusComponent *component, void *context);
+
+static void csFlatBus_visitDriverSet(const struct CSFlatBusComponentSet *const set, csFlatBus_driverVisitor visitor, void *context);
+
+static void csFlatBus_visitDrivers(const CSFlatBus *const flatBus, csFlatBus_driverVisitor visitor, void *context)
+{
+	csFlatBus_visitDriverSet(&flatBus->clockedComponents, visitor, context);
+	csFlatBus_visitDriverSet(&flatBus->trueComponents, visitor, context);
+	csFlatBus_visitDriverSet(&flatBus->trueFalseComponents, visitor, context);
+#if CSBusExtendedWords
+	csFlatBus_visitDriverSet(&flatBus->wideComponents, visitor, context);
+#endif
+
+	for(unsigned int filterIndex = 0; filterIndex < flatBus->numberOfFilters; filterIndex++)
+	{
+		csFlatBus_visitDriverSet(&flatBus->filters[filterIndex]->trueComponents, visitor, context);
+		csFlatBus_visitDriverSet(&flatBus->filters[filterIndex]->trueFalseComponents, visitor, context);
+	}
+
+	for(unsigned int clockDomainIndex = 0; clockDomainIndex < flatBus->numberOfClockDomains; clockDomainIndex++)
+		csFlatBus_visitDriverSet(&flatBus->clockDomains[clockDomainIndex]->clockedComponents, visitor, context);
+}
+
+static void csFlatBus_visitDriverSet(const struct CSFlatBusComponentSet *const set, csFlatBus_driverVisitor visitor, void *context)
+{
+	unsigned int numberOfComponents;
+	CSBusComponent *const *const components = (CSBusComponent **)csPoolAllocator_getObjects(set->components, &numberOfComponents);
+
+	for(unsigned int componentIndex = 0; componentIndex < numberOfComponents; componentIndex++)
+	{
+		const CSBusComponent *const component = components[componentIndex];
+		if(component->handlerFunction != csFlatBus_observeBridge)
+		{
+			visitor(component, context);
+			continue;
 		}
 
-		// maybe some have gone true or mutated while true from the true/false set?
+		// a deselected bridge outputs nothing at all, and is otherwise just
+		// the sum of the components on the other side of it
 		if(
-			(flatBus->trueFalseComponents.allObservedSetLines&setLines) || 
-			(flatBus->trueFalseComponents.allObservedResetLines&resetLines) ||
-			(flatBus->trueFalseComponents.allObservedChangeLines&changedLines))
-		{
-			flatBus->trueFalseComponents.state.lineValues = ~0llu;
+			~component->currentInternalState.lineValues ||
+			~component->currentInternalState.highImpedanceMask)
+			csFlatBus_visitDrivers(((CSFlatBusBridge *)component->context)->child, visitor, context);
+	}
+}
 
-			componentIndex = numberOfTrueFalseComponents;
-			while(componentIndex--)
-			{
-				// so, logic is:
-				//
-				//	if
-				//			mask condition has changed, or
-				//			mask condition is true and one of the other monitored lines has changed
-				bool newEvaluation = trueFalseComponents[componentIndex].condition.lineValues == (trueFalseComponents[componentIndex].condition.lineMask&totalState.lineValues);
-
-				if(
-					(newEvaluation != trueFalseComponents[componentIndex].lastResult) || (newEvaluation && trueFalseComponents[componentIndex].condition.changedLines&changedLines))
-				{
-					callHandler(trueFalseComponents[componentIndex], newEvaluation);
-					trueFalseComponents[componentIndex].lastResult = newEvaluation;
-				}
+struct CSFlatBusDrivers
+{
+	uint64_t drivenHigh, drivenLow;
+	uint64_t contestedLines;
+	const CSBusComponent *componentDrivingHigh, *componentDrivingLow;
+};
 
-				flatBus->trueFalseComponents.state.lineValues &= trueFalseComponents[componentIndex].currentInternalState.lineValues;
-			}
-		}
-		else
-		{
-			// nobody has become true or mutated, so check everyone that's currently true to see if they've become false
-			if( (flatBus->trueFalseComponents.allObservedSetLines | flatBus->trueFalseComponents.allObservedResetLines)&changedLines)
-			{
-				flatBus->trueFalseComponents.state.lineValues = ~0llu;
+static void csFlatBus_accumulateDrivers(const CSBusComponent *component, void *context)
+{
+	struct CSFlatBusDrivers *const drivers = (struct CSFlatBusDrivers *)context;
+	drivers->drivenHigh |= csBus_linesDrivenHigh(&component->currentInternalState);
+	drivers->drivenLow |= ~component->currentInternalState.lineValues;
+}
 
-				componentIndex = numberOfTrueFalseComponents;
-				while(componentIndex--)
-				{
-					if(trueFalseComponents[componentIndex].lastResult)
-					{
-						bool newEvaluation = 
-								trueFalseComponents[componentIndex].condition.lineValues == (trueFalseComponents[componentIndex].condition.lineMask&totalState.lineValues);
-
-						if(!newEvaluation)
-						{
-							callHandler(trueFalseComponents[componentIndex], false);
-							trueFalseComponents[componentIndex].lastResult = newEvaluation;
-						}
-					}
-
-					flatBus->trueFalseComponents.state.lineValues &= trueFalseComponents[componentIndex].currentInternalState.lineValues;
-				}
-			}
-		}
+static void csFlatBus_findContestants(const CSBusComponent *component, void *context)
+{
+	struct CSFlatBusDrivers *const drivers = (struct CSFlatBusDrivers *)context;
+	if(!drivers->componentDrivingHigh && (csBus_linesDrivenHigh(&component->currentInternalState) & drivers->contestedLines))
+		drivers->componentDrivingHigh = component;
+	if(!drivers->componentDrivingLow && (~component->currentInternalState.lineValues & drivers->contestedLines))
+		drivers->componentDrivingLow = component;
+}
 
-		// get total state as viewed from the true and true/false components
-		totalState.lineValues = flatBus->currentBusState.lineValues & flatBus->trueComponents.state.lineValues & flatBus->trueFalseComponents.state.lineValues & flatBus->clockedComponents.state.lineValues;
+// checks, all lines at once, whether anything is driving a line high that something
+// else is driving low; if so then it goes back to find out who
+static void csFlatBus_detectConflicts(CSFlatBus *const flatBus, const uint64_t halfCycle)
+{
+	struct CSFlatBusDrivers drivers = {0, 0, 0, NULL, NULL};
+	csFlatBus_visitDrivers(flatBus, csFlatBus_accumulateDrivers, &drivers);
 
-		// hence get the changed, set and reset lines
-		flatBus->clockedComponents.lastExternalState = totalState;
-		flatBus->clockedComponents.state.lineValues = ~0llu;
+	drivers.contestedLines = drivers.drivenHigh & drivers.drivenLow;
+	if(!drivers.contestedLines) return;
 
-		componentIndex = numberOfClockedComponents;
-		bool newClockLine = !!(flatBus->currentBusState.lineValues & CSBusStandardClockLine);
-		while(componentIndex--)
-		{
-			if(newClockLine || !clockedComponents[componentIndex].condition.signalOnTrueOnly)
-			{
-				callHandler(clockedComponents[componentIndex], newClockLine);
-			}
+	csFlatBus_visitDrivers(flatBus, csFlatBus_findContestants, &drivers);
+	flatBus->conflictingHalfCycles++;
 
-			flatBus->clockedComponents.state.lineValues &= clockedComponents[componentIndex].currentInternalState.lineValues;
+	// extend the most recent conflict if this is just more of the same
+	if(flatBus->numberOfConflicts)
+	{
+		struct CSFlatBusConflict *const conflict = &flatBus->conflicts[flatBus->numberOfConflicts - 1];
+		if(
+			conflict->firstHalfCycle + conflict->numberOfHalfCycles == halfCycle &&
+			conflict->lines == drivers.contestedLines &&
+			conflict->componentDrivingHigh == drivers.componentDrivingHigh &&
+			conflict->componentDrivingLow == drivers.componentDrivingLow)
+		{
+			conflict->numberOfHalfCycles++;
+			return;
 		}
+	}
 
-		halfCyclesToDate++;
-		flatBus->halfCyclesToDate = halfCyclesToDate;
+	if(flatBus->numberOfConflicts == kCSFlatBusMaximumConflicts) return;
+	if(!flatBus->conflicts)
+	{
+		flatBus->conflicts = (struct CSFlatBusConflict *)malloc(sizeof(struct CSFlatBusConflict) * kCSFlatBusMaximumConflicts);
+		if(!flatBus->conflicts) return;
+	}
+
+	struct CSFlatBusConflict *const conflict = &flatBus->conflicts[flatBus->numberOfConflicts++];
+	conflict->firstHalfCycle = halfCycle;
+	conflict->numberOfHalfCycles = 1;
+	conflict->lines = drivers.contestedLines;
+	conflict->componentDrivingHigh = drivers.componentDrivingHigh;
+	conflict->componentDrivingLow = drivers.componentDrivingLow;
+}
 
-		csRateConverter_advance(time)
+// the bus is skipped forward only when nothing but the clock is changing, so
+// whatever conflict there was in the half cycle before continues throughout
+static void csFlatBus_continueConflicts(CSFlatBus *const flatBus, const uint64_t halfCycle, const unsigned int halfCycles)
+{
+	if(!flatBus->numberOfConflicts) return;
+
+	struct CSFlatBusConflict *const conflict = &flatBus->conflicts[flatBus->numberOfConflicts - 1];
+	if(conflict->firstHalfCycle + conflict->numberOfHalfCycles != halfCycle) return;
+
+	conflict->numberOfHalfCycles += halfCycles;
+	flatBus->conflictingHalfCycles += halfCycles;
+}
+
+static const char *csFlatBus_getComponentType(const CSBusComponent *const component)
+{
+	return component->referenceCountedObject.type ? component->referenceCountedObject.type : "(untyped)";
+}
+
+void csFlatBus_printConflicts(void *opaqueBus, FILE *stream)
+{
+	CSFlatBus *const flatBus = (CSFlatBus *)opaqueBus;
+
+	fprintf(stream, "%llu half cycles with conflicts\n", (unsigned long long)flatBus->conflictingHalfCycles);
+	if(!flatBus->numberOfConflicts) return;
+
+	fprintf(stream, "%-20s %12s %-18s %-30s %-30s\n", "from half cycle", "for", "lines", "driving high", "driving low");
+	for(unsigned int conflictIndex = 0; conflictIndex < flatBus->numberOfConflicts; conflictIndex++)
+	{
+		const struct CSFlatBusConflict *const conflict = &flatBus->conflicts[conflictIndex];
+		fprintf(stream, "%-20llu %12llu %016llx   %-30s %-30s\n",
+			(unsigned long long)conflict->firstHalfCycle,
+			(unsigned long long)conflict->numberOfHalfCycles,
+			(unsigned long long)conflict->lines,
+			csFlatBus_getComponentType(conflict->componentDrivingHigh),
+			csFlatBus_getComponentType(conflict->componentDrivingLow));
 	}
 
-	flatBus->time = time;
+	if(flatBus->numberOfConflicts == kCSFlatBusMaximumConflicts)
+		fprintf(stream, "(only the first %d runs are kept)\n", kCSFlatBusMaximumConflicts);
+}
+
+uint64_t csFlatBus_getConflictingHalfCycles(void *opaqueBus)
+{
+	return ((CSFlatBus *)opaqueBus)->conflictingHalfCycles;
+}
+
+void csFlatBus_resetConflicts(void *opaqueBus)
+{
+	CSFlatBus *const flatBus = (CSFlatBus *)opaqueBus;
+	flatBus->numberOfConflicts = 0;
+	flatBus->conflictingHalfCycles = 0;
+}
+
+#else
+
+void csFlatBus_printConflicts(void *opaqueBus, FILE *stream)
+{
+	fprintf(stream, "conflict detection isn't available; build with CSBusTracksHighImpedance defined as 1\n");
+}
+
+uint64_t csFlatBus_getConflictingHalfCycles(void *opaqueBus)
+{
+	return 0;
+}
+
+void csFlatBus_resetConflicts(void *opaqueBus)
+{
 }
 
+#endif
+
 static void csFlatBus_destroy(void *bus)
 {
 	CSFlatBus *flatBus = (CSFlatBus *)bus;
 	csFlatBus_destroySet(&flatBus->clockedComponents);
 	csFlatBus_destroySet(&flatBus->trueComponents);
 	csFlatBus_destroySet(&flatBus->trueFalseComponents);
+#if CSBusExtendedWords
+	csFlatBus_destroySet(&flatBus->wideComponents);
+#endif
+	free(flatBus->events);
+
+	for(unsigned int filterIndex = 0; filterIndex < flatBus->numberOfFilters; filterIndex++)
+	{
+		csFlatBus_destroySet(&flatBus->filters[filterIndex]->trueComponents);
+		csFlatBus_destroySet(&flatBus->filters[filterIndex]->trueFalseComponents);
+		free(flatBus->filters[filterIndex]);
+	}
+	free(flatBus->filters);
+
+	for(unsigned int clockDomainIndex = 0; clockDomainIndex < flatBus->numberOfClockDomains; clockDomainIndex++)
+	{
+		csFlatBus_destroySet(&flatBus->clockDomains[clockDomainIndex]->clockedComponents);
+		free(flatBus->clockDomains[clockDomainIndex]->edgeIntervals);
+		free(flatBus->clockDomains[clockDomainIndex]);
+	}
+	free(flatBus->clockDomains);
+
+	for(unsigned int index = 0; index < flatBus->numberOfPassiveObservers; index++)
+		csFlatBus_destroyPassiveObserver(flatBus->passiveObservers[index]);
+	free(flatBus->passiveObservers);
+
+	free(flatBus->pendingSleepChanges);
+
+#if CSBusTracksHighImpedance
+	free(flatBus->conflicts);
+#endif
 }
 
 void *csFlatBus_create(void)
@@ -299,9 +3032,15 @@ void *csFlatBus_create(void)
 		csFlatBus_initialiseSet(&flatBus->clockedComponents);
 		csFlatBus_initialiseSet(&flatBus->trueComponents);
 		csFlatBus_initialiseSet(&flatBus->trueFalseComponents);
+#if CSBusExtendedWords
+		csFlatBus_initialiseSet(&flatBus->wideComponents);
+#endif
 
 		// for the purposes of clock signal generation...
 		flatBus->currentBusState = csBus_defaultState();
+		flatBus->filteredState = csBus_defaultState();
+		flatBus->clockDomainState = csBus_defaultState();
+		csFlatBus_updateNextEventTime(flatBus);
 	}
 
 	return flatBus;
@@ -310,6 +3049,17 @@ void *csFlatBus_create(void)
 void csFlatBus_setTicksPerSecond(void *bus, uint32_t ticksPerSecond)
 {
 	CSFlatBus *flatBus = (CSFlatBus *)bus;
-	ticksPerSecond <<= 1;
-	csRateConverter_setup(flatBus->time, ticksPerSecond, 1000000000)
+	flatBus->ticksPerSecond = ticksPerSecond;
+}
+
+void csFlatBus_freeze(void *bus)
+{
+	// this only seals the bus; compiling the sets into a fixed dispatch plan
+	// was tried, but couldn't be told apart from the usual dispatch in timing
+	((CSFlatBus *)bus)->isFrozen = true;
+}
+
+uint32_t csFlatBus_getTicksPerSecond(void *bus)
+{
+	return ((CSFlatBus *)bus)->ticksPerSecond;
 }
@@ -10,6 +10,7 @@
 #define ClockSignal_FlatBus_h
 
 #include "Component.h"
+#include <stdio.h>
 
 void *csFlatBus_create(void);
 void *csFlatBus_createComponent(
@@ -18,14 +19,181 @@ void *csFlatBus_createComponent(
    CSBusCondition necessaryCondition,
    uint64_t outputLines,
    void *context);
-void csFlatBus_setModalComponentFilter(
+
+// creates a component that observes up to kCSFlatBusMaximumConditions conditions,
+// each with the standard test, and is messaged about all of them via a single
+// handler. The bus tests only what the conditions have in common — lines that
+// all of them require to have the same value — until that's satisfied, and
+// only then tests each individually. A specialisation function can't be
+// supplied, and the conditions shouldn't observe the clock. Returns NULL if
+// there are too many conditions
+#define kCSFlatBusMaximumConditions	32
+
+void *csFlatBus_createMultiConditionComponent(
+	void *,
+	csComponent_multiConditionHandlerFunction function,
+	const CSBusCondition *conditions,
+	unsigned int numberOfConditions,
+	uint64_t outputLines,
+	void *context);
+
+// filters alter the bus state as seen by some components — e.g. to model
+// address lines being redirected. A filter may alter only the nominated
+// lines, its output for each should depend only on that line's input and
+// the filter's own state, and it should be invalidated whenever that state
+// changes; it is evaluated at most once per change and components behind it
+// that observe altered lines have their conditions tested against its output.
+// Filters are owned by the bus
+void *csFlatBus_createFilter(
 	void *,
 	csComponent_prefilter filterFunction,
+	uint64_t alteredLines,
 	void *context);	// WARNING: context is not retained
+void csFlatBus_invalidateFilter(void *filter);
+
+// components created while a modal filter is set view the bus through it;
+// supply NULL to revert to an unfiltered view
+void csFlatBus_setModalComponentFilter(
+	void *,
+	void *filter);
+
+// clock domains model clocks derived from the bus's own — e.g. a video or sound
+// clock divided from a master crystal — running at numerator/denominator times
+// its rate, which mustn't be faster. Clocked components created while a modal
+// clock domain is set are messaged only on that domain's edges, with the
+// domain's clock level, rather than every half cycle; the clock line on the
+// bus remains the bus's own. Edges are spread as evenly as whole half cycles
+// allow and the domain's clock, like the bus's, starts high. Returns NULL if
+// the ratio is unsuitable, including if it doesn't repeat within 65536 of the
+// domain's edges. Clock domains are owned by the bus and named for profiling;
+// the name isn't copied
+void *csFlatBus_createClockDomain(
+	void *,
+	const char *name,
+	unsigned int numerator,
+	unsigned int denominator);
+
+// supply NULL to revert to the bus's own clock
+void csFlatBus_setModalClockDomain(
+	void *,
+	void *clockDomain);
 
 void csFlatBus_setTicksPerSecond(void *, uint32_t ticksPerSecond);
+uint32_t csFlatBus_getTicksPerSecond(void *);
+
+// the bus knows which lines its components can drive, from their output lines;
+// anything that drives lines from an event handler should declare them here too
+// so that components can be specialised accordingly
+uint64_t csFlatBus_getDrivenLines(void *);
+void csFlatBus_addEventOutputLines(void *, uint64_t outputLines);
+
+// once all components have been added, the bus can be frozen; no components
+// can be added to a frozen bus
+void csFlatBus_freeze(void *);
+
+// a bridge connects a child bus to a parent: while the selection condition is
+// true, the child's components see the parent bus as their own and whatever
+// they output is loaded onto it, but they need be considered only when the
+// child is selected — e.g. memory on a bus of its own selected by MREQ. A child
+// bus is stepped only by its bridge, so has no clock or events of its own; it
+// should be fully populated first, as it will be frozen. Returns the bridge,
+// which is a component of the parent bus
+void *csFlatBus_createBridge(
+	void *parentBus,
+	void *childBus,
+	CSBusCondition selectionCondition,
+	uint64_t outputLines);
 
 void csFlatBus_runForHalfCycles(void *, unsigned int halfCycles);
-unsigned int csFlatBus_getHalfCyclesToDate(void *);
+
+// passive observers watch the bus without ever driving it, so rather than being
+// messaged they receive its history in bulk: a record of the time and bus state
+// is taken whenever any line the condition observes changes while its mask test
+// is true, as seen by the unclocked components, and the records are handed
+// over whenever the buffer of capacity records fills and whenever the bus
+// stops running. Asynchronous observers receive them on a thread of their own
+// while the bus continues; the records then remain
+// valid only until the handler returns. Where only one processor is available,
+// asynchronous observers are treated as synchronous. Observers are owned by the bus
+typedef struct
+{
+	uint64_t halfCycle;
+	CSBusState state;
+} CSFlatBusHistoryRecord;
+
+typedef void (* csFlatBus_historyHandler)(void *context, const CSFlatBusHistoryRecord *records, unsigned int numberOfRecords);
+
+void *csFlatBus_addPassiveObserver(
+	void *,
+	CSBusCondition condition,
+	unsigned int capacity,
+	bool isAsynchronous,
+	csFlatBus_historyHandler handler,
+	void *context);	// WARNING: context is not retained
+void csFlatBus_removePassiveObserver(void *, void *observer);
+
+// as csFlatBus_runForHalfCycles, but stops early, at the end of the first half
+// cycle after which the bus meets stopCondition: its masked lines have the values
+// it dictates and, if it observes any lines for changes, one of those has just
+// changed. Returns the number of half cycles actually run
+unsigned int csFlatBus_runUntil(
+	void *,
+	unsigned int maxHalfCycles,
+	CSBusCondition stopCondition);
+
+// ... or at the end of the first half cycle after which the predicate returns true.
+// The bus can't know what the predicate depends on, so it runs every half cycle in
+// full while one is in use, even those in which only the clock would change
+typedef bool (* csFlatBus_stopPredicate)(void *context);
+
+unsigned int csFlatBus_runUntilPredicate(
+	void *,
+	unsigned int maxHalfCycles,
+	csFlatBus_stopPredicate predicate,
+	void *context);
+
+// the bus counts time in half cycles since it was created; that count is 64-bit
+// so it won't wrap around in practice, and it's the time base for events
+uint64_t csFlatBus_getHalfCyclesToDate(void *);
+
+// if built with CSFlatBusProfile defined as 1, the bus counts for each component how
+// often its condition is tested and found true, how often its handler is called and
+// roughly how long those calls take — in timestamp counter ticks where available,
+// nanoseconds otherwise — and for each set of components how often it's run and how
+// often it's skipped because nothing it observes has changed. The report groups
+// components by type, most expensive first; a bridge's time includes that of the
+// components on its child bus, which are reported too
+void csFlatBus_printProfile(void *, FILE *stream);
+void csFlatBus_resetProfile(void *);
+
+// if built with CSBusTracksHighImpedance defined as 1, as debug builds are by default,
+// the bus checks at the end of every half cycle whether any line is being driven high
+// by one component and low by another, including components on any selected child
+// bus. Each run of consecutive half cycles in which the same lines are contested by
+// the same components is logged, up to a limit, and every such half cycle is counted.
+// Lines are considered driven high only if a component has said so via csBus_driveLines
+void csFlatBus_printConflicts(void *, FILE *stream);
+uint64_t csFlatBus_getConflictingHalfCycles(void *);
+void csFlatBus_resetConflicts(void *);
+
+// events are things that happen at a known time rather than in response to
+// the bus, such as the output of a fixed-period counter; an event occurs at
+// the end of the nominated half cycle, after the clocked components have run,
+// or at the end of the current half cycle if that time has already passed.
+// Handlers may load lines other than the clock via outputState, which persists
+// from one event to the next and is resolved with everything else on the bus
+typedef void (* csFlatBus_eventHandler)(void *context, CSBusState *outputState, uint64_t halfCycleTime);
+
+void csFlatBus_scheduleEvent(
+	void *,
+	uint64_t halfCycleTime,
+	csFlatBus_eventHandler handler,
+	void *context);	// WARNING: context is not retained
+
+// cancels all pending events with the nominated handler and context
+void csFlatBus_cancelEvents(
+	void *,
+	csFlatBus_eventHandler handler,
+	void *context);
 
 #endif
@@ -0,0 +1,242 @@
+//
+//  BusTraceRecorder.c
+//  Clock Signal
+//
+//  Created by Thomas Harte on 03/12/2011.
+//  Copyright 2011 Thomas Harte. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "BusTraceRecorder.h"
+#include "ReferenceCountedObject.h"
+#include "BusState.h"
+#include "StandardBusLines.h"
+#include "FlatBus.h"
+
+// the file is grown and mapped a window at a time; each window
+// is a whole number of pages on any sensible system
+#define kCSBusTraceRecorderWindowLength	(4*1024*1024)
+
+// records are collected by the bus in batches of this many
+#define kCSBusTraceRecorderBatchLength	4096
+
+typedef struct
+{
+	CSReferenceCountedObject referenceCountedObject;
+
+	void *bus, *observer;
+
+	// the file, the window of it that's currently mapped and
+	// how much of that window has been written to
+	int fileDescriptor;
+	uint8_t *window;
+	off_t windowOffset;
+	size_t windowPosition;
+	bool hasFailed;
+
+	// the state that the next record is relative to
+	uint64_t lastHalfCycle;
+	uint64_t lastLineValues;
+	bool hasRecorded;
+
+} CSBusTraceRecorder;
+
+static bool csBusTraceRecorder_mapWindow(CSBusTraceRecorder *const recorder, const off_t offset)
+{
+	if(ftruncate(recorder->fileDescriptor, offset + kCSBusTraceRecorderWindowLength)) return false;
+
+	void *const window = mmap(NULL, kCSBusTraceRecorderWindowLength, PROT_READ | PROT_WRITE, MAP_SHARED, recorder->fileDescriptor, offset);
+	if(window == MAP_FAILED) return false;
+
+	recorder->window = (uint8_t *)window;
+	recorder->windowOffset = offset;
+	recorder->windowPosition = 0;
+	return true;
+}
+
+static void csBusTraceRecorder_write(CSBusTraceRecorder *const restrict recorder, const uint8_t *restrict bytes, size_t length)
+{
+	while(length)
+	{
+		if(recorder->windowPosition == kCSBusTraceRecorderWindowLength)
+		{
+			// we're out of space, so move on to the next window
+			munmap(recorder->window, kCSBusTraceRecorderWindowLength);
+			recorder->window = NULL;
+
+			if(!csBusTraceRecorder_mapWindow(recorder, recorder->windowOffset + kCSBusTraceRecorderWindowLength))
+			{
+				recorder->hasFailed = true;
+				return;
+			}
+		}
+
+		size_t lengthToCopy = kCSBusTraceRecorderWindowLength - recorder->windowPosition;
+		if(lengthToCopy > length) lengthToCopy = length;
+
+		memcpy(&recorder->window[recorder->windowPosition], bytes, lengthToCopy);
+		recorder->windowPosition += lengthToCopy;
+		bytes += lengthToCopy;
+		length -= lengthToCopy;
+	}
+}
+
+// encodes a record to the nominated buffer, which should have space for at
+// least kCSBusTraceMaximumRecordLength bytes, returning the number written
+static inline size_t csBusTraceRecorder_encode(uint8_t *const restrict buffer, uint64_t halfCycles, const uint64_t changedLines)
+{
+	size_t length = 0;
+
+	// time first, as a varint
+	while(halfCycles >= 0x80)
+	{
+		buffer[length++] = (uint8_t)(halfCycles | 0x80);
+		halfCycles >>= 7;
+	}
+	buffer[length++] = (uint8_t)halfCycles;
+
+	// then a byte with a bit set for each byte of the line values that
+	// changed, which is collected by smearing each byte's bits down into
+	// its lowest and gathering those with a multiply
+	uint64_t changedBytes = changedLines | (changedLines >> 4);
+	changedBytes |= changedBytes >> 2;
+	changedBytes |= changedBytes >> 1;
+	changedBytes = ((changedBytes & 0x0101010101010101llu) * 0x0102040810204080llu) >> 56;
+	buffer[length++] = (uint8_t)changedBytes;
+
+	// and then the changes themselves
+	while(changedBytes)
+	{
+		buffer[length++] = (uint8_t)(changedLines >> (__builtin_ctzll(changedBytes) << 3));
+		changedBytes &= changedBytes - 1;
+	}
+
+	return length;
+}
+
+// this is the passive observer's handler, so it runs on a thread of
+// its own
+static void csBusTraceRecorder_record(void *context, const CSFlatBusHistoryRecord *records, unsigned int numberOfRecords)
+{
+	CSBusTraceRecorder *const recorder = (CSBusTraceRecorder *)context;
+	if(recorder->hasFailed) return;
+
+	// the clock isn't recorded, as it's implied by the half cycle; the
+	// first record is used to establish which way around it goes
+	if(!recorder->hasRecorded)
+	{
+		recorder->window[5] = ((records[0].state.lineValues & CSBusStandardClockLine) ? 1 : 0) ^ (records[0].halfCycle&1);
+		recorder->hasRecorded = true;
+	}
+
+	uint64_t lastHalfCycle = recorder->lastHalfCycle;
+	uint64_t lastLineValues = recorder->lastLineValues;
+
+	// the window and position are kept locally as otherwise the compiler would
+	// have to assume that writing the encoding might modify them
+	uint8_t *window = recorder->window;
+	size_t windowPosition = recorder->windowPosition;
+
+	while(numberOfRecords--)
+	{
+		const uint64_t lineValues = records->state.lineValues & ~CSBusStandardClockLine;
+		const uint64_t halfCycles = records->halfCycle - lastHalfCycle;
+		const uint64_t changedLines = lineValues ^ lastLineValues;
+
+		if(windowPosition <= kCSBusTraceRecorderWindowLength - kCSBusTraceMaximumRecordLength)
+		{
+			// there's definitely space in the window, so encode straight into it
+			windowPosition += csBusTraceRecorder_encode(&window[windowPosition], halfCycles, changedLines);
+		}
+		else
+		{
+			// this record may straddle two windows
+			uint8_t encoding[kCSBusTraceMaximumRecordLength];
+			recorder->windowPosition = windowPosition;
+			csBusTraceRecorder_write(recorder, encoding, csBusTraceRecorder_encode(encoding, halfCycles, changedLines));
+			if(recorder->hasFailed) return;
+
+			window = recorder->window;
+			windowPosition = recorder->windowPosition;
+		}
+
+		lastHalfCycle = records->halfCycle;
+		lastLineValues = lineValues;
+		records++;
+	}
+
+	recorder->windowPosition = windowPosition;
+	recorder->lastHalfCycle = lastHalfCycle;
+	recorder->lastLineValues = lastLineValues;
+}
+
+static void csBusTraceRecorder_destroy(void *opaqueRecorder)
+{
+	CSBusTraceRecorder *const recorder = (CSBusTraceRecorder *)opaqueRecorder;
+
+	// removing the observer flushes whatever it has yet to pass on
+	if(recorder->observer) csFlatBus_removePassiveObserver(recorder->bus, recorder->observer);
+	csObject_release(recorder->bus);
+
+	// trim the file to length, as the final window is unlikely to be full
+	const off_t length = recorder->windowOffset + (off_t)recorder->windowPosition;
+	if(recorder->window) munmap(recorder->window, kCSBusTraceRecorderWindowLength);
+	if(recorder->fileDescriptor >= 0)
+	{
+		if(ftruncate(recorder->fileDescriptor, length)) {}
+		close(recorder->fileDescriptor);
+	}
+}
+
+void *csBusTraceRecorder_createForBus(void *bus, const char *path)
+{
+	CSBusTraceRecorder *const recorder = (CSBusTraceRecorder *)calloc(1, sizeof(CSBusTraceRecorder));
+
+	if(recorder)
+	{
+		csObject_init(recorder);
+		recorder->referenceCountedObject.dealloc = csBusTraceRecorder_destroy;
+		recorder->bus = csObject_retain(bus);
+		recorder->lastLineValues = ~CSBusStandardClockLine;
+
+		recorder->fileDescriptor = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if(recorder->fileDescriptor < 0 || !csBusTraceRecorder_mapWindow(recorder, 0))
+		{
+			csObject_release(recorder);
+			return NULL;
+		}
+
+		const uint32_t ticksPerSecond = csFlatBus_getTicksPerSecond(bus);
+		const uint8_t header[kCSBusTraceHeaderLength] =
+		{
+			'C', 'S', 'B', 'T',
+			kCSBusTraceVersion, kCSBusTraceClockPhaseUnknown, 0, 0,
+			(uint8_t)ticksPerSecond, (uint8_t)(ticksPerSecond >> 8), (uint8_t)(ticksPerSecond >> 16), (uint8_t)(ticksPerSecond >> 24),
+			0, 0, 0, 0
+		};
+		csBusTraceRecorder_write(recorder, header, kCSBusTraceHeaderLength);
+
+		// the clock is excluded from the condition, both because it isn't recorded
+		// and because watching it would prevent the bus from skipping ahead
+		recorder->observer = csFlatBus_addPassiveObserver(
+			bus,
+			csBus_changeCondition(~CSBusStandardClockLine),
+			kCSBusTraceRecorderBatchLength,
+			true,
+			csBusTraceRecorder_record,
+			recorder);
+		if(!recorder->observer)
+		{
+			csObject_release(recorder);
+			return NULL;
+		}
+	}
+
+	return recorder;
+}
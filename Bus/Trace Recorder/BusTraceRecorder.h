@@ -0,0 +1,58 @@
+//
+//  BusTraceRecorder.h
+//  Clock Signal
+//
+//  Created by Thomas Harte on 03/12/2011.
+//  Copyright 2011 Thomas Harte. All rights reserved.
+//
+
+#ifndef ClockSignal_BusTraceRecorder_h
+#define ClockSignal_BusTraceRecorder_h
+
+#include "stdint.h"
+
+/*
+
+	A bus trace recorder attaches to a flat bus as a passive observer and
+	writes every change to its lines, other than the clock, to a file.
+
+	The file begins with a header:
+
+		4 bytes		"CSBT"
+		1 byte		format version, currently 1
+		1 byte		the level of the clock on even half cycles, or 0xff if
+					nothing was recorded
+		2 bytes		reserved, zero
+		4 bytes		ticks per second of the bus, little endian, or 0 if unknown
+		4 bytes		reserved, zero
+
+	Which is followed by one record per half cycle in which any line other
+	than the clock changed:
+
+		the number of half cycles since the previous record (or since
+		half cycle 0, for the first), as a little-endian base 128 varint
+
+		a byte in which bit n is set if byte n of the line values changed
+
+		the changed bytes, exclusive ORd with their previous values, in
+		ascending order
+
+	Prior to the first record all lines are considered to be high. Only the
+	lowest 64 lines are recorded, regardless of the width of the bus.
+
+*/
+
+#define kCSBusTraceVersion				1
+#define kCSBusTraceHeaderLength			16
+#define kCSBusTraceClockPhaseUnknown	0xff
+
+// the longest a single record can be: a ten-byte varint, the change byte
+// and then up to eight bytes of changes
+#define kCSBusTraceMaximumRecordLength	19
+
+// returns a csObject; recording begins immediately and continues until the
+// recorder is released, which also retains the bus in the meantime. Returns
+// NULL if the file can't be created
+void *csBusTraceRecorder_createForBus(void *bus, const char *path);
+
+#endif
@@ -151,8 +151,8 @@ void *csDynamicRAM_createOnBus(void *bus, CSDynamicRAMType type)
 		// corrupt cells that aren't properly updated
 		memory->lastRefreshTimes = (CSComponentNanoseconds *)calloc((size_t)memory->casMask, sizeof(CSComponentNanoseconds));
 
-		// component to handle the strobes
-		csFlatBus_createComponent(
+		// component to handle the strobes; refresh is a matter of real time
+		void *component = csFlatBus_createComponent(
 			bus,
 			csDynamicRAM_observeStrobes,
 			csBus_resetCondition(
@@ -160,6 +160,7 @@ void *csDynamicRAM_createOnBus(void *bus, CSDynamicRAMType type)
 				CSComponentDynamicRAMSignalCAS, false),
 				CSComponentDynamicRAMSignalDataInput | CSComponentDynamicRAMSignalDataOutput,
 			memory);
+		csComponent_setNeedsTimeSinceLaunch(component, true);
 	}
 
 	return memory;
@@ -27,9 +27,9 @@ typedef struct
 
 const char *staticMemoryType = "static memory";
 
-csComponent_observer(csStaticMemory_observeMemoryRead)
+static inline void csStaticMemory_read(const CSStaticMemory *const memory, CSBusState *const internalState, const CSBusState externalState, const bool isSelected)
 {
-	if(conditionIsTrue)
+	if(isSelected)
 	{
 		// output something...
 
@@ -37,7 +37,6 @@ csComponent_observer(csStaticMemory_observeMemoryRead)
 		unsigned int address = (externalState.lineValues&CSBusStandardAddressMask) >> CSBusStandardAddressShift;
 
 		// reduce that down to an address in our range
-		const CSStaticMemory *const memory = (CSStaticMemory *const)context;
 		address &= memory->sizeMinusOne;
 
 //		if(externalState.lineValues&0x200000000000)
@@ -47,31 +46,48 @@ csComponent_observer(csStaticMemory_observeMemoryRead)
 
 		// and load the data lines
 		internalState->lineValues &= ((uint64_t)memory->contents[address] << CSBusStandardDataShift) | ~CSBusStandardDataMask;
+		csBus_driveLines(internalState, CSBusStandardDataMask);
 	}
 	else
 	{
 		// stop outputting anything whatsoever
 		internalState->lineValues |= CSBusStandardDataMask;
+		csBus_floatLines(internalState, CSBusStandardDataMask);
 //		printf("r-\n");
 	}
 }
 
-csComponent_observer(csStaticMemory_observeMemoryWrite)
+static inline void csStaticMemory_write(CSStaticMemory *const memory, const CSBusState externalState)
 {
-	if(!conditionIsTrue)
-	{
-		// store the incoming value...
+	// store the incoming value...
 
-		// fetch the address from the bus
-		unsigned int address = (externalState.lineValues&CSBusStandardAddressMask) >> CSBusStandardAddressShift;
+	// fetch the address from the bus
+	unsigned int address = (externalState.lineValues&CSBusStandardAddressMask) >> CSBusStandardAddressShift;
 
-		// reduce that down to an address in our range
-		const CSStaticMemory *const memory = (CSStaticMemory *const)context;
-		address &= memory->sizeMinusOne;
+	// reduce that down to an address in our range
+	address &= memory->sizeMinusOne;
 
-		// and load the data lines
-		memory->contents[address] = (uint8_t)(externalState.lineValues >> CSBusStandardDataShift);
-	}
+	// and load the data lines
+	memory->contents[address] = (uint8_t)(externalState.lineValues >> CSBusStandardDataShift);
+}
+
+csComponent_observer(csStaticMemory_observeMemoryRead)
+{
+	csStaticMemory_read((const CSStaticMemory *)context, internalState, externalState, conditionIsTrue);
+}
+
+// condition 0 is the read condition and condition 1 the write
+csComponent_multiConditionObserver(csStaticMemory_observeMemoryReadWrite)
+{
+	CSStaticMemory *const memory = (CSStaticMemory *)context;
+
+	// writes happen as the write condition ends, and are
+	// dealt with first so that a read can see the result
+	if((messagedConditions & ~trueConditions) & 2)
+		csStaticMemory_write(memory, externalState);
+
+	if(messagedConditions & 1)
+		csStaticMemory_read(memory, internalState, externalState, trueConditions & 1);
 }
 
 static void csStaticMemory_dealloc(void *opaqueMemory)
@@ -105,6 +121,12 @@ void csStaticMemory_getContents(void *opaqueMemory, uint8_t *dest, unsigned int
 	memcpy(dest, &memory->contents[source], length);
 }
 
+uint8_t *csStaticMemory_getStorage(void *opaqueMemory)
+{
+	CSStaticMemory *memory = (CSStaticMemory *)opaqueMemory;
+	return memory->contents;
+}
+
 void *csStaticMemory_createOnBus(void *bus, unsigned int size, CSBusCondition readCondition, CSBusCondition writeCondition)
 {
 	CSStaticMemory *memory = (CSStaticMemory *)calloc(1, sizeof(CSStaticMemory));
@@ -120,24 +142,25 @@ void *csStaticMemory_createOnBus(void *bus, unsigned int size, CSBusCondition re
 		memory->contents = (uint8_t *)malloc(size);
 		memory->sizeMinusOne = size-1;
 
-		// if this is readonly, add just the read component;
-		// otherwise create a read/write node
-		csFlatBus_createComponent(
-			bus,
-			csStaticMemory_observeMemoryRead,
-			readCondition,
-			CSBusStandardDataMask,
-			memory
-		);
-
-		// don't bother adding the write observer if the
-		// condition is impossible to satisfy
-		if(!csBusCondition_isImpossible(writeCondition))
+		// if this is readonly, add just the read component; otherwise
+		// create a single component that observes both conditions
+		if(csBusCondition_isImpossible(writeCondition))
 		{
 			csFlatBus_createComponent(
 				bus,
-				csStaticMemory_observeMemoryWrite,
-				writeCondition,
+				csStaticMemory_observeMemoryRead,
+				readCondition,
+				CSBusStandardDataMask,
+				memory
+			);
+		}
+		else
+		{
+			const CSBusCondition conditions[] = {readCondition, writeCondition};
+			csFlatBus_createMultiConditionComponent(
+				bus,
+				csStaticMemory_observeMemoryReadWrite,
+				conditions, 2,
 				CSBusStandardDataMask,
 				memory);
 		}
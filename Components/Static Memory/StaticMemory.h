@@ -30,4 +30,9 @@ void *csStaticMemory_createOnBus(void *bus, unsigned int size, CSBusCondition re
 void csStaticMemory_setContents(void *memory, unsigned int dest, const uint8_t *source, size_t length);
 void csStaticMemory_getContents(void *memory, uint8_t *dest, unsigned int source, size_t length);
 
+// returns the storage itself, for anything that's allowed to access it
+// without going via the bus, such as a CPU's fast mode; it's the size
+// given at creation and remains valid for as long as the memory does
+uint8_t *csStaticMemory_getStorage(void *memory);
+
 #endif
@@ -0,0 +1,913 @@
+//
+//  FastExecution.c
+//  LLZ80
+//
+//  Created by Thomas Harte on 05/12/2011.
+//  Copyright (c) 2011 Thomas Harte. All rights reserved.
+//
+
+#include <stddef.h>
+#include <string.h>
+#include "Z80FastExecution.h"
+
+#include "../Operations/Z80BitwiseOps.h"
+#include "../Operations/Z80RotateAndShiftOps.h"
+#include "../Operations/Z80Arithmetic8BitOps.h"
+#include "../Operations/Z80Arithmetic16BitOps.h"
+#include "../Operations/Z80SetResetTestOps.h"
+#include "../Operations/Z80BlockOps.h"
+
+/*
+
+	Fast mode performs a whole instruction at once, directly on the memory
+	pages it has been given, rather than scheduling it half cycle by half
+	cycle. It otherwise follows the instruction pages as closely as it can —
+	the same operations, in the same order, and taking the same number of
+	cycles — so that it makes no difference which of the two performs any
+	particular instruction.
+
+	Reads are made immediately but writes are held back until the instruction
+	is complete and the registers are copied before it begins, so that an
+	instruction can be abandoned at any point if it turns out to need the bus
+	after all.
+
+*/
+
+#define kLLZ80FastModeRegistersStart	offsetof(LLZ80ProcessorState, aRegister)
+#define kLLZ80FastModeRegistersLength	(offsetof(LLZ80ProcessorState, interruptState) - kLLZ80FastModeRegistersStart)
+
+// no instruction writes more than two bytes
+#define kLLZ80FastModeMaximumWrites		2
+
+typedef struct
+{
+	LLZ80ProcessorState *z80;
+	unsigned int halfCycles;
+	bool needsBus;
+
+	unsigned int numberOfWrites;
+	uint8_t *writeTargets[kLLZ80FastModeMaximumWrites];
+	uint8_t writeValues[kLLZ80FastModeMaximumWrites];
+} LLZ80FastInstruction;
+
+/*
+
+	Bus activity; each of these accounts for the time the
+	equivalent machine cycle would take
+
+*/
+static inline uint8_t llz80_fast_read(LLZ80FastInstruction *const instruction, const uint16_t address)
+{
+	instruction->halfCycles += 6;
+
+	const uint8_t *const page = instruction->z80->fastModeReadPages[address / kLLZ80FastModePageSize];
+	if(!page)
+	{
+		instruction->needsBus = true;
+		return 0xff;
+	}
+
+	return page[address % kLLZ80FastModePageSize];
+}
+
+static inline void llz80_fast_write(LLZ80FastInstruction *const instruction, const uint16_t address, const uint8_t value)
+{
+	instruction->halfCycles += 6;
+
+	// a page that can be read but not written is ROM, so the
+	// write just goes nowhere
+	const unsigned int page = address / kLLZ80FastModePageSize;
+	if(!instruction->z80->fastModeReadPages[page])
+	{
+		instruction->needsBus = true;
+		return;
+	}
+	if(!instruction->z80->fastModeWritePages[page]) return;
+
+	instruction->writeTargets[instruction->numberOfWrites] = &instruction->z80->fastModeWritePages[page][address % kLLZ80FastModePageSize];
+	instruction->writeValues[instruction->numberOfWrites] = value;
+	instruction->numberOfWrites++;
+}
+
+static inline uint8_t llz80_fast_fetch(LLZ80FastInstruction *const instruction)
+{
+	LLZ80ProcessorState *const z80 = instruction->z80;
+	const uint16_t address = z80->pcRegister.fullValue;
+
+	// whoever supplied the pages may want to see some fetches
+	// on the bus, even from memory that can otherwise be read
+	if(!(z80->fastModeExecutablePages & (1llu << (address / kLLZ80FastModePageSize))))
+		instruction->needsBus = true;
+
+	// an instruction fetch is a read plus a cycle of refresh
+	const uint8_t opcode = llz80_fast_read(instruction, address);
+	instruction->halfCycles += 2;
+
+	z80->pcRegister.fullValue++;
+	z80->rRegister = (z80->rRegister&0x80) | ((z80->rRegister+1)&0x7f);
+	return opcode;
+}
+
+static inline uint8_t llz80_fast_readFromPC(LLZ80FastInstruction *const instruction)
+{
+	return llz80_fast_read(instruction, instruction->z80->pcRegister.fullValue++);
+}
+
+static inline uint16_t llz80_fast_read16BitsFromPC(LLZ80FastInstruction *const instruction)
+{
+	const uint8_t low = llz80_fast_readFromPC(instruction);
+	return (uint16_t)(low | (llz80_fast_readFromPC(instruction) << 8));
+}
+
+static inline void llz80_fast_pauseForCycles(LLZ80FastInstruction *const instruction, const unsigned int numberOfCycles)
+{
+	instruction->halfCycles += numberOfCycles << 1;
+}
+
+static void llz80_fast_pop(LLZ80FastInstruction *const instruction, LLZ80RegisterPair *const registerPair)
+{
+	LLZ80ProcessorState *const z80 = instruction->z80;
+
+	registerPair->bytes.low = llz80_fast_read(instruction, z80->spRegister.fullValue++);
+	registerPair->bytes.high = llz80_fast_read(instruction, z80->spRegister.fullValue++);
+}
+
+static void llz80_fast_push(LLZ80FastInstruction *const instruction, const LLZ80RegisterPair value)
+{
+	LLZ80ProcessorState *const z80 = instruction->z80;
+
+	llz80_fast_pauseForCycles(instruction, 1);
+	llz80_fast_write(instruction, --z80->spRegister.fullValue, value.bytes.high);
+	llz80_fast_write(instruction, --z80->spRegister.fullValue, value.bytes.low);
+}
+
+static uint16_t llz80_fast_sourceAddress(LLZ80FastInstruction *const instruction, const LLZ80RegisterPair *const indexRegister, const bool addOffset)
+{
+	if(!addOffset) return indexRegister->fullValue;
+
+	// read the offset, then spend 2 cycles working out the total
+	const int8_t offset = (int8_t)llz80_fast_readFromPC(instruction);
+	llz80_fast_pauseForCycles(instruction, 2);
+	return (uint16_t)(indexRegister->fullValue + offset);
+}
+
+/*
+
+	Operations
+
+*/
+static void llz80_fast_doALUOp(LLZ80ProcessorState *const z80, const int operation, const uint8_t value)
+{
+	switch(operation)
+	{
+		default: break;
+		case 0:	llz80_add_8bit(z80, value);					break;
+		case 1:	llz80_addWithCarry_8bit(z80, value);		break;
+		case 2:	llz80_subtract_8bit(z80, value);			break;
+		case 3:	llz80_subtractWithCarry_8bit(z80, value);	break;
+		case 4:	llz80_bitwiseAnd(z80, value);				break;
+		case 5:	llz80_bitwiseXOr(z80, value);				break;
+		case 6:	llz80_bitwiseOr(z80, value);				break;
+		case 7:	llz80_compare(z80, value);					break;
+	}
+}
+
+static void llz80_fast_doShiftOp(LLZ80ProcessorState *const z80, const int operation, uint8_t *const value)
+{
+	switch(operation)
+	{
+		default: break;
+		case 0: llz80_rlc	(z80, value); break;
+		case 1: llz80_rrc	(z80, value); break;
+		case 2: llz80_rl	(z80, value); break;
+		case 3: llz80_rr	(z80, value); break;
+		case 4: llz80_sla	(z80, value); break;
+		case 5: llz80_sra	(z80, value); break;
+		case 6: llz80_sll	(z80, value); break;
+		case 7: llz80_srl	(z80, value); break;
+	}
+}
+
+static void llz80_fast_doBitOp(LLZ80ProcessorState *const z80, const uint8_t opcode, uint8_t *const value)
+{
+	const LLZ80InternalInstructionFunction functionTable[] =
+	{
+		NULL,
+		llz80_iop_bit,
+		llz80_iop_res,
+		llz80_iop_set
+	};
+
+	LLZ80InternalInstruction metadata;
+	metadata.extraData.bitOp.mask = (uint8_t)(1 << ((opcode >> 3)&7));
+	metadata.extraData.bitOp.value = llz80_operandOffset(z80, value);
+
+	functionTable[opcode >> 6](z80, &metadata);
+}
+
+/*
+
+	Instruction pages
+
+*/
+static void llz80_fast_executeCBPage(LLZ80FastInstruction *const instruction, const uint16_t address, const bool addOffset)
+{
+	LLZ80ProcessorState *const z80 = instruction->z80;
+	const uint8_t opcode = llz80_fast_fetch(instruction);
+
+	uint8_t *const rTable[] =
+	{
+		&z80->bcRegister.bytes.high,
+		&z80->bcRegister.bytes.low,
+		&z80->deRegister.bytes.high,
+		&z80->deRegister.bytes.low,
+		&z80->hlRegister.bytes.high,
+		&z80->hlRegister.bytes.low,
+		NULL,
+		&z80->aRegister
+	};
+	uint8_t *const value = rTable[opcode&7];
+
+	// register operations are just that
+	if(value && !addOffset)
+	{
+		if(opcode < 0x40)
+			llz80_fast_doShiftOp(z80, opcode >> 3, value);
+		else
+			llz80_fast_doBitOp(z80, opcode, value);
+		return;
+	}
+
+	// otherwise it's a read, the operation and possibly a write; with an
+	// offset, a nominated register also gets a copy of anything written
+	uint8_t operand = llz80_fast_read(instruction, address);
+	if(opcode < 0x40)
+	{
+		llz80_fast_doShiftOp(z80, opcode >> 3, &operand);
+	}
+	else
+	{
+		if(!addOffset) llz80_fast_pauseForCycles(instruction, 1);
+
+		// bit operations act upon an operand held by the processor,
+		// so this goes via the temporary value as it would if queued
+		z80->temporary8bitValue = operand;
+		llz80_fast_doBitOp(z80, opcode, &z80->temporary8bitValue);
+		operand = z80->temporary8bitValue;
+
+		if(!(opcode&0x80)) return;
+	}
+
+	if(value) *value = operand;
+	llz80_fast_write(instruction, address, operand);
+}
+
+static void llz80_fast_executeEDPage(LLZ80FastInstruction *const instruction)
+{
+	LLZ80ProcessorState *const z80 = instruction->z80;
+	const uint8_t opcode = llz80_fast_fetch(instruction);
+
+	LLZ80RegisterPair *const rpTable[] =
+	{
+		&z80->bcRegister,
+		&z80->deRegister,
+		&z80->hlRegister,
+		&z80->spRegister
+	};
+
+	switch(opcode)
+	{
+		default:
+			// everything not defined below is a two-byte nop, essentially
+		break;
+
+		// in and out, in all their forms, and
+		// the returns that affect interrupts
+		case 0x40:	case 0x48:	case 0x50:	case 0x58:
+		case 0x60:	case 0x68:	case 0x70:	case 0x78:
+		case 0x41:	case 0x49:	case 0x51:	case 0x59:
+		case 0x61:	case 0x69:	case 0x71:	case 0x79:
+		case 0xa2:	case 0xaa:	case 0xb2:	case 0xba:
+		case 0xa3:	case 0xab:	case 0xb3:	case 0xbb:
+		case 0x45:	case 0x4d:	case 0x55:	case 0x5d:
+		case 0x65:	case 0x6d:	case 0x75:	case 0x7d:
+			instruction->needsBus = true;
+		break;
+
+		// im 0, 1 and 2
+		case 0x4e:	case 0x66:	case 0x6e:	case 0x46:
+								z80->interruptMode = 0;	break;
+		case 0x76:	case 0x56:	z80->interruptMode = 1;	break;
+		case 0x7e:	case 0x5e:	z80->interruptMode = 2;	break;
+
+		case 0x42:	case 0x52:	// sbc hl, rr
+		case 0x62:	case 0x72:
+			llz80_fast_pauseForCycles(instruction, 7);
+			llz80_subtractWithCarry_16bit(z80, &z80->hlRegister, &rpTable[(opcode >> 4)&3]->fullValue);
+		break;
+
+		case 0x4a:	case 0x5a:	// adc hl, rr
+		case 0x6a:	case 0x7a:
+			llz80_fast_pauseForCycles(instruction, 7);
+			llz80_addWithCarry_16bit(z80, &z80->hlRegister, &rpTable[(opcode >> 4)&3]->fullValue);
+		break;
+
+		case 0x57:	// ld a, i
+		case 0x5f:	// ld a, r
+			llz80_fast_pauseForCycles(instruction, 1);
+
+			z80->aRegister = (opcode == 0x57) ? z80->iRegister : z80->rRegister;
+			z80->lastSignResult = z80->lastZeroResult = z80->bit5And3Flags = z80->aRegister;
+			z80->generalFlags =
+				(z80->generalFlags&LLZ80FlagCarry) |
+				(z80->iff2 ? LLZ80FlagParityOverflow : 0);
+		break;
+
+		case 0x47:	// ld i, a
+			llz80_fast_pauseForCycles(instruction, 1);
+			z80->iRegister = z80->aRegister;
+		break;
+
+		case 0x4f:	// ld r, a
+			llz80_fast_pauseForCycles(instruction, 1);
+			z80->rRegister = z80->aRegister;
+		break;
+
+		case 0x43:	case 0x53: // ld (nn), rr
+		case 0x63:	case 0x73:
+		{
+			const uint16_t address = llz80_fast_read16BitsFromPC(instruction);
+			LLZ80RegisterPair *const source = rpTable[(opcode >> 4)&3];
+
+			llz80_fast_write(instruction, address, source->bytes.low);
+			llz80_fast_write(instruction, (uint16_t)(address+1), source->bytes.high);
+		}
+		break;
+
+		case 0x4b:	case 0x5b: // ld rr, (nn)
+		case 0x6b:	case 0x7b:
+		{
+			const uint16_t address = llz80_fast_read16BitsFromPC(instruction);
+			LLZ80RegisterPair *const destination = rpTable[(opcode >> 4)&3];
+
+			destination->bytes.low = llz80_fast_read(instruction, address);
+			destination->bytes.high = llz80_fast_read(instruction, (uint16_t)(address+1));
+		}
+		break;
+
+		case 0x44:	case 0x4c:	case 0x54:	case 0x5c: // neg
+		case 0x64:	case 0x6c:	case 0x74:	case 0x7c:
+			llz80_negate(z80);
+		break;
+
+		case 0x67:	// rrd
+		case 0x6f:	// rld
+		{
+			uint8_t value = llz80_fast_read(instruction, z80->hlRegister.fullValue);
+			llz80_fast_pauseForCycles(instruction, 4);
+
+			if(opcode == 0x67)
+				llz80_rrd(z80, &value);
+			else
+				llz80_rld(z80, &value);
+
+			llz80_fast_write(instruction, z80->hlRegister.fullValue, value);
+		}
+		break;
+
+		case 0xa0:	// ldi
+		case 0xa8:	// ldd
+		case 0xb0:	// ldir
+		case 0xb8:	// lddr
+		{
+			const uint8_t value = llz80_fast_read(instruction, z80->hlRegister.fullValue);
+			llz80_fast_write(instruction, z80->deRegister.fullValue, value);
+
+			z80->bcRegister.fullValue--;
+			if(opcode&8)
+			{
+				z80->deRegister.fullValue--;
+				z80->hlRegister.fullValue--;
+			}
+			else
+			{
+				z80->deRegister.fullValue++;
+				z80->hlRegister.fullValue++;
+			}
+			llz80_setBlockTransferFlags(z80, value);
+
+			if((opcode&0x10) && z80->bcRegister.fullValue)
+			{
+				z80->pcRegister.fullValue -= 2;
+				llz80_fast_pauseForCycles(instruction, 5);
+			}
+			llz80_fast_pauseForCycles(instruction, 2);
+		}
+		break;
+
+		case 0xa1:	// cpi
+		case 0xa9:	// cpd
+		case 0xb1:	// cpir
+		case 0xb9:	// cpdr
+		{
+			const uint8_t value = llz80_fast_read(instruction, z80->hlRegister.fullValue);
+			llz80_fast_pauseForCycles(instruction, 3);
+
+			z80->bcRegister.fullValue--;
+			if(opcode&8)
+				z80->hlRegister.fullValue--;
+			else
+				z80->hlRegister.fullValue++;
+			llz80_setBlockCompareFlags(z80, value);
+
+			if((opcode&0x10) && z80->bcRegister.fullValue && z80->lastZeroResult)
+			{
+				z80->pcRegister.fullValue -= 2;
+				llz80_fast_pauseForCycles(instruction, 5);
+			}
+			llz80_fast_pauseForCycles(instruction, 2);
+		}
+		break;
+	}
+}
+
+static void llz80_fast_executeStandardPage(LLZ80FastInstruction *const instruction, LLZ80RegisterPair *const indexRegister, const bool addOffset)
+{
+	LLZ80ProcessorState *const z80 = instruction->z80;
+	const uint8_t opcode = llz80_fast_fetch(instruction);
+
+	uint8_t *const rTable[] =
+	{
+		&z80->bcRegister.bytes.high,
+		&z80->bcRegister.bytes.low,
+		&z80->deRegister.bytes.high,
+		&z80->deRegister.bytes.low,
+		&indexRegister->bytes.high,
+		&indexRegister->bytes.low,
+		NULL,
+		&z80->aRegister
+	};
+
+	// NB: if an offset and a memory read/write is involved,
+	// the named register is always one of H or L, not
+	// half of one of the index registers
+	uint8_t *const rHLTable[] =
+	{
+		&z80->bcRegister.bytes.high,
+		&z80->bcRegister.bytes.low,
+		&z80->deRegister.bytes.high,
+		&z80->deRegister.bytes.low,
+		&z80->hlRegister.bytes.high,
+		&z80->hlRegister.bytes.low,
+		NULL,
+		&z80->aRegister
+	};
+
+	LLZ80RegisterPair *const rpTable[] =
+	{
+		&z80->bcRegister,
+		&z80->deRegister,
+		indexRegister,
+		&z80->spRegister
+	};
+
+	switch(opcode)
+	{
+		default: break;
+
+		case 0x00:	break;	// nop
+
+		// anything that does input or output, halts or changes
+		// the interrupt flags is left to the bus-accurate core
+		case 0xd3:	// out (n), a
+		case 0xdb:	// in a, (n)
+		case 0x76:	// halt
+		case 0xfb:	// ei and di
+		case 0xf3:
+			instruction->needsBus = true;
+		break;
+
+		case 0xdd:
+		case 0xfd:	// do one of the indexed register pages
+			// a run of prefixes could go on indefinitely, so
+			// anything after the first is left to the bus
+			if(addOffset)
+			{
+				instruction->needsBus = true;
+				break;
+			}
+			llz80_fast_executeStandardPage(instruction, (opcode == 0xdd) ? &z80->ixRegister : &z80->iyRegister, true);
+		break;
+
+		case 0xcb:
+		{
+			// on the CB page you get the displacement
+			// before the final part of the opcode, if relevant
+			const uint16_t address = llz80_fast_sourceAddress(instruction, indexRegister, addOffset);
+			llz80_fast_executeCBPage(instruction, address, addOffset);
+		}
+		break;
+
+		case 0xed:
+			llz80_fast_executeEDPage(instruction);
+		break;
+
+		case 0x10:	// djnz
+		{
+			const int8_t offset = (int8_t)llz80_fast_readFromPC(instruction);
+			z80->bcRegister.bytes.high--;
+
+			if(z80->bcRegister.bytes.high)
+			{
+				llz80_fast_pauseForCycles(instruction, 5);
+				z80->pcRegister.fullValue += offset;
+			}
+			llz80_fast_pauseForCycles(instruction, 1);
+		}
+		break;
+
+		case 0xe9:	// jp hl (or ix or iy)
+			z80->pcRegister = *indexRegister;
+		break;
+
+		case 0xc4:	// call (conditional)
+		case 0xcc:
+		case 0xd4:
+		case 0xdc:
+		case 0xe4:
+		case 0xec:
+		case 0xf4:
+		case 0xfc:
+		case 0xcd:	// call (unconditional)
+		{
+			const uint16_t address = llz80_fast_read16BitsFromPC(instruction);
+			if((opcode == 0xcd) || llz80_conditionIsTrue(z80, (opcode >> 3)&7))
+			{
+				llz80_fast_push(instruction, z80->pcRegister);
+				z80->pcRegister.fullValue = address;
+			}
+		}
+		break;
+
+		case 0xc7:
+		case 0xcf:
+		case 0xd7:
+		case 0xdf:
+		case 0xe7:
+		case 0xef:
+		case 0xf7:
+		case 0xff:	// RSTs
+			llz80_fast_push(instruction, z80->pcRegister);
+			z80->pcRegister.fullValue = opcode & 0x38;
+		break;
+
+		case 0xc9:	// ret (unconditional)
+			llz80_fast_pop(instruction, &z80->pcRegister);
+		break;
+
+		case 0xc0:	// ret (conditional)
+		case 0xc8:
+		case 0xd0:
+		case 0xd8:
+		case 0xe0:
+		case 0xe8:
+		case 0xf0:
+		case 0xf8:
+			llz80_fast_pauseForCycles(instruction, 1);
+			if(llz80_conditionIsTrue(z80, (opcode >> 3)&7))
+				llz80_fast_pop(instruction, &z80->pcRegister);
+		break;
+
+		case 0xc1:	// pop rr
+		case 0xd1:
+		case 0xe1:
+			llz80_fast_pop(instruction, rpTable[(opcode >> 4)&3]);
+		break;
+
+		case 0xc5:	// push rr
+		case 0xd5:
+		case 0xe5:
+			llz80_fast_push(instruction, *rpTable[(opcode >> 4)&3]);
+		break;
+
+		case 0xf1:	// pop af
+		{
+			const uint8_t flags = llz80_fast_read(instruction, z80->spRegister.fullValue++);
+			z80->aRegister = llz80_fast_read(instruction, z80->spRegister.fullValue++);
+			llz80_setF(z80, flags);
+		}
+		break;
+
+		case 0xf5:	// push af
+		{
+			LLZ80RegisterPair value;
+			value.bytes.high = z80->aRegister;
+			value.bytes.low = llz80_getF(z80);
+			llz80_fast_push(instruction, value);
+		}
+		break;
+
+		case 0x01:	// ld rr, nn
+		case 0x11:
+		case 0x21:
+		case 0x31:
+			rpTable[opcode >> 4]->fullValue = llz80_fast_read16BitsFromPC(instruction);
+		break;
+
+		case 0x2a:	// ld hl, (nn) (or ix/iy)
+		{
+			const uint16_t address = llz80_fast_read16BitsFromPC(instruction);
+			indexRegister->bytes.low = llz80_fast_read(instruction, address);
+			indexRegister->bytes.high = llz80_fast_read(instruction, (uint16_t)(address+1));
+		}
+		break;
+
+		case 0x22:	// ld (nn), hl (or ix/iy)
+		{
+			const uint16_t address = llz80_fast_read16BitsFromPC(instruction);
+			llz80_fast_write(instruction, address, indexRegister->bytes.low);
+			llz80_fast_write(instruction, (uint16_t)(address+1), indexRegister->bytes.high);
+		}
+		break;
+
+		case 0x32:	// ld (nn), a
+			llz80_fast_write(instruction, llz80_fast_read16BitsFromPC(instruction), z80->aRegister);
+		break;
+
+		case 0x3a:	// ld a, (nn)
+			z80->aRegister = llz80_fast_read(instruction, llz80_fast_read16BitsFromPC(instruction));
+		break;
+
+		case 0x02:	llz80_fast_write(instruction, z80->bcRegister.fullValue, z80->aRegister);		break;	// ld (bc), a
+		case 0x0a:	z80->aRegister = llz80_fast_read(instruction, z80->bcRegister.fullValue);		break;	// ld a, (bc)
+		case 0x12:	llz80_fast_write(instruction, z80->deRegister.fullValue, z80->aRegister);		break;	// ld (de), a
+		case 0x1a:	z80->aRegister = llz80_fast_read(instruction, z80->deRegister.fullValue);		break;	// ld a, (de)
+
+		case 0x27:		llz80_decimalAdjustAccumulator(z80);	break;	// daa
+		case 0x3f:		llz80_complementCarryFlag(z80);	break;	// ccf
+		case 0x37:		llz80_setCarryFlag(z80);		break;	// scf
+		case 0x2f:		llz80_complement(z80);			break;	// cpl
+
+		case 0x06:
+		case 0x0e:
+		case 0x16:
+		case 0x1e:
+		case 0x26:
+		case 0x2e:
+		case 0x36:
+		case 0x3e:	// ld r, n
+		{
+			uint8_t *const destination = rTable[opcode >> 3];
+
+			if(destination)
+				*destination = llz80_fast_readFromPC(instruction);
+			else
+			{
+				const uint16_t address = llz80_fast_sourceAddress(instruction, indexRegister, addOffset);
+				llz80_fast_write(instruction, address, llz80_fast_readFromPC(instruction));
+			}
+		}
+		break;
+
+		case 0x0b:
+		case 0x1b:
+		case 0x2b:
+		case 0x3b:	// dec rr
+			rpTable[opcode >> 4]->fullValue --;
+			llz80_fast_pauseForCycles(instruction, 2);
+		break;
+
+		case 0x03:
+		case 0x13:
+		case 0x23:
+		case 0x33:	// inc rr
+			rpTable[opcode >> 4]->fullValue ++;
+			llz80_fast_pauseForCycles(instruction, 2);
+		break;
+
+		case 0x07:		llz80_rlca(z80);	break;	// rlca
+		case 0x0f:		llz80_rrca(z80);	break;	// rrca
+		case 0x17:		llz80_rla(z80);		break;	// rla
+		case 0x1f:		llz80_rra(z80);		break;	// rra
+
+		case 0x08:		// ex af, af'
+		{
+			uint8_t temporaryStore;
+
+			temporaryStore = z80->aRegister;
+			z80->aRegister = z80->aDashRegister;
+			z80->aDashRegister = temporaryStore;
+
+			temporaryStore = llz80_getF(z80);
+			llz80_setF(z80, z80->fDashRegister);
+			z80->fDashRegister = temporaryStore;
+		}
+		break;
+
+		case 0xd9:		// exx
+		{
+			LLZ80RegisterPair temporaryStore;
+
+			temporaryStore = z80->bcRegister;
+			z80->bcRegister = z80->bcDashRegister;
+			z80->bcDashRegister = temporaryStore;
+
+			temporaryStore = z80->deRegister;
+			z80->deRegister = z80->deDashRegister;
+			z80->deDashRegister = temporaryStore;
+
+			temporaryStore = z80->hlRegister;
+			z80->hlRegister = z80->hlDashRegister;
+			z80->hlDashRegister = temporaryStore;
+		}
+		break;
+
+		case 0xeb:		// ex de, hl	(always hl, not an index register)
+		{
+			LLZ80RegisterPair temporaryStore;
+
+			temporaryStore = z80->deRegister;
+			z80->deRegister = z80->hlRegister;
+			z80->hlRegister = temporaryStore;
+		}
+		break;
+
+		case 0xe3:		// ex (sp), [index pointer]
+		{
+			LLZ80RegisterPair value;
+			llz80_fast_pop(instruction, &value);
+			llz80_fast_push(instruction, *indexRegister);
+			*indexRegister = value;
+
+			llz80_fast_pauseForCycles(instruction, 2);
+		}
+		break;
+
+		case 0x20:
+		case 0x28:
+		case 0x30:
+		case 0x38:	// jr ss, e
+		case 0x18:	// jr e
+		{
+			const int8_t offset = (int8_t)llz80_fast_readFromPC(instruction);
+			if((opcode == 0x18) || llz80_conditionIsTrue(z80, (opcode >> 3)&3))
+			{
+				z80->pcRegister.fullValue += offset;
+				llz80_fast_pauseForCycles(instruction, 5);
+			}
+		}
+		break;
+
+		case 0xc2:	// jp cc, nn
+		case 0xca:
+		case 0xd2:
+		case 0xda:
+		case 0xe2:
+		case 0xea:
+		case 0xf2:
+		case 0xfa:
+		case 0xc3:	// jp nn
+		{
+			const uint16_t address = llz80_fast_read16BitsFromPC(instruction);
+			if((opcode == 0xc3) || llz80_conditionIsTrue(z80, (opcode >> 3)&7))
+				z80->pcRegister.fullValue = address;
+		}
+		break;
+
+		case 0x09:
+		case 0x19:
+		case 0x29:
+		case 0x39:	// add [current index register], ss
+			llz80_fast_pauseForCycles(instruction, 7);
+			llz80_add_16bit(z80, indexRegister, &rpTable[opcode >> 4]->fullValue);
+		break;
+
+		case 0x04: case 0x05:
+		case 0x0c: case 0x0d:
+		case 0x14: case 0x15:
+		case 0x1c: case 0x1d:
+		case 0x24: case 0x25:
+		case 0x2c: case 0x2d:
+		case 0x34: case 0x35:
+		case 0x3c: case 0x3d:	// inc r and dec r
+		{
+			uint8_t *source = rTable[opcode >> 3];
+			uint16_t address = 0;
+			uint8_t value;
+
+			if(!source)
+			{
+				address = llz80_fast_sourceAddress(instruction, indexRegister, addOffset);
+				value = llz80_fast_read(instruction, address);
+				llz80_fast_pauseForCycles(instruction, 1);
+				source = &value;
+			}
+
+			if(opcode&1)
+				llz80_decrement_8bit(z80, source);
+			else
+				llz80_increment_8bit(z80, source);
+
+			if(source == &value)
+				llz80_fast_write(instruction, address, value);
+		}
+		break;
+
+		// ld r, r
+		case 0x40: case 0x41: case 0x42: case 0x43: case 0x44: case 0x45: case 0x46: case 0x47:
+		case 0x48: case 0x49: case 0x4a: case 0x4b: case 0x4c: case 0x4d: case 0x4e: case 0x4f:
+		case 0x50: case 0x51: case 0x52: case 0x53: case 0x54: case 0x55: case 0x56: case 0x57:
+		case 0x58: case 0x59: case 0x5a: case 0x5b: case 0x5c: case 0x5d: case 0x5e: case 0x5f:
+		case 0x60: case 0x61: case 0x62: case 0x63: case 0x64: case 0x65: case 0x66: case 0x67:
+		case 0x68: case 0x69: case 0x6a: case 0x6b: case 0x6c: case 0x6d: case 0x6e: case 0x6f:
+		case 0x70: case 0x71: case 0x72: case 0x73: case 0x74: case 0x75:            case 0x77:
+		case 0x78: case 0x79: case 0x7a: case 0x7b: case 0x7c: case 0x7d: case 0x7e: case 0x7f:
+		{
+			uint8_t *const source = rTable[opcode&7];
+			uint8_t *const destination = rTable[(opcode >> 3)&7];
+
+			if(source && destination)
+			{
+				*destination = *source;
+				break;
+			}
+
+			const uint16_t address = llz80_fast_sourceAddress(instruction, indexRegister, addOffset);
+			if(!source)
+				*rHLTable[(opcode >> 3)&7] = llz80_fast_read(instruction, address);
+			else
+				llz80_fast_write(instruction, address, *rHLTable[opcode&7]);
+		}
+		break;
+
+		case 0xc6:	// ALU operations that take an immediate operand
+		case 0xce:
+		case 0xd6:
+		case 0xde:
+		case 0xe6:
+		case 0xee:
+		case 0xf6:
+		case 0xfe:
+			llz80_fast_doALUOp(z80, (opcode >> 3)&7, llz80_fast_readFromPC(instruction));
+		break;
+
+		// [most of] the ALU operations, en masse
+		case 0x80: case 0x81: case 0x82: case 0x83: case 0x84: case 0x85: case 0x86: case 0x87:
+		case 0x88: case 0x89: case 0x8a: case 0x8b: case 0x8c: case 0x8d: case 0x8e: case 0x8f:
+		case 0x90: case 0x91: case 0x92: case 0x93: case 0x94: case 0x95: case 0x96: case 0x97:
+		case 0x98: case 0x99: case 0x9a: case 0x9b: case 0x9c: case 0x9d: case 0x9e: case 0x9f:
+		case 0xa0: case 0xa1: case 0xa2: case 0xa3: case 0xa4: case 0xa5: case 0xa6: case 0xa7:
+		case 0xa8: case 0xa9: case 0xaa: case 0xab: case 0xac: case 0xad: case 0xae: case 0xaf:
+		case 0xb0: case 0xb1: case 0xb2: case 0xb3: case 0xb4: case 0xb5: case 0xb6: case 0xb7:
+		case 0xb8: case 0xb9: case 0xba: case 0xbb: case 0xbc: case 0xbd: case 0xbe: case 0xbf:
+		{
+			uint8_t *const source = rTable[opcode&7];
+
+			if(source)
+				llz80_fast_doALUOp(z80, (opcode >> 3)&7, *source);
+			else
+			{
+				const uint16_t address = llz80_fast_sourceAddress(instruction, indexRegister, addOffset);
+				llz80_fast_doALUOp(z80, (opcode >> 3)&7, llz80_fast_read(instruction, address));
+			}
+		}
+		break;
+
+		case 0xf9:	// ld sp, indexRegister
+			z80->spRegister.fullValue = indexRegister->fullValue;
+			llz80_fast_pauseForCycles(instruction, 2);
+		break;
+	}
+}
+
+unsigned int llz80_fast_executeInstruction(LLZ80ProcessorState *const z80)
+{
+	// if the bus is still seeing the end of a write from the last instruction
+	// then memory may not have taken it yet, so this one has to use the bus
+	if(llz80_linesAreActive(z80, LLZ80SignalWrite))
+		return 0;
+
+	LLZ80FastInstruction instruction;
+	instruction.z80 = z80;
+	instruction.halfCycles = 0;
+	instruction.needsBus = false;
+	instruction.numberOfWrites = 0;
+
+	// keep a copy of the registers in case this has to be abandoned
+	uint8_t registers[kLLZ80FastModeRegistersLength];
+	memcpy(registers, (uint8_t *)z80 + kLLZ80FastModeRegistersStart, kLLZ80FastModeRegistersLength);
+
+	llz80_fast_executeStandardPage(&instruction, &z80->hlRegister, false);
+
+	if(instruction.needsBus)
+	{
+		memcpy((uint8_t *)z80 + kLLZ80FastModeRegistersStart, registers, kLLZ80FastModeRegistersLength);
+		return 0;
+	}
+
+	// the instruction is complete, so its writes can happen now
+	for(unsigned int write = 0; write < instruction.numberOfWrites; write++)
+		*instruction.writeTargets[write] = instruction.writeValues[write];
+
+	return instruction.halfCycles;
+}
@@ -0,0 +1,19 @@
+//
+//  FastExecution.h
+//  LLZ80
+//
+//  Created by Thomas Harte on 05/12/2011.
+//  Copyright (c) 2011 Thomas Harte. All rights reserved.
+//
+
+#ifndef LLZ80_FastExecution_h
+#define LLZ80_FastExecution_h
+
+#include "../Z80Internals.h"
+
+// executes the whole of the instruction at the program counter, returning the
+// number of half cycles it would have taken; if it needs the bus then nothing
+// is changed and 0 is returned, leaving it to the bus-accurate core
+unsigned int llz80_fast_executeInstruction(LLZ80ProcessorState *const z80);
+
+#endif
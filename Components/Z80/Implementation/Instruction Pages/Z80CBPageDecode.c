@@ -7,17 +7,18 @@
 //
 
 #include <stdio.h>
-#include "Z80EDPageDecode.h"
+#include "Z80CBPageDecode.h"
 
 #include "../Scheduling Building Blocks/Z80ScheduleReadOrWrite.h"
 #include "../Scheduling Building Blocks/Z80StandardSchedulingComponents.h"
+#include "../Scheduling Building Blocks/Z80ScheduleTemplates.h"
 
 #include "../Operations/Z80SetResetTestOps.h"
 #include "../Operations/Z80RotateAndShiftOps.h"
 
 LLZ80iop(llz80_iop_copyTemporary8BitValueToRegister)
 {
-	*instruction->extraData.referenceToRegister.registerReference = z80->temporary8bitValue;
+	*llz80_operand(z80, uint8_t, instruction->extraData.referenceToRegister.registerReference) = z80->temporary8bitValue;
 }
 
 LLZ80iop_restrict(llz80_iop_doShiftOp)
@@ -37,13 +38,13 @@ LLZ80iop_restrict(llz80_iop_doShiftOp)
 
 #define llz80_metadata_setMaskAndValue(metadata, maskVal, valueVal)	\
 	(metadata)->extraData.bitOp.mask = (uint8_t)(maskVal);\
-	(metadata)->extraData.bitOp.value = (valueVal);
+	(metadata)->extraData.bitOp.value = llz80_operandOffset(z80, valueVal);
 
-LLZ80iop_restrict(llz80_iop_CBPageDecode_imp)
+// as for the standard page, this schedules whatever the opcode does on the bus
+// to produce its template, leaving anything that can be done immediately to
+// the decode
+static void llz80_scheduleCBPageOpcode(LLZ80ProcessorState *const z80, uint8_t opcode, bool addOffset)
 {
-	uint8_t opcode = z80->temporary8bitValue;
-	bool addOffset = instruction->extraData.opcodeDecode.addOffset;
-
 	uint8_t *const rTable[] =
 	{
 		&z80->bcRegister.bytes.high,
@@ -81,7 +82,7 @@ LLZ80iop_restrict(llz80_iop_CBPageDecode_imp)
 				if(value)
 				{
 					llz80_scheduleFunction(z80, llz80_iop_copyTemporary8BitValueToRegister)
-						->extraData.referenceToRegister.registerReference = value;
+						->extraData.referenceToRegister.registerReference = llz80_operandOffset(z80, value);
 				}
 				llz80_scheduleWrite(z80, &z80->temporary8bitValue, &z80->temporaryAddress.fullValue);
 			}
@@ -111,7 +112,7 @@ LLZ80iop_restrict(llz80_iop_CBPageDecode_imp)
 				{
 					if(value)
 						llz80_scheduleFunction(z80, llz80_iop_copyTemporary8BitValueToRegister)
-							->extraData.referenceToRegister.registerReference = value;
+							->extraData.referenceToRegister.registerReference = llz80_operandOffset(z80, value);
 					llz80_scheduleWrite(z80, &z80->temporary8bitValue, &z80->temporaryAddress.fullValue);
 				}
 
@@ -135,21 +136,7 @@ LLZ80iop_restrict(llz80_iop_CBPageDecode_imp)
 			{
 				int operation = opcode >> 3;
 
-				if(value)
-				{
-					switch (operation)
-					{
-						case 0: llz80_rlc(z80, value); break;
-						case 1: llz80_rrc(z80, value); break;
-						case 2: llz80_rl(z80, value); break;
-						case 3: llz80_rr(z80, value); break;
-						case 4: llz80_sla(z80, value); break;
-						case 5: llz80_sra(z80, value); break;
-						case 6: llz80_sll(z80, value); break;
-						case 7: llz80_srl(z80, value); break;
-					}
-				}
-				else
+				if(!value)
 				{
 					llz80_scheduleRead(z80, &z80->temporary8bitValue, &z80->hlRegister.fullValue);
 					llz80_scheduleFunction(z80, llz80_iop_doShiftOp)->extraData.ALUOrShiftOp.operation = operation;
@@ -168,14 +155,7 @@ LLZ80iop_restrict(llz80_iop_CBPageDecode_imp)
 					llz80_iop_set
 				};
 
-				if(value)
-				{
-					LLZ80InternalInstruction halfCycleMetaData;
-					llz80_metadata_setMaskAndValue(&halfCycleMetaData, 1 << ((opcode >> 3)&7), value);
-
-					functionTable[opcode >> 6](z80, &halfCycleMetaData);
-				}
-				else
+				if(!value)
 				{
 					llz80_scheduleRead(z80, &z80->temporary8bitValue, &z80->hlRegister.fullValue);
 
@@ -197,4 +177,78 @@ LLZ80iop_restrict(llz80_iop_CBPageDecode_imp)
 	}
 }
 
+LLZ80iop_restrict(llz80_iop_CBPageDecode_imp)
+{
+	uint8_t opcode = z80->temporary8bitValue;
+	bool addOffset = instruction->extraData.opcodeDecode.addOffset;
+
+	uint8_t *const rTable[] =
+	{
+		&z80->bcRegister.bytes.high,
+		&z80->bcRegister.bytes.low,
+		&z80->deRegister.bytes.high,
+		&z80->deRegister.bytes.low,
+		&z80->hlRegister.bytes.high,
+		&z80->hlRegister.bytes.low,
+		NULL,
+		&z80->aRegister
+	};
+	uint8_t *const value = rTable[opcode&7];
+
+	// operations purely on registers happen immediately
+	if(!addOffset && value)
+	{
+		if(opcode < 0x40)
+		{
+			// roll/shift
+			switch(opcode >> 3)
+			{
+				case 0: llz80_rlc(z80, value); break;
+				case 1: llz80_rrc(z80, value); break;
+				case 2: llz80_rl(z80, value); break;
+				case 3: llz80_rr(z80, value); break;
+				case 4: llz80_sla(z80, value); break;
+				case 5: llz80_sra(z80, value); break;
+				case 6: llz80_sll(z80, value); break;
+				case 7: llz80_srl(z80, value); break;
+			}
+		}
+		else
+		{
+			// bit, res, set
+			const LLZ80InternalInstructionFunction functionTable[] =
+			{
+				NULL,
+				llz80_iop_bit,
+				llz80_iop_res, 
+				llz80_iop_set
+			};
+
+			LLZ80InternalInstruction halfCycleMetaData;
+			llz80_metadata_setMaskAndValue(&halfCycleMetaData, 1 << ((opcode >> 3)&7), value);
+
+			functionTable[opcode >> 6](z80, &halfCycleMetaData);
+		}
+		return;
+	}
+
+	llz80_scheduleTemplate(z80, z80->templates->CBPage[addOffset][opcode]);
+}
+
 const LLZ80InternalInstructionFunction llz80_iop_CBPageDecode = llz80_iop_CBPageDecode_imp;
+
+bool llz80_buildCBPageTemplates(LLZ80ProcessorState *const z80, LLZ80InstructionTemplates *const templates)
+{
+	for(unsigned int addOffset = 0; addOffset < 2; addOffset++)
+	{
+		for(unsigned int opcode = 0; opcode < 256; opcode++)
+		{
+			llz80_beginTemplate(z80);
+			llz80_scheduleCBPageOpcode(z80, (uint8_t)opcode, !!addOffset);
+			if(!llz80_endTemplate(z80, templates, &templates->CBPage[addOffset][opcode]))
+				return false;
+		}
+	}
+
+	return true;
+}
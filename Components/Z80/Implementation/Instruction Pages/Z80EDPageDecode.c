@@ -12,18 +12,13 @@
 #include "../Scheduling Building Blocks/Z80ScheduleInputOrOutput.h"
 #include "../Scheduling Building Blocks/Z80StandardSchedulingComponents.h"
 #include "../Scheduling Building Blocks/Z80ScheduleReadOrWrite.h"
+#include "../Scheduling Building Blocks/Z80ScheduleTemplates.h"
 
 #include "../Operations/Z80Arithmetic16BitOps.h"
-
-static void llz80_setLDFlags(LLZ80ProcessorState *const z80)
-{
-	uint8_t n = z80->aRegister + z80->temporary8bitValue;
-	
-	z80->generalFlags =
-		(z80->generalFlags&LLZ80FlagCarry) |
-		(z80->bcRegister.fullValue ? LLZ80FlagParityOverflow : 0);
-	z80->bit5And3Flags = (uint8_t)((n&0x8) | ((n&0x2) << 4));
-}
+#include "../Operations/Z80Arithmetic8BitOps.h"
+#include "../Operations/Z80RotateAndShiftOps.h"
+#include "../Operations/Z80BlockOps.h"
+#include "../Operations/Z80FlagTables.h"
 
 LLZ80iop_restrict(llz80_iop_finishLDI)
 {
@@ -31,7 +26,7 @@ LLZ80iop_restrict(llz80_iop_finishLDI)
 	z80->deRegister.fullValue++;
 	z80->hlRegister.fullValue++;
 
-	llz80_setLDFlags(z80);
+	llz80_setBlockTransferFlags(z80, z80->temporary8bitValue);
 }
 
 LLZ80iop_restrict(llz80_iop_finishLDIR)
@@ -40,7 +35,7 @@ LLZ80iop_restrict(llz80_iop_finishLDIR)
 	z80->deRegister.fullValue++;
 	z80->hlRegister.fullValue++;
 
-	llz80_setLDFlags(z80);
+	llz80_setBlockTransferFlags(z80, z80->temporary8bitValue);
 
 	if(z80->bcRegister.fullValue)
 	{
@@ -55,7 +50,7 @@ LLZ80iop_restrict(llz80_iop_finishLDD)
 	z80->deRegister.fullValue--;
 	z80->hlRegister.fullValue--;
 
-	llz80_setLDFlags(z80);
+	llz80_setBlockTransferFlags(z80, z80->temporary8bitValue);
 }
 
 LLZ80iop_restrict(llz80_iop_finishLDDR)
@@ -64,7 +59,7 @@ LLZ80iop_restrict(llz80_iop_finishLDDR)
 	z80->deRegister.fullValue--;
 	z80->hlRegister.fullValue--;
 
-	llz80_setLDFlags(z80);
+	llz80_setBlockTransferFlags(z80, z80->temporary8bitValue);
 	if(z80->bcRegister.fullValue)
 	{
 		z80->pcRegister.fullValue -= 2;
@@ -72,31 +67,12 @@ LLZ80iop_restrict(llz80_iop_finishLDDR)
 	}
 }
 
-static void llz80_setCPFlags(LLZ80ProcessorState *const z80)
-{
-	uint8_t result = z80->aRegister - z80->temporary8bitValue;
-	uint8_t halfResult = (z80->aRegister&0xf) - (z80->temporary8bitValue&0xf);
-
-	// sign, zero, half-carry: set by compare of (hl) and a
-	// yf, xf: copies of bits 1 and 3 of n
-	// parity: set if bc is not 0
-	// subtract: set
-
-	z80->generalFlags =
-		(z80->generalFlags&LLZ80FlagCarry) |
-		(z80->bcRegister.fullValue ? LLZ80FlagParityOverflow : 0) |
-		(halfResult & LLZ80FlagHalfCarry) |
-		LLZ80FlagSubtraction;
-	z80->bit5And3Flags = (uint8_t)((result&0x8) | ((result&0x2) << 4));
-	z80->lastSignResult = z80->lastZeroResult = result;
-}
-
 LLZ80iop_restrict(llz80_iop_finishCPI)
 {
 	z80->bcRegister.fullValue--;
 	z80->hlRegister.fullValue++;
 
-	llz80_setCPFlags(z80);
+	llz80_setBlockCompareFlags(z80, z80->temporary8bitValue);
 }
 
 LLZ80iop_restrict(llz80_iop_finishCPIR)
@@ -104,7 +80,7 @@ LLZ80iop_restrict(llz80_iop_finishCPIR)
 	z80->bcRegister.fullValue--;
 	z80->hlRegister.fullValue++;
 
-	llz80_setCPFlags(z80);
+	llz80_setBlockCompareFlags(z80, z80->temporary8bitValue);
 
 	if(z80->bcRegister.fullValue && z80->lastZeroResult)
 	{
@@ -118,7 +94,7 @@ LLZ80iop_restrict(llz80_iop_finishCPD)
 	z80->bcRegister.fullValue--;
 	z80->hlRegister.fullValue--;
 
-	llz80_setCPFlags(z80);
+	llz80_setBlockCompareFlags(z80, z80->temporary8bitValue);
 }
 
 LLZ80iop_restrict(llz80_iop_finishCPDR)
@@ -126,7 +102,7 @@ LLZ80iop_restrict(llz80_iop_finishCPDR)
 	z80->bcRegister.fullValue--;
 	z80->hlRegister.fullValue--;
 
-	llz80_setCPFlags(z80);
+	llz80_setBlockCompareFlags(z80, z80->temporary8bitValue);
 	if(z80->bcRegister.fullValue && z80->lastZeroResult)
 	{
 		z80->pcRegister.fullValue -= 2;
@@ -147,8 +123,7 @@ static void llz80_setINFlags(LLZ80ProcessorState *const z80, int cAdder)
 	if(summation > 0xff) z80->generalFlags |= LLZ80FlagHalfCarry | LLZ80FlagCarry;
 
 	summation = (summation&7) ^ z80->bcRegister.bytes.high;
-	llz80_calculateParity((uint8_t)summation);
-	z80->generalFlags |= parity;
+	z80->generalFlags |= llz80_parityFlagTable[(uint8_t)summation];
 }
 
 LLZ80iop_restrict(llz80_iop_finishINI)
@@ -200,8 +175,7 @@ static void llz80_setOUTFlags(LLZ80ProcessorState *const z80)
 	if(summation > 0xff) z80->generalFlags |= LLZ80FlagHalfCarry | LLZ80FlagCarry;
 
 	summation = (summation&7) ^ z80->bcRegister.bytes.high;
-	llz80_calculateParity((uint8_t)summation);
-	z80->generalFlags |= parity;
+	z80->generalFlags |= llz80_parityFlagTable[(uint8_t)summation];
 }
 
 LLZ80iop_restrict(llz80_iop_finishOUTI)
@@ -242,30 +216,12 @@ LLZ80iop_restrict(llz80_iop_finishOUTDR)
 
 LLZ80iop_restrict(llz80_iop_doRRD)
 {
-	int lowNibble = z80->aRegister&0xf;
-	z80->aRegister = (z80->aRegister&0xf0) | (z80->temporary8bitValue & 0xf);
-	z80->temporary8bitValue = (uint8_t)((z80->temporary8bitValue >> 4) | (lowNibble << 4));
-
-	llz80_calculateParity(z80->aRegister);
-	z80->generalFlags =
-		parity |
-		(z80->generalFlags&LLZ80FlagCarry);
-	z80->lastSignResult = z80->lastZeroResult =
-	z80->bit5And3Flags = z80->aRegister;
+	llz80_rrd(z80, &z80->temporary8bitValue);
 }
 
 LLZ80iop_restrict(llz80_iop_doRLD)
 {
-	int lowNibble = z80->aRegister&0xf;
-	z80->aRegister = (z80->aRegister&0xf0) | (z80->temporary8bitValue >> 4);
-	z80->temporary8bitValue = (uint8_t)((z80->temporary8bitValue << 4) | lowNibble);
-
-	llz80_calculateParity(z80->aRegister);
-	z80->generalFlags =
-		parity |
-		(z80->generalFlags&LLZ80FlagCarry);
-	z80->lastSignResult = z80->lastZeroResult =
-	z80->bit5And3Flags = z80->aRegister;
+	llz80_rld(z80, &z80->temporary8bitValue);
 }
 
 LLZ80iop_restrict(llz80_iop_setInputFlags)
@@ -317,7 +273,10 @@ static const LLZ80InternalInstructionFunction outInstructions[4] =
 	llz80_iop_finishOUTDR
 };
 
-LLZ80iop_restrict(llz80_iop_EDPageDecode_imp)
+// as for the standard page, this schedules whatever the opcode does on the bus
+// to produce its template, leaving anything that can be done immediately to
+// the decode
+static void llz80_scheduleEDPageOpcode(LLZ80ProcessorState *const z80, uint8_t opcode)
 {
 	// the ed page isn't affected by an fd or dd prefix,
 	// so this is all always HL
@@ -342,19 +301,12 @@ LLZ80iop_restrict(llz80_iop_EDPageDecode_imp)
 		&z80->spRegister
 	};
 
-	uint8_t opcode = z80->temporary8bitValue;
 	switch(opcode)
 	{
 		default:
 			// everything not defined below is a two-byte nop, essentially
 		break;
 
-		// im 0, 1 and 2
-		case 0x4e:	case 0x66:	case 0x6e:	case 0x46:
-								z80->interruptMode = 0;	break;
-		case 0x76:	case 0x56:	z80->interruptMode = 1;	break;
-		case 0x7e:	case 0x5e:	z80->interruptMode = 2;	break;
-		
 		case 0x40:	case 0x48:	case 0x50:	case 0x58:	// in r, (c)
 		case 0x60:	case 0x68:	case 0x70:	case 0x78:
 		{
@@ -373,9 +325,8 @@ LLZ80iop_restrict(llz80_iop_EDPageDecode_imp)
 			if(!source)
 			{
 				// what would otherwise be out (c), (hl) is
-				// actually out (c), 0
+				// actually out (c), 0; the decode zeroes it
 				source = &z80->temporary8bitValue;
-				z80->temporary8bitValue = 0;
 			}
 
 			llz80_scheduleOutput(z80, source, &z80->bcRegister.fullValue);
@@ -384,41 +335,16 @@ LLZ80iop_restrict(llz80_iop_EDPageDecode_imp)
 
 		case 0x42:	case 0x52:	// sbc hl, rr
 		case 0x62:	case 0x72:
-		{
-			llz80_schedulePauseForCycles(z80, 7);
-			llz80_subtractWithCarry_16bit(z80, &z80->hlRegister, &rpTable[(opcode >> 4)&3]->fullValue);
-		}
-		break;
-
 		case 0x4a:	case 0x5a:	// adc hl, rr
 		case 0x6a:	case 0x7a:
-		{
 			llz80_schedulePauseForCycles(z80, 7);
-			llz80_addWithCarry_16bit(z80, &z80->hlRegister, &rpTable[(opcode >> 4)&3]->fullValue);
-		}
 		break;
 
 		case 0x57:	// ld a, i
 		case 0x5f:	// ld a, r
-		{
-			llz80_schedulePauseForCycles(z80, 1);
-
-			z80->aRegister = (opcode == 0x57) ? z80->iRegister : z80->rRegister;
-			z80->lastSignResult = z80->lastZeroResult = z80->bit5And3Flags = z80->aRegister;
-			z80->generalFlags = 
-				(z80->generalFlags&LLZ80FlagCarry) |
-				(z80->iff2 ? LLZ80FlagParityOverflow : 0);
-		}
-		break;
-
 		case 0x47:	// ld i, a
-			llz80_schedulePauseForCycles(z80, 1);
-			z80->iRegister = z80->aRegister;
-		break;
-
 		case 0x4f:	// ld r, a
 			llz80_schedulePauseForCycles(z80, 1);
-			z80->rRegister = z80->aRegister;
 		break;
 
 		case 0x43:	case 0x53: // ld (nn), rr
@@ -459,25 +385,6 @@ LLZ80iop_restrict(llz80_iop_EDPageDecode_imp)
 		}
 		break;
 
-		case 0x44:	case 0x4c:	case 0x54:	case 0x5c: // neg
-		case 0x64:	case 0x6c:	case 0x74:	case 0x7c:
-		{
-			// -128 is the only thing that'll overflow
-			// when negated
-			int overflow = (z80->aRegister == 0x80);
-			int result = 0 - z80->aRegister;
-			int halfResult = 0 - (z80->aRegister&0xf);
-
-			z80->aRegister = (uint8_t)result;
-			z80->bit5And3Flags = z80->lastSignResult = z80->lastZeroResult = z80->aRegister;
-			z80->generalFlags =
-				(overflow ? LLZ80FlagParityOverflow : 0) |
-				LLZ80FlagSubtraction |
-				((result >> 8)&LLZ80FlagCarry) |
-				(halfResult&LLZ80FlagHalfCarry);
-		}
-		break;
-		
 		case 0x4d:	// reti
 		case 0x55:	// retn
 		case 0x5d:
@@ -486,8 +393,6 @@ LLZ80iop_restrict(llz80_iop_EDPageDecode_imp)
 		case 0x75:
 		case 0x7d:
 		case 0x45:
-			z80->iff1 = z80->iff2;
-
 			llz80_scheduleRead(z80, &z80->pcRegister.bytes.low, &z80->spRegister.fullValue);
 			llz80_scheduleFunction(z80, llz80_iop_incrementStackPointer);
 
@@ -578,4 +483,89 @@ LLZ80iop_restrict(llz80_iop_EDPageDecode_imp)
 	}
 }
 
+LLZ80iop_restrict(llz80_iop_EDPageDecode_imp)
+{
+	LLZ80RegisterPair *const rpTable[] =
+	{
+		&z80->bcRegister,
+		&z80->deRegister,
+		&z80->hlRegister,
+		&z80->spRegister
+	};
+
+	uint8_t opcode = z80->temporary8bitValue;
+	switch(opcode)
+	{
+		default: break;
+
+		// im 0, 1 and 2
+		case 0x4e:	case 0x66:	case 0x6e:	case 0x46:
+								z80->interruptMode = 0;	break;
+		case 0x76:	case 0x56:	z80->interruptMode = 1;	break;
+		case 0x7e:	case 0x5e:	z80->interruptMode = 2;	break;
+
+		case 0x71:	// out (c), 0
+			z80->temporary8bitValue = 0;
+		break;
+
+		case 0x42:	case 0x52:	// sbc hl, rr
+		case 0x62:	case 0x72:
+			llz80_subtractWithCarry_16bit(z80, &z80->hlRegister, &rpTable[(opcode >> 4)&3]->fullValue);
+		break;
+
+		case 0x4a:	case 0x5a:	// adc hl, rr
+		case 0x6a:	case 0x7a:
+			llz80_addWithCarry_16bit(z80, &z80->hlRegister, &rpTable[(opcode >> 4)&3]->fullValue);
+		break;
+
+		case 0x57:	// ld a, i
+		case 0x5f:	// ld a, r
+			z80->aRegister = (opcode == 0x57) ? z80->iRegister : z80->rRegister;
+			z80->lastSignResult = z80->lastZeroResult = z80->bit5And3Flags = z80->aRegister;
+			z80->generalFlags = 
+				(z80->generalFlags&LLZ80FlagCarry) |
+				(z80->iff2 ? LLZ80FlagParityOverflow : 0);
+		break;
+
+		case 0x47:	// ld i, a
+			z80->iRegister = z80->aRegister;
+		break;
+
+		case 0x4f:	// ld r, a
+			z80->rRegister = z80->aRegister;
+		break;
+
+		case 0x44:	case 0x4c:	case 0x54:	case 0x5c: // neg
+		case 0x64:	case 0x6c:	case 0x74:	case 0x7c:
+			llz80_negate(z80);
+		break;
+
+		case 0x4d:	// reti
+		case 0x55:	// retn
+		case 0x5d:
+		case 0x65:
+		case 0x6d:
+		case 0x75:
+		case 0x7d:
+		case 0x45:
+			z80->iff1 = z80->iff2;
+		break;
+	}
+
+	llz80_scheduleTemplate(z80, z80->templates->EDPage[opcode]);
+}
+
 const LLZ80InternalInstructionFunction llz80_iop_EDPageDecode = llz80_iop_EDPageDecode_imp;
+
+bool llz80_buildEDPageTemplates(LLZ80ProcessorState *const z80, LLZ80InstructionTemplates *const templates)
+{
+	for(unsigned int opcode = 0; opcode < 256; opcode++)
+	{
+		llz80_beginTemplate(z80);
+		llz80_scheduleEDPageOpcode(z80, (uint8_t)opcode);
+		if(!llz80_endTemplate(z80, templates, &templates->EDPage[opcode]))
+			return false;
+	}
+
+	return true;
+}
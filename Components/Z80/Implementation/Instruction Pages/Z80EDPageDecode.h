@@ -12,5 +12,6 @@
 #include "../Z80Internals.h"
 
 extern const LLZ80InternalInstructionFunction llz80_iop_EDPageDecode;
+extern bool llz80_buildEDPageTemplates(LLZ80ProcessorState *const z80, LLZ80InstructionTemplates *const templates);
 
 #endif
@@ -7,143 +7,160 @@
 //
 
 #include "Z80Arithmetic8BitOps.h"
+#include "Z80FlagTables.h"
 
 void llz80_compare(LLZ80ProcessorState *const z80, uint8_t value)
 {
-	int result = z80->aRegister - value;
-	int halfResult = (z80->aRegister&0xf) - (value&0xf);
-
-	// overflow for a subtraction is when the signs were originally
-	// different and the result is different again
-	int overflow = (value^z80->aRegister) & (result^z80->aRegister);
-
 	z80->lastSignResult =			// set sign and zero
-	z80->lastZeroResult = (uint8_t)result;
+	z80->lastZeroResult = (uint8_t)(z80->aRegister - value);
 	z80->bit5And3Flags = value;		// set the 5 and 3 flags, which come
 									// from the operand atypically
-	z80->generalFlags =
-		((result >> 8) & LLZ80FlagCarry)	|		// carry flag
-		(halfResult & LLZ80FlagHalfCarry)	|		// half carry flag
-		((overflow&0x80) >> 5)				|		// overflow flag
-		LLZ80FlagSubtraction;						// and this counts as a subtraction
+	z80->generalFlags = llz80_subtractFlagTable[0][(z80->aRegister << 8) | value];
 }
 
 void llz80_subtract_8bit(LLZ80ProcessorState *const z80, uint8_t value)
 {
-	int result = z80->aRegister - value;
-	int halfResult = (z80->aRegister&0xf) - (value&0xf);
-
-	// overflow for a subtraction is when the signs were originally
-	// different and the result is different again
-	int overflow = (value^z80->aRegister) & (result^z80->aRegister);
-
-	z80->aRegister = (uint8_t)result;
+	z80->generalFlags = llz80_subtractFlagTable[0][(z80->aRegister << 8) | value];
+	z80->aRegister -= value;
 
 	z80->lastSignResult = z80->lastZeroResult =
-	z80->bit5And3Flags = (uint8_t)result;			// set sign, zero and 5 and 3
-	z80->generalFlags =
-		((result >> 8) & LLZ80FlagCarry)	|		// carry flag
-		(halfResult & LLZ80FlagHalfCarry)	|		// half carry flag
-		((overflow&0x80) >> 5)				|		// overflow flag
-		LLZ80FlagSubtraction;						// and this counts as a subtraction
+	z80->bit5And3Flags = z80->aRegister;			// set sign, zero and 5 and 3
 }
 
 void llz80_subtractWithCarry_8bit(LLZ80ProcessorState *const z80, uint8_t value)
 {
-	int result = z80->aRegister - value - (z80->generalFlags&LLZ80FlagCarry);
-	int halfResult = (z80->aRegister&0xf) - (value&0xf) - (z80->generalFlags&LLZ80FlagCarry);;
+	int carry = z80->generalFlags&LLZ80FlagCarry;
 
-	// overflow for a subtraction is when the signs were originally
-	// different and the result is different again
-	int overflow = (value^z80->aRegister) & (result^z80->aRegister);
-
-	z80->aRegister = (uint8_t)result;
+	z80->generalFlags = llz80_subtractFlagTable[carry][(z80->aRegister << 8) | value];
+	z80->aRegister = (uint8_t)(z80->aRegister - value - carry);
 
 	z80->lastSignResult = z80->lastZeroResult =
-	z80->bit5And3Flags = (uint8_t)result;			// set sign, zero and 5 and 3
-	z80->generalFlags =
-		((result >> 8) & LLZ80FlagCarry)	|		// carry flag
-		(halfResult & LLZ80FlagHalfCarry)	|		// half carry flag
-		((overflow&0x80) >> 5)				|		// overflow flag
-		LLZ80FlagSubtraction;						// and this counts as a subtraction
+	z80->bit5And3Flags = z80->aRegister;			// set sign, zero and 5 and 3
 }
 
 void llz80_add_8bit(LLZ80ProcessorState *const z80, uint8_t value)
 {
-	int result = z80->aRegister + value;
-	int halfResult = (z80->aRegister&0xf) + (value&0xf);
-
-	// overflow for addition is when the signs were originally
-	// the same and the result is different
-	int overflow = ~(value^z80->aRegister) & (result^z80->aRegister);
-
-	z80->aRegister = (uint8_t)result;
+	z80->generalFlags = llz80_addFlagTable[0][(z80->aRegister << 8) | value];
+	z80->aRegister += value;
 
 	z80->lastSignResult = z80->lastZeroResult =
-	z80->bit5And3Flags = (uint8_t)result;			// set sign, zero and 5 and 3
-	z80->generalFlags =
-		((result >> 8) & LLZ80FlagCarry)	|		// carry flag
-		(halfResult & LLZ80FlagHalfCarry)	|		// half carry flag
-		((overflow&0x80) >> 5);						// overflow flag
-													// subtraction is implicitly unset
+	z80->bit5And3Flags = z80->aRegister;			// set sign, zero and 5 and 3
 }
 
 void llz80_addWithCarry_8bit(LLZ80ProcessorState *const z80, uint8_t value)
 {
-	int result = z80->aRegister + value + (z80->generalFlags&LLZ80FlagCarry);
-	int halfResult = (z80->aRegister&0xf) + (value&0xf) + (z80->generalFlags&LLZ80FlagCarry);
-
-	// overflow for addition is when the signs were originally
-	// the same and the result is different
-	int overflow = ~(value^z80->aRegister) & (result^z80->aRegister);
+	int carry = z80->generalFlags&LLZ80FlagCarry;
 
-	z80->aRegister = (uint8_t)result;
+	z80->generalFlags = llz80_addFlagTable[carry][(z80->aRegister << 8) | value];
+	z80->aRegister = (uint8_t)(z80->aRegister + value + carry);
 
 	z80->lastSignResult = z80->lastZeroResult =
-	z80->bit5And3Flags = (uint8_t)result;			// set sign, zero and 5 and 3
-	z80->generalFlags =
-		((result >> 8) & LLZ80FlagCarry)	|		// carry flag
-		(halfResult & LLZ80FlagHalfCarry)	|		// half carry flag
-		((overflow&0x80) >> 5);						// overflow flag
-													// subtraction is implicitly unset
+	z80->bit5And3Flags = z80->aRegister;			// set sign, zero and 5 and 3
 }
 
 void llz80_increment_8bit(LLZ80ProcessorState *const z80, uint8_t *const value)
 {
-	int result = (*value) + 1;
-	
-	// with an increment, overflow occurs if the sign changes from
-	// positive to negative
-	int overflow = (*value ^ result) & ~(*value);
-	int halfResult = (*value&0xf) + 1;
-
-	*value = (uint8_t)result;
+	z80->generalFlags =
+		(z80->generalFlags & LLZ80FlagCarry) |		// carry isn't affected
+		llz80_incrementFlagTable[*value];
+	(*value)++;
 
 	// sign, zero and 5 & 3 are set directly from the result
-	z80->bit5And3Flags = z80->lastSignResult = z80->lastZeroResult = (uint8_t)result;
+	z80->bit5And3Flags = z80->lastSignResult = z80->lastZeroResult = *value;
+}
+
+void llz80_decrement_8bit(LLZ80ProcessorState *const z80, uint8_t *const value)
+{
 	z80->generalFlags =
 		(z80->generalFlags & LLZ80FlagCarry) |		// carry isn't affected
-		(halfResult&LLZ80FlagHalfCarry) |			// half carry
-		((overflow >> 5)&LLZ80FlagParityOverflow);	// overflow
-													// implicitly: subtraction is reset
+		llz80_decrementFlagTable[*value];
+	(*value)--;
+
+	// sign, zero and 5 & 3 are set directly from the result
+	z80->bit5And3Flags = z80->lastZeroResult = z80->lastSignResult = *value;
 }
 
-void llz80_decrement_8bit(LLZ80ProcessorState *const z80, uint8_t *const value)
+void llz80_negate(LLZ80ProcessorState *const z80)
 {
-	int result = (*value) - 1;
+	// this is a subtraction from 0
+	z80->generalFlags = llz80_subtractFlagTable[0][z80->aRegister];
+	z80->aRegister = (uint8_t)(0 - z80->aRegister);
+	z80->bit5And3Flags = z80->lastSignResult = z80->lastZeroResult = z80->aRegister;
+}
 
-	// with a decrement, overflow occurs if the sign changes from
-	// negative to positive
-	int overflow = (*value ^ result) & (*value);
-	int halfResult = (*value&0xf) - 1;
+void llz80_decimalAdjustAccumulator(LLZ80ProcessorState *const z80)
+{
+	int lowNibble = z80->aRegister & 0xf;
+	int highNibble = z80->aRegister >> 4;
+
+	int amountToAdd = 0;
+
+	if(z80->generalFlags & LLZ80FlagCarry)
+	{
+		if(lowNibble > 0x9 || z80->generalFlags&LLZ80FlagHalfCarry)
+			amountToAdd = 0x66;
+		else
+			amountToAdd = 0x60;
+	}
+	else
+	{
+		if(z80->generalFlags & LLZ80FlagHalfCarry)
+		{
+			amountToAdd = (highNibble > 0x9) ? 0x66 : 0x60;
+		}
+		else
+		{
+			if(lowNibble > 0x9)
+			{
+				if(highNibble > 0x8)
+					amountToAdd = 0x66;
+				else
+					amountToAdd = 0x6;
+			}
+			else
+			{
+				amountToAdd = (highNibble > 0x9) ? 0x60 : 0x00;
+			}
+		}
+	}
+
+	int newCarry = z80->generalFlags & LLZ80FlagHalfCarry;
+	if(!newCarry)
+	{
+		if(lowNibble > 0x9)
+		{
+			if(highNibble > 0x8) newCarry = LLZ80FlagCarry;
+		}
+		else
+		{
+			if(highNibble > 0x9) newCarry = LLZ80FlagCarry;
+		}
+	}
+
+	int newHalfCarry = 0;
+	if(z80->generalFlags&LLZ80FlagSubtraction)
+	{
+		z80->aRegister -= amountToAdd;
+		if(z80->generalFlags&LLZ80FlagHalfCarry)
+		{
+			newHalfCarry = (lowNibble < 0x6) ? LLZ80FlagHalfCarry : 0;
+		}
+	}
+	else
+	{
+		z80->aRegister += amountToAdd;
+		newHalfCarry = (lowNibble > 0x9) ? LLZ80FlagHalfCarry : 0;
+	}
 
-	*value = (uint8_t)result;
+	z80->lastSignResult = z80->lastZeroResult =
+	z80->bit5And3Flags = z80->aRegister;
+	
+	llz80_calculateParity(z80->aRegister);
 
-	// sign, zero and 5 & 3 are set directly from the result
-	z80->bit5And3Flags = z80->lastZeroResult = z80->lastSignResult = (uint8_t)result;
 	z80->generalFlags =
-		(z80->generalFlags & LLZ80FlagCarry) |		// carry isn't affected
-		(halfResult&LLZ80FlagHalfCarry) |			// half carry
-		((overflow >> 5)&LLZ80FlagParityOverflow) |	// overflow
-		LLZ80FlagSubtraction;						// subtraction is set
+		(uint8_t)(
+			newCarry |
+			newHalfCarry |
+			((parity&1) << 3) |
+			(z80->generalFlags&LLZ80FlagSubtraction));
 }
@@ -22,4 +22,7 @@ void llz80_addWithCarry_8bit(LLZ80ProcessorState *const z80, uint8_t value);
 void llz80_increment_8bit(LLZ80ProcessorState *const z80, uint8_t *const value);
 void llz80_decrement_8bit(LLZ80ProcessorState *const z80, uint8_t *const value);
 
+void llz80_negate(LLZ80ProcessorState *const z80);
+void llz80_decimalAdjustAccumulator(LLZ80ProcessorState *const z80);
+
 #endif
@@ -7,6 +7,7 @@
 //
 
 #include "Z80BitwiseOps.h"
+#include "Z80FlagTables.h"
 
 void llz80_bitwiseAnd(LLZ80ProcessorState *const z80, uint8_t value)
 {
@@ -15,10 +16,9 @@ void llz80_bitwiseAnd(LLZ80ProcessorState *const z80, uint8_t value)
 	z80->lastSignResult = z80->lastZeroResult = 
 	z80->bit5And3Flags = z80->aRegister;
 
-	llz80_calculateParity(z80->aRegister);
 	z80->generalFlags =
 		LLZ80FlagHalfCarry |
-		parity;
+		llz80_parityFlagTable[z80->aRegister];
 }
 
 void llz80_bitwiseOr(LLZ80ProcessorState *const z80, uint8_t value)
@@ -28,8 +28,7 @@ void llz80_bitwiseOr(LLZ80ProcessorState *const z80, uint8_t value)
 	z80->lastSignResult = z80->lastZeroResult =
 	z80->bit5And3Flags = z80->aRegister;
 
-	llz80_calculateParity(z80->aRegister);
-	z80->generalFlags = parity;
+	z80->generalFlags = llz80_parityFlagTable[z80->aRegister];
 }
 
 void llz80_bitwiseXOr(LLZ80ProcessorState *const z80, uint8_t value)
@@ -39,6 +38,34 @@ void llz80_bitwiseXOr(LLZ80ProcessorState *const z80, uint8_t value)
 	z80->lastSignResult = z80->lastZeroResult =
 	z80->bit5And3Flags = z80->aRegister;
 
-	llz80_calculateParity(z80->aRegister);
-	z80->generalFlags = parity;
+	z80->generalFlags = llz80_parityFlagTable[z80->aRegister];
+}
+
+void llz80_complement(LLZ80ProcessorState *const z80)
+{
+	z80->aRegister ^= 0xff;
+	z80->generalFlags |=
+		LLZ80FlagHalfCarry |
+		LLZ80FlagSubtraction;
+	z80->bit5And3Flags = z80->aRegister;
+}
+
+void llz80_setCarryFlag(LLZ80ProcessorState *const z80)
+{
+	z80->bit5And3Flags = z80->aRegister;
+	z80->generalFlags =
+		(z80->generalFlags & LLZ80FlagParityOverflow) |
+		LLZ80FlagCarry;
+		// implicitly setting subtract and half carry to 0
+}
+
+void llz80_complementCarryFlag(LLZ80ProcessorState *const z80)
+{
+	z80->bit5And3Flags = z80->aRegister;
+	z80->generalFlags =
+		(uint8_t)(
+			(z80->generalFlags & LLZ80FlagParityOverflow) |
+			((z80->generalFlags & LLZ80FlagCarry) << 4) |	// so half carry is what carry was
+			((z80->generalFlags^LLZ80FlagCarry)&LLZ80FlagCarry));
+		// implicitly setting subtract and half carry to 0
 }
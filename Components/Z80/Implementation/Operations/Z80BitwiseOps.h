@@ -15,4 +15,8 @@ void llz80_bitwiseAnd(LLZ80ProcessorState *const z80, uint8_t value);
 void llz80_bitwiseOr(LLZ80ProcessorState *const z80, uint8_t value);
 void llz80_bitwiseXOr(LLZ80ProcessorState *const z80, uint8_t value);
 
+void llz80_complement(LLZ80ProcessorState *const z80);
+void llz80_setCarryFlag(LLZ80ProcessorState *const z80);
+void llz80_complementCarryFlag(LLZ80ProcessorState *const z80);
+
 #endif
@@ -0,0 +1,38 @@
+//
+//  BlockOps.c
+//  LLZ80
+//
+//  Created by Thomas Harte on 05/12/2011.
+//  Copyright (c) 2011 Thomas Harte. All rights reserved.
+//
+
+#include "Z80BlockOps.h"
+
+void llz80_setBlockTransferFlags(LLZ80ProcessorState *const z80, uint8_t value)
+{
+	uint8_t n = z80->aRegister + value;
+	
+	z80->generalFlags =
+		(z80->generalFlags&LLZ80FlagCarry) |
+		(z80->bcRegister.fullValue ? LLZ80FlagParityOverflow : 0);
+	z80->bit5And3Flags = (uint8_t)((n&0x8) | ((n&0x2) << 4));
+}
+
+void llz80_setBlockCompareFlags(LLZ80ProcessorState *const z80, uint8_t value)
+{
+	uint8_t result = z80->aRegister - value;
+	uint8_t halfResult = (z80->aRegister&0xf) - (value&0xf);
+
+	// sign, zero, half-carry: set by compare of (hl) and a
+	// yf, xf: copies of bits 1 and 3 of n
+	// parity: set if bc is not 0
+	// subtract: set
+
+	z80->generalFlags =
+		(z80->generalFlags&LLZ80FlagCarry) |
+		(z80->bcRegister.fullValue ? LLZ80FlagParityOverflow : 0) |
+		(halfResult & LLZ80FlagHalfCarry) |
+		LLZ80FlagSubtraction;
+	z80->bit5And3Flags = (uint8_t)((result&0x8) | ((result&0x2) << 4));
+	z80->lastSignResult = z80->lastZeroResult = result;
+}
@@ -0,0 +1,19 @@
+//
+//  BlockOps.h
+//  LLZ80
+//
+//  Created by Thomas Harte on 05/12/2011.
+//  Copyright (c) 2011 Thomas Harte. All rights reserved.
+//
+
+#ifndef LLZ80_BlockOps_h
+#define LLZ80_BlockOps_h
+
+#include "../Z80Internals.h"
+
+// these set the flags for ldi, ldd, cpi and cpd, and their repeating forms,
+// given the byte read from (hl); bc should already have been decremented
+void llz80_setBlockTransferFlags(LLZ80ProcessorState *const z80, uint8_t value);
+void llz80_setBlockCompareFlags(LLZ80ProcessorState *const z80, uint8_t value);
+
+#endif
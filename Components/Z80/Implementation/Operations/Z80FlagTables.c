@@ -0,0 +1,87 @@
+//
+//  FlagTables.c
+//  LLZ80
+//
+//  Created by Thomas Harte on 12/12/2011.
+//  Copyright (c) 2011 Thomas Harte. All rights reserved.
+//
+
+#include "Z80FlagTables.h"
+#include <pthread.h>
+
+uint8_t llz80_parityFlagTable[256];
+uint8_t llz80_addFlagTable[2][65536];
+uint8_t llz80_subtractFlagTable[2][65536];
+uint8_t llz80_incrementFlagTable[256];
+uint8_t llz80_decrementFlagTable[256];
+
+static void llz80_fillFlagTables(void)
+{
+	for(int value = 0; value < 256; value++)
+	{
+		llz80_calculateParity((uint8_t)value);
+		llz80_parityFlagTable[value] = parity;
+
+		// with an increment, overflow occurs if the sign changes from
+		// positive to negative; with a decrement, if it changes from
+		// negative to positive
+		int result = value + 1;
+		int overflow = (value ^ result) & ~value;
+		int halfResult = (value&0xf) + 1;
+		llz80_incrementFlagTable[value] =
+			(uint8_t)(
+				(halfResult&LLZ80FlagHalfCarry) |
+				((overflow >> 5)&LLZ80FlagParityOverflow));
+
+		result = value - 1;
+		overflow = (value ^ result) & value;
+		halfResult = (value&0xf) - 1;
+		llz80_decrementFlagTable[value] =
+			(uint8_t)(
+				(halfResult&LLZ80FlagHalfCarry) |
+				((overflow >> 5)&LLZ80FlagParityOverflow) |
+				LLZ80FlagSubtraction);
+	}
+
+	for(int carry = 0; carry < 2; carry++)
+	{
+		for(int a = 0; a < 256; a++)
+		{
+			for(int operand = 0; operand < 256; operand++)
+			{
+				// overflow for addition is when the signs were originally
+				// the same and the result is different
+				int result = a + operand + carry;
+				int halfResult = (a&0xf) + (operand&0xf) + carry;
+				int overflow = ~(operand^a) & (result^a);
+
+				llz80_addFlagTable[carry][(a << 8) | operand] =
+					(uint8_t)(
+						((result >> 8) & LLZ80FlagCarry)	|
+						(halfResult & LLZ80FlagHalfCarry)	|
+						((overflow&0x80) >> 5));
+
+				// overflow for a subtraction is when the signs were originally
+				// different and the result is different again
+				result = a - operand - carry;
+				halfResult = (a&0xf) - (operand&0xf) - carry;
+				overflow = (operand^a) & (result^a);
+
+				llz80_subtractFlagTable[carry][(a << 8) | operand] =
+					(uint8_t)(
+						((result >> 8) & LLZ80FlagCarry)	|
+						(halfResult & LLZ80FlagHalfCarry)	|
+						((overflow&0x80) >> 5)				|
+						LLZ80FlagSubtraction);
+			}
+		}
+	}
+}
+
+void llz80_buildFlagTables(void)
+{
+	// processors may be created on several threads at once, and none
+	// should see the tables until they're complete
+	static pthread_once_t tablesAreBuilt = PTHREAD_ONCE_INIT;
+	pthread_once(&tablesAreBuilt, llz80_fillFlagTables);
+}
@@ -0,0 +1,41 @@
+//
+//  FlagTables.h
+//  LLZ80
+//
+//  Created by Thomas Harte on 12/12/2011.
+//  Copyright (c) 2011 Thomas Harte. All rights reserved.
+//
+
+#ifndef LLZ80_FlagTables_h
+#define LLZ80_FlagTables_h
+
+#include "../Z80Internals.h"
+
+/*
+
+	These hold the flags that the 8-bit operations would otherwise work out
+	bit by bit each time. Sign, zero and bits 5 and 3 are kept lazily, as
+	the results they come from, so these supply only the general flags.
+
+	The tables are built exactly once, when the first processor is
+	created; llz80_buildFlagTables returns only once they're complete,
+	and it's safe to call from several threads at once.
+
+*/
+
+// the parity flag if value has even parity, 0 otherwise
+extern uint8_t llz80_parityFlagTable[256];
+
+// carry, half carry, overflow and subtraction for a + operand + carry, or
+// a - operand - carry, indexed as [carry][(a << 8) | operand]
+extern uint8_t llz80_addFlagTable[2][65536];
+extern uint8_t llz80_subtractFlagTable[2][65536];
+
+// half carry, overflow and subtraction for an increment or a decrement of
+// value; carry isn't affected
+extern uint8_t llz80_incrementFlagTable[256];
+extern uint8_t llz80_decrementFlagTable[256];
+
+void llz80_buildFlagTables(void);
+
+#endif
@@ -7,6 +7,7 @@
 //
 
 #include "Z80RotateAndShiftOps.h"
+#include "Z80FlagTables.h"
 
 void llz80_rla(LLZ80ProcessorState *const z80)
 {
@@ -53,8 +54,7 @@ void llz80_rlc(LLZ80ProcessorState *const z80, uint8_t *const value)
 	uint8_t carry = *value >> 7;
 	*value = (uint8_t)((*value << 1) | carry);
 
-	llz80_calculateParity(*value);
-	z80->generalFlags = carry | parity;
+	z80->generalFlags = carry | llz80_parityFlagTable[*value];
 	z80->bit5And3Flags = z80->lastSignResult = z80->lastZeroResult = *value;
 }
 
@@ -63,8 +63,7 @@ void llz80_rrc(LLZ80ProcessorState *const z80, uint8_t *const value)
 	uint8_t carry = *value & 1;
 	*value = (uint8_t)((*value >> 1) | (carry << 7));
 
-	llz80_calculateParity(*value);
-	z80->generalFlags = carry | parity;
+	z80->generalFlags = carry | llz80_parityFlagTable[*value];
 	z80->bit5And3Flags = z80->lastSignResult = z80->lastZeroResult = *value;
 }
 
@@ -73,8 +72,7 @@ void llz80_rl(LLZ80ProcessorState *const z80, uint8_t *const value)
 	uint8_t carry = *value >> 7;
 	*value = (uint8_t)((*value << 1) | (z80->generalFlags&LLZ80FlagCarry));
 
-	llz80_calculateParity(*value);
-	z80->generalFlags = carry | parity;
+	z80->generalFlags = carry | llz80_parityFlagTable[*value];
 	z80->bit5And3Flags = z80->lastSignResult = z80->lastZeroResult = *value;
 }
 
@@ -83,8 +81,7 @@ void llz80_rr(LLZ80ProcessorState *const z80, uint8_t *const value)
 	uint8_t carry = *value & 1;
 	*value = (uint8_t)((*value >> 1) | (z80->generalFlags << 7));
 
-	llz80_calculateParity(*value);
-	z80->generalFlags = carry | parity;
+	z80->generalFlags = carry | llz80_parityFlagTable[*value];
 	z80->bit5And3Flags = z80->lastSignResult = z80->lastZeroResult = *value;
 }
 
@@ -93,8 +90,7 @@ void llz80_sla(LLZ80ProcessorState *const z80, uint8_t *const value)
 	uint8_t carry = *value >> 7;
 	*value <<= 1;
 
-	llz80_calculateParity(*value);
-	z80->generalFlags = carry | parity;
+	z80->generalFlags = carry | llz80_parityFlagTable[*value];
 	z80->bit5And3Flags = z80->lastSignResult = z80->lastZeroResult = *value;
 }
 
@@ -103,8 +99,7 @@ void llz80_sra(LLZ80ProcessorState *const z80, uint8_t *const value)
 	uint8_t carry = *value & 1;
 	*value = (*value & 0x80) | (*value >> 1);
 
-	llz80_calculateParity(*value);
-	z80->generalFlags = carry | parity;
+	z80->generalFlags = carry | llz80_parityFlagTable[*value];
 	z80->bit5And3Flags = z80->lastSignResult = z80->lastZeroResult = *value;
 }
 
@@ -113,8 +108,7 @@ void llz80_sll(LLZ80ProcessorState *const z80, uint8_t *const value)
 	uint8_t carry = *value >> 7;
 	*value = (uint8_t)((*value << 1) | 1);
 
-	llz80_calculateParity(*value);
-	z80->generalFlags = carry | parity;
+	z80->generalFlags = carry | llz80_parityFlagTable[*value];
 	z80->bit5And3Flags = z80->lastSignResult = z80->lastZeroResult = *value;
 }
 
@@ -123,7 +117,32 @@ void llz80_srl(LLZ80ProcessorState *const z80, uint8_t *const value)
 	uint8_t carry = *value & 1;
 	*value >>= 1;
 
-	llz80_calculateParity(*value);
-	z80->generalFlags = carry | parity;
+	z80->generalFlags = carry | llz80_parityFlagTable[*value];
 	z80->bit5And3Flags = z80->lastSignResult = z80->lastZeroResult = *value;
 }
+
+void llz80_rrd(LLZ80ProcessorState *const z80, uint8_t *const value)
+{
+	int lowNibble = z80->aRegister&0xf;
+	z80->aRegister = (z80->aRegister&0xf0) | (*value & 0xf);
+	*value = (uint8_t)((*value >> 4) | (lowNibble << 4));
+
+	z80->generalFlags =
+		llz80_parityFlagTable[z80->aRegister] |
+		(z80->generalFlags&LLZ80FlagCarry);
+	z80->lastSignResult = z80->lastZeroResult =
+	z80->bit5And3Flags = z80->aRegister;
+}
+
+void llz80_rld(LLZ80ProcessorState *const z80, uint8_t *const value)
+{
+	int lowNibble = z80->aRegister&0xf;
+	z80->aRegister = (z80->aRegister&0xf0) | (*value >> 4);
+	*value = (uint8_t)((*value << 4) | lowNibble);
+
+	z80->generalFlags =
+		llz80_parityFlagTable[z80->aRegister] |
+		(z80->generalFlags&LLZ80FlagCarry);
+	z80->lastSignResult = z80->lastZeroResult =
+	z80->bit5And3Flags = z80->aRegister;
+}
@@ -26,4 +26,8 @@ void llz80_sra(LLZ80ProcessorState *const z80, uint8_t *const value);
 void llz80_sll(LLZ80ProcessorState *const z80, uint8_t *const value);
 void llz80_srl(LLZ80ProcessorState *const z80, uint8_t *const value);
 
+// these exchange nibbles between a and *value
+void llz80_rrd(LLZ80ProcessorState *const z80, uint8_t *const value);
+void llz80_rld(LLZ80ProcessorState *const z80, uint8_t *const value);
+
 #endif
@@ -10,7 +10,7 @@
 
 LLZ80iop(llz80_iop_bit_imp)
 {
-	uint8_t result = instruction->extraData.bitOp.mask & *instruction->extraData.bitOp.value;
+	uint8_t result = instruction->extraData.bitOp.mask & *llz80_operand(z80, uint8_t, instruction->extraData.bitOp.value);
 
 	z80->lastSignResult = z80->lastZeroResult =
 	z80->bit5And3Flags = result;
@@ -22,12 +22,12 @@ LLZ80iop(llz80_iop_bit_imp)
 
 LLZ80iop_restrict(llz80_iop_set_imp)
 {
-	*instruction->extraData.bitOp.value |= instruction->extraData.bitOp.mask;
+	*llz80_operand(z80, uint8_t, instruction->extraData.bitOp.value) |= instruction->extraData.bitOp.mask;
 }
 
 LLZ80iop_restrict(llz80_iop_res_imp)
 {
-	*instruction->extraData.bitOp.value &= ~instruction->extraData.bitOp.mask;
+	*llz80_operand(z80, uint8_t, instruction->extraData.bitOp.value) &= ~instruction->extraData.bitOp.mask;
 }
 
 const LLZ80InternalInstructionFunction llz80_iop_bit = llz80_iop_bit_imp;
@@ -16,7 +16,7 @@
 */
 LLZ80iop(llz80_iop_inputOrOutputHalfCycle1)
 {
-	llz80_setAddress(z80, *instruction->extraData.readOrWriteAddress.address);
+	llz80_setAddress(z80, *llz80_operand(z80, uint16_t, instruction->extraData.readOrWriteAddress.address));
 }
 
 LLZ80iop_restrict(llz80_iop_inputHalfCycle3)
@@ -26,7 +26,7 @@ LLZ80iop_restrict(llz80_iop_inputHalfCycle3)
 
 LLZ80iop(llz80_iop_inputHalfCycle8)
 {
-	*instruction->extraData.readOrWriteValue.value = llz80_getDataInput(z80);
+	*llz80_operand(z80, uint8_t, instruction->extraData.readOrWriteValue.value) = llz80_getDataInput(z80);
 	llz80_setLinesInactive(z80, LLZ80SignalRead | LLZ80SignalInputOutputRequest);
 }
 
@@ -36,7 +36,7 @@ LLZ80InternalInstruction *llz80_scheduleInput(
 	uint8_t *const value,
 	uint16_t *const address)
 {
-	llz80_scheduleHalfCycleForFunction(z80, llz80_iop_inputOrOutputHalfCycle1)->extraData.readOrWriteAddress.address = address;
+	llz80_scheduleHalfCycleForFunction(z80, llz80_iop_inputOrOutputHalfCycle1)->extraData.readOrWriteAddress.address = llz80_operandOffset(z80, address);
 	llz80_beginNewHalfCycle(z80);
 
 	llz80_scheduleHalfCycleForFunction(z80, llz80_iop_inputHalfCycle3);
@@ -49,7 +49,7 @@ LLZ80InternalInstruction *llz80_scheduleInput(
 
 	LLZ80InternalInstruction *instruction;
 	instruction = llz80_scheduleHalfCycleForFunction(z80, llz80_iop_inputHalfCycle8);
-	instruction->extraData.readOrWriteValue.value = value;
+	instruction->extraData.readOrWriteValue.value = llz80_operandOffset(z80, value);
 
 	return instruction;
 }
@@ -62,7 +62,7 @@ LLZ80InternalInstruction *llz80_scheduleInput(
 */
 LLZ80iop(llz80_iop_outputHalfCycle2)
 {
-	llz80_setDataOutput(z80, *instruction->extraData.readOrWriteValue.value);
+	llz80_setDataOutput(z80, *llz80_operand(z80, uint8_t, instruction->extraData.readOrWriteValue.value));
 }
 
 LLZ80iop_restrict(llz80_iop_outputHalfCycle3)
@@ -81,8 +81,8 @@ LLZ80InternalInstruction *llz80_scheduleOutput(
 	uint8_t *const value,
 	uint16_t *const address)
 {
-	llz80_scheduleHalfCycleForFunction(z80, llz80_iop_inputOrOutputHalfCycle1)->extraData.readOrWriteAddress.address = address;
-	llz80_scheduleHalfCycleForFunction(z80, llz80_iop_outputHalfCycle2)->extraData.readOrWriteValue.value = value;
+	llz80_scheduleHalfCycleForFunction(z80, llz80_iop_inputOrOutputHalfCycle1)->extraData.readOrWriteAddress.address = llz80_operandOffset(z80, address);
+	llz80_scheduleHalfCycleForFunction(z80, llz80_iop_outputHalfCycle2)->extraData.readOrWriteValue.value = llz80_operandOffset(z80, value);
 
 	llz80_scheduleHalfCycleForFunction(z80, llz80_iop_outputHalfCycle3);
 	llz80_beginNewHalfCycle(z80);
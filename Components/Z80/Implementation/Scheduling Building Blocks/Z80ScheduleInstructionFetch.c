@@ -81,7 +81,7 @@ void llz80_scheduleInstructionFetchForFunction(
 	llz80m_scheduleHalfCycleForFunction(llz80_iop_instructionfetchHalfCycle8);
 
 	z80->scheduledInstructions[writePointer].function = function;
-	z80->scheduledInstructions[writePointer].extraData.opcodeDecode.indexRegister = indexRegister;
+	z80->scheduledInstructions[writePointer].extraData.opcodeDecode.indexRegister = llz80_operandOffset(z80, indexRegister);
 	z80->scheduledInstructions[writePointer].extraData.opcodeDecode.addOffset = addOffset;
 	llz80m_advanceWritePointer();
 
@@ -17,13 +17,13 @@
 */
 LLZ80iop(llz80_iop_readOrWriteHalfCycle1)
 {
-	llz80_setAddress(z80, *instruction->extraData.readOrWriteAddress.address);
+	llz80_setAddress(z80, *llz80_operand(z80, uint16_t, instruction->extraData.readOrWriteAddress.address));
 	llz80_setDataExpectingInput(z80);
 }
 
 LLZ80iop(llz80_iop_readHalfCycle6)
 {
-	*instruction->extraData.readOrWriteValue.value = llz80_getDataInput(z80);
+	*llz80_operand(z80, uint8_t, instruction->extraData.readOrWriteValue.value) = llz80_getDataInput(z80);
 	llz80_setLinesInactive(z80, LLZ80SignalRead | LLZ80SignalMemoryRequest);
 }
 
@@ -33,14 +33,14 @@ LLZ80InternalInstruction *llz80_scheduleRead(
 	uint8_t *const value,
 	uint16_t *const address)
 {
-	llz80_scheduleHalfCycleForFunction(z80, llz80_iop_readOrWriteHalfCycle1)->extraData.readOrWriteAddress.address = address;
+	llz80_scheduleHalfCycleForFunction(z80, llz80_iop_readOrWriteHalfCycle1)->extraData.readOrWriteAddress.address = llz80_operandOffset(z80, address);
 	llz80_scheduleHalfCycleForFunction(z80, llz80_iop_setReadAndMemoryRequest);
 	llz80_beginNewHalfCycle(z80);
 	llz80_beginNewHalfCycle(z80)->extraData.advance.isWaitCycle = true;
 	llz80_beginNewHalfCycle(z80);
 
 	LLZ80InternalInstruction *const instruction = llz80_scheduleHalfCycleForFunction(z80, llz80_iop_readHalfCycle6);
-	instruction->extraData.readOrWriteValue.value = value;
+	instruction->extraData.readOrWriteValue.value = llz80_operandOffset(z80, value);
 
 	return instruction;
 }
@@ -53,7 +53,7 @@ LLZ80InternalInstruction *llz80_scheduleRead(
 */
 LLZ80iop(llz80_iop_writeHalfCycle2)
 {
-	llz80_setDataOutput(z80, *instruction->extraData.readOrWriteValue.value);
+	llz80_setDataOutput(z80, *llz80_operand(z80, uint8_t, instruction->extraData.readOrWriteValue.value));
 	llz80_setLinesActive(z80, LLZ80SignalMemoryRequest);
 }
 
@@ -73,15 +73,15 @@ LLZ80InternalInstruction *llz80_scheduleWrite(
 	uint8_t *const value,
 	uint16_t *const address)
 {
-	llz80_scheduleHalfCycleForFunction(z80, llz80_iop_readOrWriteHalfCycle1)->extraData.readOrWriteAddress.address = address;
-	llz80_scheduleHalfCycleForFunction(z80, llz80_iop_writeHalfCycle2)->extraData.readOrWriteValue.value = value;
+	llz80_scheduleHalfCycleForFunction(z80, llz80_iop_readOrWriteHalfCycle1)->extraData.readOrWriteAddress.address = llz80_operandOffset(z80, address);
+	llz80_scheduleHalfCycleForFunction(z80, llz80_iop_writeHalfCycle2)->extraData.readOrWriteValue.value = llz80_operandOffset(z80, value);
 
 	llz80_beginNewHalfCycle(z80);
 	llz80_scheduleHalfCycleForFunction(z80, llz80_iop_writeHalfCycle4)->extraData.advance.isWaitCycle = true;
 
 	llz80_beginNewHalfCycle(z80);
 	LLZ80InternalInstruction *const instruction = llz80_scheduleHalfCycleForFunction(z80, llz80_iop_writeHalfCycle6);
-	instruction->extraData.readOrWriteValue.value = value;
+	instruction->extraData.readOrWriteValue.value = llz80_operandOffset(z80, value);
 
 	return instruction;
 }
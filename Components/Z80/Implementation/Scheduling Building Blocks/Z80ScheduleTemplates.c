@@ -0,0 +1,131 @@
+//
+//  ScheduleTemplates.c
+//  LLZ80
+//
+//  Created by Thomas Harte on 10/12/2011.
+//  Copyright (c) 2011 Thomas Harte. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "Z80ScheduleTemplates.h"
+#include "Z80ScheduleInstructionFetch.h"
+
+#include "../Instruction Pages/Z80StandardPageDecode.h"
+#include "../Instruction Pages/Z80CBPageDecode.h"
+#include "../Instruction Pages/Z80EDPageDecode.h"
+
+void llz80_beginTemplate(LLZ80ProcessorState *const z80)
+{
+	// clear the queue entirely, so that whatever the scheduling
+	// doesn't set compares as equal between templates
+	memset(z80->scheduledInstructions, 0, sizeof(z80->scheduledInstructions));
+	z80->instructionReadPointer = z80->instructionWritePointer = 0;
+}
+
+bool llz80_endTemplate(LLZ80ProcessorState *const z80, LLZ80InstructionTemplates *const templates, LLZ80InstructionTemplate *const template)
+{
+	const unsigned int length = z80->instructionWritePointer;
+	z80->instructionWritePointer = 0;
+
+	// a template records where it starts and how long it is in 16 bits
+	if(length > UINT16_MAX) return false;
+
+	template->length = (uint16_t)length;
+	if(!length)
+	{
+		template->start = 0;
+		return true;
+	}
+
+	// many opcodes end up with the same template, so look for an existing
+	// copy first; the hash is FNV-1a over the whole run
+	const size_t numberOfBytes = length * sizeof(LLZ80InternalInstruction);
+	const uint8_t *const bytes = (const uint8_t *)z80->scheduledInstructions;
+	uint32_t hash = 2166136261u;
+	for(size_t byte = 0; byte < numberOfBytes; byte++)
+		hash = (hash ^ bytes[byte]) * 16777619u;
+
+	LLZ80InstructionTemplate *recordedTemplate = NULL;
+	for(unsigned int probe = 0; probe < kLLZ80NumberOfRecordedTemplates; probe++)
+	{
+		LLZ80InstructionTemplate *const candidate = &templates->recordedTemplates[(hash + probe)&(kLLZ80NumberOfRecordedTemplates - 1)];
+		if(!candidate->length)
+		{
+			recordedTemplate = candidate;
+			break;
+		}
+
+		if(
+			candidate->length == length &&
+			!memcmp(&templates->instructions[candidate->start], z80->scheduledInstructions, numberOfBytes))
+		{
+			template->start = candidate->start;
+			return true;
+		}
+	}
+
+	if(templates->numberOfInstructions > UINT16_MAX) return false;
+
+	if(templates->numberOfInstructions + length > templates->numberOfAllocatedInstructions)
+	{
+		unsigned int numberOfAllocatedInstructions = templates->numberOfAllocatedInstructions + 1024;
+		LLZ80InternalInstruction *const instructions =
+			(LLZ80InternalInstruction *)realloc(templates->instructions, numberOfAllocatedInstructions * sizeof(LLZ80InternalInstruction));
+		if(!instructions) return false;
+
+		templates->instructions = instructions;
+		templates->numberOfAllocatedInstructions = numberOfAllocatedInstructions;
+	}
+
+	memcpy(&templates->instructions[templates->numberOfInstructions], z80->scheduledInstructions, length * sizeof(LLZ80InternalInstruction));
+	template->start = (uint16_t)templates->numberOfInstructions;
+	templates->numberOfInstructions += length;
+
+	// if the table is full then this template just won't be shared
+	if(recordedTemplate) *recordedTemplate = *template;
+
+	return true;
+}
+
+static LLZ80InstructionTemplates llz80_templates;
+static bool llz80_templatesAreBuilt;
+
+static bool llz80_recordTemplates(LLZ80ProcessorState *const z80, LLZ80InstructionTemplates *const templates)
+{
+	llz80_beginTemplate(z80);
+	llz80_scheduleInstructionFetchForFunction(z80, llz80_iop_standardPageDecode, &z80->hlRegister, false);
+	if(!llz80_endTemplate(z80, templates, &templates->instructionFetch)) return false;
+
+	if(!llz80_buildStandardPageTemplates(z80, templates)) return false;
+	if(!llz80_buildCBPageTemplates(z80, templates)) return false;
+	if(!llz80_buildEDPageTemplates(z80, templates)) return false;
+
+	return true;
+}
+
+static void llz80_buildTemplates(void)
+{
+	// operands are recorded as offsets into the processor state, so
+	// templates scheduled by a scratch processor suit any other
+	LLZ80ProcessorState *const z80 = (LLZ80ProcessorState *)calloc(1, sizeof(LLZ80ProcessorState));
+	if(!z80) return;
+
+	llz80_templatesAreBuilt = llz80_recordTemplates(z80, &llz80_templates);
+	free(z80);
+
+	if(!llz80_templatesAreBuilt)
+	{
+		free(llz80_templates.instructions);
+		llz80_templates.instructions = NULL;
+	}
+}
+
+const LLZ80InstructionTemplates *llz80_getTemplates(void)
+{
+	static pthread_once_t templatesAreBuilt = PTHREAD_ONCE_INIT;
+	pthread_once(&templatesAreBuilt, llz80_buildTemplates);
+
+	return llz80_templatesAreBuilt ? &llz80_templates : NULL;
+}
@@ -0,0 +1,30 @@
+//
+//  ScheduleTemplates.h
+//  LLZ80
+//
+//  Created by Thomas Harte on 10/12/2011.
+//  Copyright (c) 2011 Thomas Harte. All rights reserved.
+//
+
+#ifndef LLZ80_ScheduleTemplates_h
+#define LLZ80_ScheduleTemplates_h
+
+#include "../Z80Internals.h"
+
+/*
+	a template is recorded by scheduling into the empty queue between
+	a begin and an end, exactly as it would be scheduled at run time;
+	identical templates share storage. End returns false if storage
+	couldn't be allocated, or if it would no longer fit the 16-bit
+	start and length of a template
+*/
+extern void llz80_beginTemplate(LLZ80ProcessorState *const z80);
+extern bool llz80_endTemplate(LLZ80ProcessorState *const z80, LLZ80InstructionTemplates *const templates, LLZ80InstructionTemplate *const template);
+
+// returns the instruction fetch and every opcode's template, recording
+// them when first called; they're shared by every processor and are safe
+// to request from several threads at once. Returns NULL if storage
+// couldn't be allocated
+extern const LLZ80InstructionTemplates *llz80_getTemplates(void);
+
+#endif
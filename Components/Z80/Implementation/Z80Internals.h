@@ -11,6 +11,7 @@
 
 #include "Z80.h"
 #include "stdbool.h"
+#include "stddef.h"
 #include "ReferenceCountedObject.h"
 #include "StandardBusLines.h"
 
@@ -52,6 +53,8 @@ extern const LLZ80InternalInstructionFunction llz80_iop_advanceHalfCycleCounter;
 #define LLZ80iop(x) static void x(LLZ80ProcessorState *const z80, const LLZ80InternalInstruction *const instruction)
 #define LLZ80iop_restrict(x) static void x(LLZ80ProcessorState *const restrict z80, const LLZ80InternalInstruction *const restrict instruction)
 
+// operands are held as offsets into the processor state rather than as
+// pointers, so that templates can be shared by every processor
 typedef struct LLZ80InternalInstruction
 {
 	LLZ80InternalInstructionFunction function;
@@ -60,28 +63,28 @@ typedef struct LLZ80InternalInstruction
 	{
 		struct LLZ80InternalInstructionExtraDataDecode
 		{
-			LLZ80RegisterPair *indexRegister;
+			size_t indexRegister;
 			bool addOffset;
 		} opcodeDecode;
 
 		struct LLZ80InternalInstructionExtraDataReadOrWriteAddress
 		{
-			uint16_t *address;
+			size_t address;
 		} readOrWriteAddress;
 
 		struct LLZ80InternalInstructionExtraDataReadOrWriteValue
 		{
-			uint8_t *value;
+			size_t value;
 		} readOrWriteValue;
 
 		struct LLZ80InternalInstructionExtraDataReferenceToIndexRegister
 		{
-			LLZ80RegisterPair *indexRegister;
+			size_t indexRegister;
 		} referenceToIndexRegister;
 
 		struct LLZ80InternalInstructionExtraDataReferenceToRegister
 		{
-			uint8_t *registerReference;
+			size_t registerReference;
 		} referenceToRegister;
 
 		struct LLZ80InternalInstructionExtraDataConditional
@@ -97,7 +100,7 @@ typedef struct LLZ80InternalInstruction
 		struct LLZ80InternalInstructionExtraDataBitOp
 		{
 			uint8_t mask;
-			uint8_t *value;
+			size_t value;
 		} bitOp;
 
 		struct LLZ80InternalInstructionExtraDataAdvanceOp
@@ -108,7 +111,40 @@ typedef struct LLZ80InternalInstruction
 	} extraData;
 } LLZ80InternalInstruction;
 
+// the queue length must be a power of two
 #define kLLZ80HalfCycleQueueLength	64
+#define kLLZ80HalfCycleQueueMask	(kLLZ80HalfCycleQueueLength - 1)
+#define kLLZ80FastModeNumberOfPages	(65536 / kLLZ80FastModePageSize)
+
+// the recorded templates are hashed into a table of this size, which
+// must be a power of two
+#define kLLZ80NumberOfRecordedTemplates	1024
+
+// a template is a fixed run of internal instructions, held in the shared
+// template storage; every opcode on every page has one, recorded when the
+// first processor is created, describing everything it does on the bus
+typedef struct
+{
+	uint16_t start, length;
+} LLZ80InstructionTemplate;
+
+// templates are indexed by opcode; the standard page also by whether
+// HL, IX or IY is in use and whether the instruction's condition is
+// true, the CB page by whether an offset is added
+typedef struct
+{
+	LLZ80InternalInstruction *instructions;
+	unsigned int numberOfInstructions, numberOfAllocatedInstructions;
+
+	LLZ80InstructionTemplate instructionFetch;
+	LLZ80InstructionTemplate standardPage[3][256][2];
+	LLZ80InstructionTemplate CBPage[2][256];
+	LLZ80InstructionTemplate EDPage[256];
+
+	// every distinct template recorded so far, by hash; unused entries
+	// have no length
+	LLZ80InstructionTemplate recordedTemplates[kLLZ80NumberOfRecordedTemplates];
+} LLZ80InstructionTemplates;
 
 struct LLZ80GenericLinkedListRecord
 {
@@ -123,6 +159,19 @@ struct LLZ80InstructionObserverRecord
 	void *context;
 };
 
+struct LLZ80TrapRecord
+{
+	void *next, *last;
+
+	uint16_t address;
+	llz80_instructionObserver handler;
+	void *context;
+
+	// traps removed while traps are being called are only marked
+	// as such, and are freed once the calls are complete
+	bool isRemoved;
+};
+
 typedef struct LLZ80ProcessorState
 {
 	CSReferenceCountedObject referenceCountedObject;
@@ -130,6 +179,9 @@ typedef struct LLZ80ProcessorState
 	CSBusState internalBusState;
 	CSBusState externalBusState;
 
+	// fast mode takes a copy of everything from here up to the interrupt
+	// state in order to be able to abandon an instruction part way through,
+	// so all registers should be kept within that range
 	uint8_t aRegister;
 	uint8_t generalFlags;
 	uint8_t lastSignResult;
@@ -169,17 +221,38 @@ typedef struct LLZ80ProcessorState
 	LLZ80InternalInstruction scheduledInstructions[kLLZ80HalfCycleQueueLength];
 	LLZ80InternalInstruction *lastWrittenInstruction;
 
+	// the template currently being stepped through, if any; it always
+	// comes before whatever is in the queue
+	const LLZ80InternalInstruction *templateInstruction, *templateEnd;
+
+	// every processor uses the same templates
+	const LLZ80InstructionTemplates *templates;
+
 	struct LLZ80SignalObserverRecord *signalObservers;
 	unsigned int numberOfSignalObservers, numberOfAllocatedSignalObservers;
 	unsigned int allObservedSetLines, allObservedResetLines;
 
 	struct LLZ80InstructionObserverRecord *instructionObservers;
 
+	// traps are kept in a list, with a bit per address to say
+	// whether it's worth looking at that list
+	struct LLZ80TrapRecord *traps;
+	uint8_t trapAddresses[65536 >> 3];
+	bool isCallingTraps, hasRemovedTraps;
+
 	unsigned int internalTime;
 	bool isWaiting;
 	
 	int nmiStatus;
 
+	// fast mode; instructions it executes are paid for by fastModeHalfCycles
+	// plain advances before anything else happens
+	bool fastModeIsEnabled;
+	unsigned int fastModeHalfCycles;
+	const uint8_t *fastModeReadPages[kLLZ80FastModeNumberOfPages];
+	uint8_t *fastModeWritePages[kLLZ80FastModeNumberOfPages];
+	uint64_t fastModeExecutablePages;
+
 } LLZ80ProcessorState;
 
 /*
@@ -187,11 +260,18 @@ typedef struct LLZ80ProcessorState
 	static inline methods; glorified macros essentially
 
 */
+#define llz80_operand(z80, type, offset)	((type *)((uint8_t *)(z80) + (offset)))
+
+static inline size_t llz80_operandOffset(const LLZ80ProcessorState *const z80, const void *const operand)
+{
+	return (size_t)((const uint8_t *)operand - (const uint8_t *)z80);
+}
+
 static inline LLZ80InternalInstruction *llz80_scheduleFunction(LLZ80ProcessorState *const z80, LLZ80InternalInstructionFunction function)
 {
 	LLZ80InternalInstruction *const instruction = &z80->scheduledInstructions[z80->instructionWritePointer];
 	z80->scheduledInstructions[z80->instructionWritePointer].function = function;
-	z80->instructionWritePointer = (z80->instructionWritePointer + 1)%kLLZ80HalfCycleQueueLength;
+	z80->instructionWritePointer = (z80->instructionWritePointer + 1)&kLLZ80HalfCycleQueueMask;
 
 	return instruction;
 }
@@ -209,8 +289,31 @@ static inline LLZ80InternalInstruction *llz80_scheduleHalfCycleForFunction(LLZ80
 	return llz80_scheduleFunction(z80, function);
 }
 
+static inline void llz80_scheduleTemplate(LLZ80ProcessorState *const z80, const LLZ80InstructionTemplate template)
+{
+	const LLZ80InternalInstruction *instruction = &z80->templates->instructions[template.start];
+	const LLZ80InternalInstruction *const end = instruction + template.length;
+
+	// if there's nothing else still to do then the template can be stepped
+	// through where it is; otherwise it's copied to the end of the queue
+	if(z80->templateInstruction == z80->templateEnd && z80->instructionReadPointer == z80->instructionWritePointer)
+	{
+		z80->templateInstruction = instruction;
+		z80->templateEnd = end;
+	}
+	else
+	{
+		while(instruction != end)
+		{
+			z80->scheduledInstructions[z80->instructionWritePointer] = *instruction;
+			z80->instructionWritePointer = (z80->instructionWritePointer + 1)&kLLZ80HalfCycleQueueMask;
+			instruction++;
+		}
+	}
+}
+
 #define llz80m_beginScheduling()					unsigned int writePointer = z80->instructionWritePointer
-#define llz80m_advanceWritePointer()				writePointer = (writePointer + 1) % kLLZ80HalfCycleQueueLength
+#define llz80m_advanceWritePointer()				writePointer = (writePointer + 1) & kLLZ80HalfCycleQueueMask
 #define llz80m_scheduleFunction(func)				z80->scheduledInstructions[writePointer].function = func; llz80m_advanceWritePointer()
 #define llz80m_beginNewHalfCycle(isWait)			z80->scheduledInstructions[writePointer].function = llz80_iop_advanceHalfCycleCounter; z80->scheduledInstructions[writePointer].extraData.advance.isWaitCycle = isWait; llz80m_advanceWritePointer()
 #define llz80m_scheduleHalfCycleForFunction(func)	llz80m_beginNewHalfCycle(false); llz80m_scheduleFunction(func)
@@ -252,10 +355,14 @@ extern void llz80_setF(LLZ80ProcessorState *const z80, uint8_t value);
 		z80->internalBusState.lineValues =	\
 			(z80->internalBusState.lineValues&~CSBusStandardDataMask) | \
 			((uint64_t)(value) << CSBusStandardDataShift);\
+		csBus_driveLines(&z80->internalBusState, CSBusStandardDataMask);\
 	}
 
 #define llz80_setDataExpectingInput(z80)\
-		z80->internalBusState.lineValues |= CSBusStandardDataMask;
+	{\
+		z80->internalBusState.lineValues |= CSBusStandardDataMask;\
+		csBus_floatLines(&z80->internalBusState, CSBusStandardDataMask);\
+	}
 
 #define llz80_getDataInput(z80)\
 	((z80->externalBusState.lineValues&CSBusStandardDataMask) >> CSBusStandardDataShift)
@@ -13,12 +13,17 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <limits.h>
 
 #include "Z80StandardPageDecode.h"
 
 #include "Z80ScheduleInstructionFetch.h"
 #include "Z80StandardSchedulingComponents.h"
 #include "Z80ScheduleReadOrWrite.h"
+#include "Z80ScheduleTemplates.h"
+
+#include "Z80FastExecution.h"
+#include "Z80FlagTables.h"
 
 static void llz80_destroyGenericList(struct LLZ80GenericLinkedListRecord *list)
 {
@@ -70,26 +75,107 @@ static void llz80_destroy(void *const opaqueZ80)
 	// release all existing refereces to listeners
 	free(z80->signalObservers);
 	llz80_destroyGenericList((struct LLZ80GenericLinkedListRecord *)z80->instructionObservers);
+	llz80_destroyGenericList((struct LLZ80GenericLinkedListRecord *)z80->traps);
+}
+
+static inline bool llz80_addressIsTrapped(const LLZ80ProcessorState *const z80, const uint16_t address)
+{
+	return (z80->trapAddresses[address >> 3] >> (address&7))&1;
+}
+
+// an address remains trapped only while a trap that hasn't been removed is there
+static void llz80_updateTrapAddress(LLZ80ProcessorState *const z80, const uint16_t address)
+{
+	z80->trapAddresses[address >> 3] &= (uint8_t)~(1 << (address&7));
+	for(const struct LLZ80TrapRecord *trap = z80->traps; trap; trap = trap->next)
+	{
+		if(trap->address == address && !trap->isRemoved)
+		{
+			z80->trapAddresses[address >> 3] |= (uint8_t)(1 << (address&7));
+			break;
+		}
+	}
+}
+
+static void llz80_removeTrapRecord(LLZ80ProcessorState *const z80, struct LLZ80TrapRecord *const trap)
+{
+	const uint16_t address = trap->address;
+
+	llz80_removeItemFromGenericList(
+			(struct LLZ80GenericLinkedListRecord **)(&z80->traps),
+			(struct LLZ80GenericLinkedListRecord *)trap);
+	llz80_updateTrapAddress(z80, address);
+}
+
+static void llz80_callTraps(LLZ80ProcessorState *const z80, const uint16_t address)
+{
+	// handlers may remove any trap, so removals are deferred until
+	// the walk is over; once a handler has moved the program counter
+	// the remaining traps for this address no longer apply
+	z80->isCallingTraps = true;
+	for(const struct LLZ80TrapRecord *trap = z80->traps; trap; trap = trap->next)
+	{
+		if(trap->address != address || trap->isRemoved) continue;
+
+		trap->handler(z80, trap->context);
+		if(z80->pcRegister.fullValue != address) break;
+	}
+	z80->isCallingTraps = false;
+
+	if(z80->hasRemovedTraps)
+	{
+		z80->hasRemovedTraps = false;
+
+		struct LLZ80TrapRecord *trap = z80->traps;
+		while(trap)
+		{
+			struct LLZ80TrapRecord *const nextTrap = trap->next;
+			if(trap->isRemoved) llz80_removeTrapRecord(z80, trap);
+			trap = nextTrap;
+		}
+	}
+}
+
+// the inputs that the Z80 samples as it runs; the clock observer comes in variants that
+// skip sampling any of these that nothing on the bus is able to drive
+#define kLLZ80SampledInputs	(LLZ80SignalWait | LLZ80SignalInterruptRequest | LLZ80SignalNonMaskableInterruptRequest)
+
+static void inline llz80_proposeInterruptState(LLZ80ProcessorState *const restrict z80, const uint64_t sampledInputs)
+{
+	// check for interrupts and work out what we'd do if this
+	// does turn out to be the final sample before an instruction fetch
+	if(z80->nmiStatus == 1)
+		z80->proposedInterruptState = LLZ80InterruptStateNMI;
+	else
+		z80->proposedInterruptState = ((sampledInputs & LLZ80SignalInterruptRequest) && llz80_linesAreActive(z80, LLZ80SignalInterruptRequest) && z80->iff1) ? LLZ80InterruptStateIRQ : LLZ80InterruptStateNone;
+}
+
+static void inline llz80_sampleNonMaskableInterrupt(LLZ80ProcessorState *const restrict z80)
+{
+	// NMI is edge sampled, continuously
+	if(!(z80->externalBusState.lineValues&LLZ80SignalNonMaskableInterruptRequest))
+	{
+		if(!z80->nmiStatus)
+			z80->nmiStatus = 1;
+	}
+	else
+	{
+		if(z80->nmiStatus == 2)
+			z80->nmiStatus = 0;
+	}
 }
 
-static void inline llz80_iop_advanceHalfCycleCounter_imp(LLZ80ProcessorState *const restrict z80, const LLZ80InternalInstruction *const restrict instruction)
+static void inline llz80_iop_advanceHalfCycleCounter_imp(LLZ80ProcessorState *const restrict z80, const LLZ80InternalInstruction *const restrict instruction, const uint64_t sampledInputs)
 {
 	// increment the internal time counter
 	z80->internalTime++;
 
-	// if this is a leading edge, check for interrupts and
-	// work out what we'd do if this does turn out to be
-	// the final sample before an instruction fetch
+	// if this is a leading edge, check for interrupts
 	if(z80->externalBusState.lineValues & CSBusStandardClockLine)
-	{
-		if(z80->nmiStatus == 1)
-			z80->proposedInterruptState = LLZ80InterruptStateNMI;
-		else
-			z80->proposedInterruptState = (llz80_linesAreActive(z80, LLZ80SignalInterruptRequest) && z80->iff1) ? LLZ80InterruptStateIRQ : LLZ80InterruptStateNone;
-	}
+		llz80_proposeInterruptState(z80, sampledInputs);
 
 	// if this is a cycle that checks the wait state then do so
-	if(instruction->extraData.advance.isWaitCycle)
+	if((sampledInputs & LLZ80SignalWait) && instruction->extraData.advance.isWaitCycle)
 		z80->isWaiting = llz80_linesAreActive(z80, LLZ80SignalWait);
 }
 
@@ -128,51 +214,67 @@ LLZ80iop_restrict(llz80_iop_setupForInterruptMode2)
 }
 
 const LLZ80InternalInstructionFunction llz80_iop_advanceHalfCycleCounter = NULL;
-static LLZ80InternalInstruction waitCycles[2];
 
-csComponent_observer(llz80_observeClock)
+// the wait cycle is shared by every processor, so it's fixed at compile time
+// rather than written to whenever one is created
+static LLZ80InternalInstruction waitCycles[2] =
+{
+	{.extraData.advance.isWaitCycle = false},
+	{.extraData.advance.isWaitCycle = true}
+};
+
+static inline __attribute__((always_inline)) void llz80_observeClock_imp(
+	LLZ80ProcessorState *const restrict z80,
+	CSBusState *const restrict internalState,
+	const CSBusState externalState,
+	const uint64_t sampledInputs)
 {
-	LLZ80ProcessorState *const z80 = (LLZ80ProcessorState *const)context;
-
 	z80->externalBusState = externalState;
-
-	// NMI is edge sampled, continuously
-	if(!(externalState.lineValues&LLZ80SignalNonMaskableInterruptRequest))
-	{
-		if(!z80->nmiStatus)
-			z80->nmiStatus = 1;
-	}
-	else
-	{
-		if(z80->nmiStatus == 2)
-			z80->nmiStatus = 0;
-	}
+	if(sampledInputs & LLZ80SignalNonMaskableInterruptRequest)
+		llz80_sampleNonMaskableInterrupt(z80);
 
 	if(z80->isWaiting)
 	{
-		llz80_iop_advanceHalfCycleCounter_imp(z80, &waitCycles[z80->internalTime&1]);
+		llz80_iop_advanceHalfCycleCounter_imp(z80, &waitCycles[z80->internalTime&1], sampledInputs);
 	}
 	else
 	{
-		unsigned int instructionReadPointer = z80->instructionReadPointer;
-
 		while(1)
 		{
-			while(instructionReadPointer != z80->instructionWritePointer)
+			while(1)
 			{
-				const LLZ80InternalInstruction *const instruction = &z80->scheduledInstructions[instructionReadPointer];
-				LLZ80InternalInstructionFunction function = z80->scheduledInstructions[instructionReadPointer].function;
-				instructionReadPointer = (instructionReadPointer+1)%kLLZ80HalfCycleQueueLength;
+				// the current template comes first, then the queue
+				const LLZ80InternalInstruction *instruction;
+				if(z80->templateInstruction != z80->templateEnd)
+				{
+					instruction = z80->templateInstruction;
+					z80->templateInstruction++;
+				}
+				else if(z80->instructionReadPointer != z80->instructionWritePointer)
+				{
+					instruction = &z80->scheduledInstructions[z80->instructionReadPointer];
+					z80->instructionReadPointer = (z80->instructionReadPointer+1)&kLLZ80HalfCycleQueueMask;
+				}
+				else break;
 
-				if(function)
-					function(z80, instruction);
+				if(instruction->function)
+					instruction->function(z80, instruction);
 				else
 				{
-					llz80_iop_advanceHalfCycleCounter_imp(z80, instruction);
+					llz80_iop_advanceHalfCycleCounter_imp(z80, instruction, sampledInputs);
 					goto doubleBreak;
 				}
 			}
 
+			// if fast mode has performed an instruction then the time it
+			// would have taken is spent before anything else happens
+			if(z80->fastModeHalfCycles)
+			{
+				z80->fastModeHalfCycles--;
+				llz80_iop_advanceHalfCycleCounter_imp(z80, &waitCycles[0], sampledInputs);
+				goto doubleBreak;
+			}
+
 			if(	(z80->proposedInterruptState == LLZ80InterruptStateIRQ) ||
 				(z80->proposedInterruptState == LLZ80InterruptStateNMI))
 			{
@@ -188,6 +290,19 @@ csComponent_observer(llz80_observeClock)
 			{
 				default:
 				{
+					// traps are checked for first, as they may move the
+					// program counter before anything else sees it
+					if(llz80_addressIsTrapped(z80, z80->pcRegister.fullValue))
+						llz80_callTraps(z80, z80->pcRegister.fullValue);
+
+					// fast mode can take the whole of the next instruction
+					// if nobody needs to see it begin
+					if(z80->fastModeIsEnabled && !z80->instructionObservers)
+					{
+						z80->fastModeHalfCycles = llz80_fast_executeInstruction(z80);
+						if(z80->fastModeHalfCycles) continue;
+					}
+
 					// if someone is observing for the beginning of new instruction fetches,
 					// then give them a shout out now
 					const struct LLZ80InstructionObserverRecord *instructionObserver = z80->instructionObservers;
@@ -197,7 +312,7 @@ csComponent_observer(llz80_observeClock)
 						instructionObserver = instructionObserver->next;
 					}
 
-					llz80_scheduleInstructionFetchForFunction(z80, llz80_iop_standardPageDecode, &z80->hlRegister, false);
+					llz80_scheduleTemplate(z80, z80->templates->instructionFetch);
 				}
 				break;
 
@@ -238,7 +353,7 @@ csComponent_observer(llz80_observeClock)
 
 					if(instruction)
 					{
-						instruction->extraData.opcodeDecode.indexRegister = &z80->hlRegister;
+						instruction->extraData.opcodeDecode.indexRegister = offsetof(LLZ80ProcessorState, hlRegister);
 						instruction->extraData.opcodeDecode.addOffset = false;
 					}
 				}
@@ -278,43 +393,182 @@ csComponent_observer(llz80_observeClock)
 			}
 		}
 
-		doubleBreak:
-		z80->instructionReadPointer = instructionReadPointer;
+		doubleBreak:;
 	}
 
 	*internalState = z80->internalBusState;
 }
 
+// variant n samples WAIT if bit 0 is set, INT if bit 1 is set and NMI if bit 2 is set
+#define llz80_sampledInputsForVariant(n)	\
+	((((n)&1) ? LLZ80SignalWait : 0) | (((n)&2) ? LLZ80SignalInterruptRequest : 0) | (((n)&4) ? LLZ80SignalNonMaskableInterruptRequest : 0))
+
+#define llz80_declareClockObserverVariant(n)	\
+	csComponent_observer(llz80_observeClock##n)	\
+	{	\
+		llz80_observeClock_imp((LLZ80ProcessorState *const)context, internalState, externalState, llz80_sampledInputsForVariant(n));	\
+	}
+
+llz80_declareClockObserverVariant(0)
+llz80_declareClockObserverVariant(1)
+llz80_declareClockObserverVariant(2)
+llz80_declareClockObserverVariant(3)
+llz80_declareClockObserverVariant(4)
+llz80_declareClockObserverVariant(5)
+llz80_declareClockObserverVariant(6)
+llz80_declareClockObserverVariant(7)
+
+static const csComponent_handlerFunction llz80_clockObservers[8] =
+{
+	llz80_observeClock0, llz80_observeClock1, llz80_observeClock2, llz80_observeClock3,
+	llz80_observeClock4, llz80_observeClock5, llz80_observeClock6, llz80_observeClock7
+};
+
+static csComponent_handlerFunction llz80_specialiseClockObserver(void *const restrict context, const uint64_t drivenLines)
+{
+	// BUSRQ and RESET aren't sampled by the clock observer at all, so
+	// there's nothing to be gained from considering them here
+	return llz80_clockObservers[
+		((drivenLines & LLZ80SignalWait) ? 1 : 0) |
+		((drivenLines & LLZ80SignalInterruptRequest) ? 2 : 0) |
+		((drivenLines & LLZ80SignalNonMaskableInterruptRequest) ? 4 : 0)];
+}
+
+static unsigned int llz80_quietHalfCycles(void *const restrict context, const CSBusState internalState, const CSBusState externalState)
+{
+	LLZ80ProcessorState *const z80 = (LLZ80ProcessorState *const)context;
+	const bool waitIsActive = !(externalState.lineValues & LLZ80SignalWait);
+
+	// a wait state lasts for as long as the wait line is held
+	if(z80->isWaiting)
+		return waitIsActive ? UINT_MAX : 0;
+
+	// whatever is owed for an instruction performed by fast mode is
+	// pure advances, and the queue is always empty while anything is
+	if(z80->fastModeHalfCycles)
+		return z80->fastModeHalfCycles;
+
+	// otherwise count the pure advances at the head of the current template
+	// and then the queue; a half cycle that only advances does nothing that
+	// can't be done in bulk, whereas anything else might affect the bus. If
+	// one of them samples the wait line and finds it active then we'll be
+	// waiting from then on
+	unsigned int halfCycles = 0;
+	const LLZ80InternalInstruction *templateInstruction = z80->templateInstruction;
+	while(templateInstruction != z80->templateEnd)
+	{
+		if(templateInstruction->function) return halfCycles;
+		if(templateInstruction->extraData.advance.isWaitCycle && waitIsActive) return UINT_MAX;
+
+		halfCycles++;
+		templateInstruction++;
+	}
+
+	unsigned int instructionReadPointer = z80->instructionReadPointer;
+	while(instructionReadPointer != z80->instructionWritePointer)
+	{
+		const LLZ80InternalInstruction *const instruction = &z80->scheduledInstructions[instructionReadPointer];
+		if(instruction->function) break;
+		if(instruction->extraData.advance.isWaitCycle && waitIsActive) return UINT_MAX;
+
+		halfCycles++;
+		instructionReadPointer = (instructionReadPointer+1)&kLLZ80HalfCycleQueueMask;
+	}
+
+	return halfCycles;
+}
+
+static void llz80_advanceQuietHalfCycles(void *const restrict context, const CSBusState externalState, unsigned int halfCycles)
+{
+	LLZ80ProcessorState *const z80 = (LLZ80ProcessorState *const)context;
+
+	// the bus is otherwise constant, so NMI need be sampled only once
+	z80->externalBusState = externalState;
+	llz80_sampleNonMaskableInterrupt(z80);
+
+	// similarly, the proposed interrupt state would come out the
+	// same at every leading edge, so is worth considering only if
+	// there is one
+	if((externalState.lineValues & CSBusStandardClockLine) || halfCycles > 1)
+		llz80_proposeInterruptState(z80, kLLZ80SampledInputs);
+
+	// leave the bus state as it is for the final half cycle
+	if(!(halfCycles&1))
+		z80->externalBusState.lineValues ^= CSBusStandardClockLine;
+	z80->internalTime += halfCycles;
+
+	if(z80->fastModeHalfCycles)
+	{
+		z80->fastModeHalfCycles -= halfCycles;
+		return;
+	}
+
+	// consume queued advances; if one of them checks the wait line
+	// then the processor will be waiting for the rest of the period
+	while(halfCycles-- && !z80->isWaiting)
+	{
+		const LLZ80InternalInstruction *instruction;
+		if(z80->templateInstruction != z80->templateEnd)
+		{
+			instruction = z80->templateInstruction;
+			z80->templateInstruction++;
+		}
+		else
+		{
+			instruction = &z80->scheduledInstructions[z80->instructionReadPointer];
+			z80->instructionReadPointer = (z80->instructionReadPointer+1)&kLLZ80HalfCycleQueueMask;
+		}
+
+		if(instruction->extraData.advance.isWaitCycle)
+			z80->isWaiting = llz80_linesAreActive(z80, LLZ80SignalWait);
+	}
+}
+
 void *llz80_createOnBus(void *const bus)
 {
+	// every instruction's template is needed up front; there's
+	// nothing to be done without them
+	const LLZ80InstructionTemplates *const templates = llz80_getTemplates();
+	if(!templates) return NULL;
+
 	LLZ80ProcessorState *const z80 = (LLZ80ProcessorState *)calloc(1, sizeof(LLZ80ProcessorState));
 
 	if(z80)
 	{
-		// set up our wait cycle
-		waitCycles[0].extraData.advance.isWaitCycle = false;
-		waitCycles[1].extraData.advance.isWaitCycle = true;
+		// make sure the flag tables are ready
+		llz80_buildFlagTables();
+		z80->templates = templates;
 
 		// return an owning reference
 		csObject_init(z80);
 		z80->referenceCountedObject.dealloc = llz80_destroy;
+		z80->referenceCountedObject.type = "Z80";
 
 		// place the z80 in power-on state
 		z80->aRegister = 0xff;
 		z80->generalFlags = z80->lastSignResult = z80->bit5And3Flags = 0xff;
 		z80->spRegister.fullValue = 0xffff;
 
-		// add to the bus
+		// add to the bus; other than the data lines, everything the Z80
+		// outputs is always driven one way or the other
 		z80->internalBusState = csBus_defaultState();
-		csFlatBus_createComponent(
+		csBus_driveLines(
+			&z80->internalBusState,
+			CSBusStandardAddressMask | LLZ80SignalInputOutputRequest |
+			LLZ80SignalMachineCycleOne | LLZ80SignalRead | LLZ80SignalWrite |
+			LLZ80SignalMemoryRequest | LLZ80SignalRefresh | LLZ80SignalBusAcknowledge |
+			LLZ80SignalHalt);
+		void *const component = csFlatBus_createComponent(
 			bus,
-			llz80_observeClock,
+			llz80_clockObservers[7],
 			csBus_resetCondition(CSBusStandardClockLine, false),
 			CSBusStandardDataMask | CSBusStandardAddressMask | LLZ80SignalInputOutputRequest |
 			LLZ80SignalMachineCycleOne | LLZ80SignalRead | LLZ80SignalWrite |
 			LLZ80SignalMemoryRequest | LLZ80SignalRefresh | LLZ80SignalBusAcknowledge |
 			LLZ80SignalHalt,
 			z80);
+		csComponent_setQuiescenceFunctions(component, llz80_quietHalfCycles, llz80_advanceQuietHalfCycles);
+		csComponent_setSpecialisationFunction(component, llz80_specialiseClockObserver);
 	}
 
 	return z80;
@@ -348,6 +602,45 @@ void llz80_monitor_removeInstructionObserver(void *opaqueZ80, void *observer)
 			observer);
 }
 
+void *llz80_monitor_addTrap(void *const opaqueZ80, uint16_t address, llz80_instructionObserver handler, void *const context)
+{
+	LLZ80ProcessorState *const z80 = (LLZ80ProcessorState *)opaqueZ80;
+	struct LLZ80TrapRecord *trapRecord =
+		(struct LLZ80TrapRecord *)calloc(1, sizeof(struct LLZ80TrapRecord));
+
+	if(trapRecord)
+	{
+		trapRecord->address = address;
+		trapRecord->handler = handler;
+		trapRecord->context = context;
+
+		llz80_insertItemIntoGenericList(
+			(struct LLZ80GenericLinkedListRecord **)(&z80->traps),
+			(struct LLZ80GenericLinkedListRecord *)trapRecord);
+		z80->trapAddresses[address >> 3] |= (uint8_t)(1 << (address&7));
+	}
+
+	return trapRecord;
+}
+
+void llz80_monitor_removeTrap(void *opaqueZ80, void *trap)
+{
+	LLZ80ProcessorState *z80 = opaqueZ80;
+	struct LLZ80TrapRecord *const trapRecord = (struct LLZ80TrapRecord *)trap;
+
+	if(z80->isCallingTraps)
+	{
+		// leave the record in place for now, but stop the address
+		// being trapped if nothing else is there
+		trapRecord->isRemoved = true;
+		z80->hasRemovedTraps = true;
+		llz80_updateTrapAddress(z80, trapRecord->address);
+		return;
+	}
+
+	llz80_removeTrapRecord(z80, trapRecord);
+}
+
 uint64_t llz80_monitor_getBusLineState(void *opaqueZ80)
 {
 	const LLZ80ProcessorState *const z80 = opaqueZ80;
@@ -491,3 +784,30 @@ void llz80_monitor_setInternalValue(void *const opaqueZ80, LLZ80MonitorValue key
 		case LLZ80MonitorValueHalfCyclesToDate:	z80->internalTime = value;							break;
 	}
 }
+
+void llz80_fast_setMemoryPage(void *const opaqueZ80, uint16_t address, const uint8_t *readMemory, uint8_t *writeMemory, bool isExecutable)
+{
+	LLZ80ProcessorState *const z80 = (LLZ80ProcessorState *)opaqueZ80;
+	const unsigned int page = address / kLLZ80FastModePageSize;
+
+	z80->fastModeReadPages[page] = readMemory;
+	z80->fastModeWritePages[page] = writeMemory;
+	if(isExecutable)
+		z80->fastModeExecutablePages |= 1llu << page;
+	else
+		z80->fastModeExecutablePages &= ~(1llu << page);
+}
+
+void llz80_fast_setIsEnabled(void *const opaqueZ80, bool isEnabled)
+{
+	// this takes effect from the next instruction boundary; anything
+	// already performed by fast mode is still owed in full
+	LLZ80ProcessorState *const z80 = (LLZ80ProcessorState *)opaqueZ80;
+	z80->fastModeIsEnabled = isEnabled;
+}
+
+bool llz80_fast_getIsEnabled(void *const opaqueZ80)
+{
+	LLZ80ProcessorState *const z80 = (LLZ80ProcessorState *)opaqueZ80;
+	return z80->fastModeIsEnabled;
+}
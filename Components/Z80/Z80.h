@@ -115,7 +115,10 @@ void *llz80_createOnBus(void *bus);	// the returned object conforms to csObject,
 
 		Specifically: an observer can be notified whenever
 		a new instruction fetch is about to occur (ie, in
-		between opcodes).
+		between opcodes). A trap is the same thing, but only
+		for a fetch from one nominated address, and costs
+		nothing elsewhere; observers should be used only if
+		every instruction really is of interest.
 
 		Internal registers can be read or written. You can't
 		do that on a real Z80 and no external emulated
@@ -129,6 +132,13 @@ typedef void (* llz80_instructionObserver)(void *z80, void *context);
 void *llz80_monitor_addInstructionObserver(void *z80, llz80_instructionObserver observer, void *context);
 void llz80_monitor_removeInstructionObserver(void *z80, void *observer);
 
+// traps are called before the instruction fetch from address; the handler may
+// alter the program counter to divert the processor elsewhere, in which case no
+// further traps are called for that fetch — including any at the new address.
+// Handlers may add or remove traps, their own included
+void *llz80_monitor_addTrap(void *z80, uint16_t address, llz80_instructionObserver handler, void *context);
+void llz80_monitor_removeTrap(void *z80, void *trap);
+
 typedef enum
 {
 	// normal registers
@@ -203,4 +213,49 @@ extern void llz80_monitor_setInternalValue(void *z80, LLZ80MonitorValue key, uns
 
 extern uint64_t llz80_monitor_getBusLineState(void *const z80);
 
+/*
+
+	Fast mode.
+
+		The half-cycle accurate core is needed whenever
+		anything else is watching the bus, but most of the
+		time nothing other than memory is. Fast mode executes
+		whole instructions at once, directly against memory,
+		and then spends however long each would have taken
+		without doing anything else, which the bus can step
+		over in one go. The bus sees no memory accesses,
+		refresh cycles or M1 in the meantime.
+
+		Fast mode shares the Z80's registers, switches at
+		instruction boundaries and keeps to the same timing,
+		so nothing observable is lost at either end. The
+		Z80 returns to bus-accurate mode:
+
+			-	for I/O, HALT, EI, DI, RETI and RETN;
+			-	to accept an interrupt;
+			-	for any instruction that begins as one performed
+				on the bus finishes a write, as memory may not
+				have taken it yet;
+			-	while any instruction observer is registered;
+			-	for any instruction that fetches an opcode
+				from a page not marked as executable or that
+				touches a page with no memory; and
+			-	whenever fast mode is disabled.
+
+		Memory is supplied in pages of kLLZ80FastModePageSize
+		bytes, each with a pointer for reads and one for writes;
+		supply NULL for writes to discard them, as for ROM, or
+		for reads to leave the page to the bus. Pages are
+		initially all left to the bus.
+
+		Fast mode has no notion of WAIT, so shouldn't be enabled
+		while anything might assert it.
+
+*/
+#define kLLZ80FastModePageSize	1024
+
+void llz80_fast_setMemoryPage(void *z80, uint16_t address, const uint8_t *readMemory, uint8_t *writeMemory, bool isExecutable);
+void llz80_fast_setIsEnabled(void *z80, bool isEnabled);
+bool llz80_fast_getIsEnabled(void *z80);
+
 #endif
@@ -19,6 +19,7 @@
 #include "ZX8081MachineState.h"
 #include "StaticMemory.h"
 #include "FlatBus.h"
+#include "BusTraceRecorder.h"
 
 typedef struct LLZX80ULAState
 {
@@ -29,7 +30,10 @@ typedef struct LLZX80ULAState
 	LLZX8081MachineState *machineState;
 
 	// the internal state for the ZX80/81-specific components
-	void *tapeTrapObserver;
+	void *tapeTraps[2];
+
+	// a recorder, if the bus is being traced
+	void *busTraceRecorder;
 
 	// current machine type
 	LLZX8081MachineType machineType;
@@ -37,12 +41,13 @@ typedef struct LLZX80ULAState
 	uint8_t ROM[8192];
 	size_t ROMSize;
 	bool fastLoadingEnabled;
+	bool fastExecutionEnabled;
 
 } LLZX80ULAState;
 
 static int16_t llzx80ula_lookAheadForTapeByte(LLZX8081MachineState *machineState)
 {
-	unsigned int currentTime = csFlatBus_getHalfCyclesToDate(machineState->bus);
+	uint64_t currentTime = csFlatBus_getHalfCyclesToDate(machineState->bus);
 	uint64_t tapeTime = cstapePlayer_getTapeTime(machineState->tapePlayer, currentTime);
 
 	void *tape = cstapePlayer_getTape(machineState->tapePlayer);
@@ -89,80 +94,62 @@ static int16_t llzx80ula_lookAheadForTapeByte(LLZX8081MachineState *machineState
 	return byte;
 }
 
-static void llzx80ula_observeInstructionForTapeTrap(void *z80, void *context)
+static void llzx80ula_loadTapeByte(LLZX80ULAState *ula, void *z80, uint16_t resumeAddress)
 {
-	LLZX80ULAState *ula = (LLZX80ULAState *)context;
+	// we don't have a tape anyway, dummy
+	if(!cstapePlayer_getTape(ula->tapePlayer)) return;
+
+	// CPU is about to call in-byte to load another byte;
+	// decode next byte for ourselves
+	int16_t nextByte = llzx80ula_lookAheadForTapeByte(ula->machineState);
+
+	// if we collected 8 bits without error then
+	// write the thing out to HL and skip forward;
+	// otherwise we don't know what's going on so
+	// leave the ROM to it
+	if(nextByte != -1)
+	{
+		uint16_t hlRegister = (uint16_t)llz80_monitor_getInternalValue(z80, LLZ80MonitorValueHLRegister);
 
-	uint16_t programCounter = (uint16_t)llz80_monitor_getInternalValue(z80, LLZ80MonitorValuePCRegister);
+		uint8_t byteOnly = (uint8_t)nextByte;
+		csStaticMemory_setContents(ula->machineState->RAM, hlRegister - 16384, &byteOnly, 1);
+
+		llz80_monitor_setInternalValue(z80, LLZ80MonitorValuePCRegister, resumeAddress);
+	}
+}
 
-	// if the program counter is in the appropriate place for the ZX81
-	// ROM and this looks like the ZX81 ROM, read a byte, deposit it
+static void llzx80ula_trapZX81TapeByte(void *z80, void *context)
+{
+	LLZX80ULAState *ula = (LLZX80ULAState *)context;
+
+	// if this looks like the ZX81 ROM, read a byte, deposit it
 	// to (HL) and then move to the next bit of the ROM routines
 	if(
-		(programCounter == 0x037c) &&
 		ula->ROM[0x037c] == 0xcd &&
 		ula->ROM[0x037d] == 0x4c &&
 		ula->ROM[0x037e] == 0x03 &&
 		ula->ROM[0x037f] == 0x71)
-	{
-		// we don't have a tape anyway, dummy
-		if(!cstapePlayer_getTape(ula->tapePlayer)) return;
-
-		// CPU is about to call in-byte to load another byte;
-		// decode next byte for ourselves and set PC to 0x380
-		int16_t nextByte = llzx80ula_lookAheadForTapeByte(ula->machineState);
-
-		// if we collected 8 bits without error then
-		// write the thing out to HL and skip forward;
-		// otherwise we don't know what's going on so
-		// leave the ROM to it
-		if(nextByte != -1)
-		{
-			uint16_t hlRegister = (uint16_t)llz80_monitor_getInternalValue(z80, LLZ80MonitorValueHLRegister);
-
-			uint8_t byteOnly = (uint8_t)nextByte;
-			csStaticMemory_setContents(ula->machineState->RAM, hlRegister - 16384, &byteOnly, 1);
+		llzx80ula_loadTapeByte(ula, z80, 0x0380);
+}
 
-			llz80_monitor_setInternalValue(z80, LLZ80MonitorValuePCRegister, 0x0380);
-		}
-	}
+static void llzx80ula_trapZX80TapeByte(void *z80, void *context)
+{
+	LLZX80ULAState *ula = (LLZX80ULAState *)context;
 
 	// if this looks like a ZX80 ROM get byte, then do much the same thing
 	if(
-		(programCounter == 0x220) &&
 		ula->ROM[0x220] == 0x1e &&
 		ula->ROM[0x221] == 0x08 &&
 		ula->ROM[0x222] == 0x3e &&
-		ula->ROM[0x223] == 0x7f
-	)
-	{
-		// we don't have a tape anyway, dummy
-		if(!cstapePlayer_getTape(ula->tapePlayer)) return;
-
-		// CPU is about to call in-byte to load another byte;
-		// decode next byte for ourselves and set PC to 0x380
-		int16_t nextByte = llzx80ula_lookAheadForTapeByte(ula->machineState);
-
-		// if we collected 8 bits without error then
-		// write the thing out to HL and skip forward;
-		// otherwise we don't know what's going on so
-		// leave the ROM to it
-		if(nextByte != -1)
-		{
-			uint16_t hlRegister = (uint16_t)llz80_monitor_getInternalValue(z80, LLZ80MonitorValueHLRegister);
-
-			uint8_t byteOnly = (uint8_t)nextByte;
-			csStaticMemory_setContents(ula->machineState->RAM, hlRegister - 16384, &byteOnly, 1);
-
-			llz80_monitor_setInternalValue(z80, LLZ80MonitorValuePCRegister, 0x0248);
-		}
-	}
+		ula->ROM[0x223] == 0x7f)
+		llzx80ula_loadTapeByte(ula, z80, 0x0248);
 }
 
 static void llzx8081_destroy(void *opaqueULA)
 {
 	LLZX80ULAState *ula = (LLZX80ULAState *)opaqueULA;
 
+	csObject_release(ula->busTraceRecorder);
 	csObject_release(ula->CPU);
 	csObject_release(ula->machineState->bus);
 	csObject_release(ula->machineState);
@@ -172,9 +159,10 @@ static void llzx8081_destroy(void *opaqueULA)
 
 static void llzx80801_destroyMachine(LLZX80ULAState *ula)
 {
+	csObject_release(ula->busTraceRecorder); ula->busTraceRecorder = NULL;
 	csObject_release(ula->machineState); ula->machineState = NULL;
 	csObject_release(ula->CPU); ula->CPU = NULL;
-	ula->tapeTrapObserver = NULL;
+	ula->tapeTraps[0] = ula->tapeTraps[1] = NULL;
 }
 
 static void llzx80801_createMachine(LLZX80ULAState *ula)
@@ -200,15 +188,18 @@ static void llzx80801_createMachine(LLZX80ULAState *ula)
 		return NULL;
 	}*/
 
-	// get a tree from that
+	// get a tree from that; nothing further will be added
 	csFlatBus_setTicksPerSecond(bus, 3250000);
-	ula->machineState->bus = bus;
+	csFlatBus_freeze(bus);
 
 	// install the current ROM
 	csStaticMemory_setContents(ula->machineState->ROM, 0, ula->ROM, ula->ROMSize);
 	
 	// possibly install fast tape hack
 	llzx8081_setFastLoadingIsEnabled(ula, ula->fastLoadingEnabled);
+
+	// and fast execution
+	llzx8081_setFastExecutionIsEnabled(ula, ula->fastExecutionEnabled);
 }
 
 void *llzx8081_create(void)
@@ -241,23 +232,34 @@ void llzx8081_setFastLoadingIsEnabled(void *opaqueULA, bool isEnabled)
 	if (!ula->machineState) return;
 
 	// make sure we're not already in the requested state
-	if(isEnabled && ula->tapeTrapObserver) return;
-	if(!isEnabled && !ula->tapeTrapObserver) return;
+	if(isEnabled && ula->tapeTraps[0]) return;
+	if(!isEnabled && !ula->tapeTraps[0]) return;
 
 	// set the requested state, by installing or
-	// removing the fast tape instruction observer
+	// removing traps at the ROMs' get-byte routines
 	if(isEnabled)
 	{
-		ula->tapeTrapObserver = 
-			llz80_monitor_addInstructionObserver(ula->CPU, llzx80ula_observeInstructionForTapeTrap, ula);
+		ula->tapeTraps[0] = llz80_monitor_addTrap(ula->CPU, 0x037c, llzx80ula_trapZX81TapeByte, ula);
+		ula->tapeTraps[1] = llz80_monitor_addTrap(ula->CPU, 0x0220, llzx80ula_trapZX80TapeByte, ula);
 	}
 	else
 	{
-		llz80_monitor_removeInstructionObserver(ula->CPU, ula->tapeTrapObserver);
-		ula->tapeTrapObserver = NULL;
+		llz80_monitor_removeTrap(ula->CPU, ula->tapeTraps[0]);
+		llz80_monitor_removeTrap(ula->CPU, ula->tapeTraps[1]);
+		ula->tapeTraps[0] = ula->tapeTraps[1] = NULL;
 	}
 }
 
+void llzx8081_setFastExecutionIsEnabled(void *opaqueULA, bool isEnabled)
+{
+	LLZX80ULAState *ula = (LLZX80ULAState *)opaqueULA;
+
+	ula->fastExecutionEnabled = isEnabled;
+	if (!ula->machineState) return;
+
+	llzx8081_setFastExecutionCPU(ula->machineState, isEnabled ? ula->CPU : NULL);
+}
+
 void llzx8081_setMachineType(void *opaqueULA, LLZX8081MachineType type)
 {
 	LLZX80ULAState *ula = (LLZX80ULAState *)opaqueULA;
@@ -290,25 +292,91 @@ void llzx8081_setRAMSize(void *opaqueULA, LLZX8081RAMSize ramSize)
 	}
 }
 
-void llzx8081_runForHalfCycles(void *opaqueULA, unsigned int numberOfHalfCycles)
+static void llzx8081_prepareToRun(LLZX80ULAState *ula)
 {
-	LLZX80ULAState *ula = (LLZX80ULAState *)opaqueULA;
-	
 	// do we need to create a machine?
 	if(!ula->machineState)
 	{
 		llzx80801_createMachine(ula);
 	}
+}
+
+static void llzx8081_finishRunning(LLZX80ULAState *ula)
+{
+	// ensure the CRT and tape are up-to-date on the current output time
+	uint64_t timeNow = csFlatBus_getHalfCyclesToDate(ula->machineState->bus);
+	llcrt_runToTime(ula->CRT, timeNow);
+	cstapePlayer_runToTime(ula->tapePlayer, timeNow);
+}
+
+void llzx8081_runForHalfCycles(void *opaqueULA, unsigned int numberOfHalfCycles)
+{
+	LLZX80ULAState *ula = (LLZX80ULAState *)opaqueULA;
+	llzx8081_prepareToRun(ula);
 
 	// simple enough; have the Z80 run for that many cycles
 	// (we'll respond to events as they arise through the
 	// observer), then ensure the CRT is up-to-date on
 	// the current output time
 	csFlatBus_runForHalfCycles(ula->machineState->bus, numberOfHalfCycles);
+	llzx8081_finishRunning(ula);
+}
 
-	unsigned int timeNow = csFlatBus_getHalfCyclesToDate(ula->machineState->bus);
-	llcrt_runToTime(ula->CRT, timeNow);
-	cstapePlayer_runToTime(ula->tapePlayer, timeNow);
+// the debugger's stopping points are tracked by an instruction observer; the
+// bus stops as soon as the observer says that one has been reached
+struct LLZX8081RunTarget
+{
+	unsigned int instructionsToRun;
+	bool hasTargetAddress;
+	uint16_t targetAddress;
+	bool hasReachedTarget;
+};
+
+static void llzx8081_observeInstructionForRunTarget(void *z80, void *context)
+{
+	struct LLZX8081RunTarget *const target = (struct LLZX8081RunTarget *)context;
+
+	if(target->instructionsToRun)
+	{
+		target->instructionsToRun--;
+		if(!target->instructionsToRun) target->hasReachedTarget = true;
+	}
+
+	if(
+		target->hasTargetAddress &&
+		(uint16_t)llz80_monitor_getInternalValue(z80, LLZ80MonitorValuePCRegister) == target->targetAddress)
+		target->hasReachedTarget = true;
+}
+
+static bool llzx8081_hasReachedRunTarget(void *context)
+{
+	return ((struct LLZX8081RunTarget *)context)->hasReachedTarget;
+}
+
+static unsigned int llzx8081_runToTarget(LLZX80ULAState *ula, struct LLZX8081RunTarget *target, unsigned int maximumHalfCycles)
+{
+	llzx8081_prepareToRun(ula);
+
+	void *observer = llz80_monitor_addInstructionObserver(ula->CPU, llzx8081_observeInstructionForRunTarget, target);
+	unsigned int halfCyclesRun = csFlatBus_runUntilPredicate(ula->machineState->bus, maximumHalfCycles, llzx8081_hasReachedRunTarget, target);
+	llz80_monitor_removeInstructionObserver(ula->CPU, observer);
+
+	llzx8081_finishRunning(ula);
+	return halfCyclesRun;
+}
+
+unsigned int llzx8081_runUntilAddress(void *opaqueULA, uint16_t address, unsigned int maximumHalfCycles)
+{
+	struct LLZX8081RunTarget target = {.hasTargetAddress = true, .targetAddress = address};
+	return llzx8081_runToTarget((LLZX80ULAState *)opaqueULA, &target, maximumHalfCycles);
+}
+
+unsigned int llzx8081_runForInstructions(void *opaqueULA, unsigned int numberOfInstructions, unsigned int maximumHalfCycles)
+{
+	if(!numberOfInstructions) return 0;
+
+	struct LLZX8081RunTarget target = {.instructionsToRun = numberOfInstructions};
+	return llzx8081_runToTarget((LLZX80ULAState *)opaqueULA, &target, maximumHalfCycles);
 }
 
 void *llzx8081_getCRT(void *opaqueULA)
@@ -350,12 +418,35 @@ void llzx8081_setTape(void *opaqueULA, void *tape)
 		llzx8081_getTimeStamp(ula));
 }
 
+void *llzx8081_getBus(void *opaqueULA)
+{
+	LLZX80ULAState *ula = (LLZX80ULAState *)opaqueULA;
+	return ula->machineState ? ula->machineState->bus : NULL;
+}
+
 void *llzx8081_getTapePlayer(void *ula)
 {
 	return ((LLZX80ULAState *)ula)->tapePlayer;
 }
 
-unsigned int llzx8081_getTimeStamp(void *opaqueULA)
+bool llzx8081_startRecordingBusTrace(void *opaqueULA, const char *path)
+{
+	LLZX80ULAState *ula = (LLZX80ULAState *)opaqueULA;
+	llzx8081_prepareToRun(ula);
+
+	csObject_release(ula->busTraceRecorder);
+	ula->busTraceRecorder = csBusTraceRecorder_createForBus(ula->machineState->bus, path);
+	return ula->busTraceRecorder ? true : false;
+}
+
+void llzx8081_stopRecordingBusTrace(void *opaqueULA)
+{
+	LLZX80ULAState *ula = (LLZX80ULAState *)opaqueULA;
+	csObject_release(ula->busTraceRecorder);
+	ula->busTraceRecorder = NULL;
+}
+
+uint64_t llzx8081_getTimeStamp(void *opaqueULA)
 {
 	LLZX80ULAState *ula = (LLZX80ULAState *)opaqueULA;
 	return ula->machineState ? csFlatBus_getHalfCyclesToDate(ula->machineState->bus) : 0;
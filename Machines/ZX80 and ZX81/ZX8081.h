@@ -31,14 +31,36 @@ void llzx8081_setRAMSize(void *ula, LLZX8081RAMSize ramSize);
 
 void llzx8081_runForHalfCycles(void *opaqueULA, unsigned int numberOfHalfCycles);
 
+// these run at full speed until the CPU is just about to fetch the instruction
+// at the given address, or until it has begun the nominated number of new
+// instructions, or for the maximum number of half cycles, whichever comes
+// first; each returns the number of half cycles actually run
+unsigned int llzx8081_runUntilAddress(void *ula, uint16_t address, unsigned int maximumHalfCycles);
+unsigned int llzx8081_runForInstructions(void *ula, unsigned int numberOfInstructions, unsigned int maximumHalfCycles);
+
 void *llzx8081_getCRT(void *ula);
 void *llzx8081_getCPU(void *ula);
 
+// the bus is created when the machine is first run, and replaced whenever the
+// machine type or RAM size changes; this returns NULL if there isn't one yet
+void *llzx8081_getBus(void *ula);
+
 void llzx8081_setTape(void *ula, void *tape);
 void *llzx8081_getTapePlayer(void *ula);
-unsigned int llzx8081_getTimeStamp(void *ula);
+uint64_t llzx8081_getTimeStamp(void *ula);
+
+// records every change to the bus, other than the clock, to the named file
+// until recording is stopped or the machine is reconfigured; see
+// BusTraceRecorder.h for the format and BusTraceConverter.h for conversion
+bool llzx8081_startRecordingBusTrace(void *ula, const char *path);
+void llzx8081_stopRecordingBusTrace(void *ula);
 void llzx8081_setFastLoadingIsEnabled(void *ula, bool isEnabled);
 
+// fast execution lets the CPU run without the bus whenever the display has
+// been off for a whole frame, such as while a ZX81 is in FAST mode, which is
+// quicker for as long as it lasts; it's off by default
+void llzx8081_setFastExecutionIsEnabled(void *ula, bool isEnabled);
+
 // use this to get the contents of memory; it'll negotiate the memory
 // map to return contents of ROM or RAM as appropriate, applying the
 // normal mirroring rules
@@ -21,7 +21,7 @@
 static void inline llzx80ula_considerSync(LLZX8081MachineState *const restrict machineState)
 {
 	// set the current output level on the CRT
-	unsigned int currentTime = csFlatBus_getHalfCyclesToDate(machineState->bus);
+	uint64_t currentTime = csFlatBus_getHalfCyclesToDate(machineState->bus);
 	if(machineState->vsyncIsActive || machineState->hsyncIsActive)
 		llcrt_setSyncLevel(machineState->CRT, currentTime);
 	else
@@ -49,6 +49,26 @@ static void inline llz80ula_resetHsyncActive(LLZX8081MachineState *const restric
 	machineState->lastHSyncLevel = false;
 }
 
+// The ZX81's ULA is clocked on the rising edges, which are the odd half cycles
+static inline uint64_t llzx81ula_nextClockEdge(const LLZX8081MachineState *const restrict machineState)
+{
+	return csFlatBus_getHalfCyclesToDate(machineState->bus) | 1;
+}
+
+// NMI is requested for as long as sync is active, if the generator is enabled
+static inline void llzx81ula_setNMI(const LLZX8081MachineState *const restrict machineState, CSBusState *const restrict outputState)
+{
+	if(machineState->nmiIsEnabled && machineState->hsyncIsActive)
+		outputState->lineValues &= ~LLZ80SignalNonMaskableInterruptRequest;
+	else
+		outputState->lineValues |= LLZ80SignalNonMaskableInterruptRequest;
+}
+
+static void llzx81ula_updateNMI(void *context, CSBusState *outputState, uint64_t halfCycleTime)
+{
+	llzx81ula_setNMI((LLZX8081MachineState *)context, outputState);
+}
+
 /*
 	Memory map:
 
@@ -86,6 +106,7 @@ csComponent_observer(llzx80ula_observeRefresh)
 		if(machineState->fetchVideoByte)
 		{
 			machineState->fetchVideoByte = false;
+			csFlatBus_invalidateFilter(machineState->romFilter);
 			uint8_t videoByte;
 
 			// if so, would the ROM actually serve this address?
@@ -139,7 +160,7 @@ csComponent_observer(llzx80ula_observeIORead)
 				void *tape = cstapePlayer_getTape(machineState->tapePlayer);
 				if(tape)
 				{
-					unsigned int currentTime = csFlatBus_getHalfCyclesToDate(machineState->bus);
+					uint64_t currentTime = csFlatBus_getHalfCyclesToDate(machineState->bus);
 					uint64_t tapeTime = cstapePlayer_getTapeTime(machineState->tapePlayer, currentTime);
 
 					if(cstape_getLevelAtTime(tape, tapeTime) == CSTapeLevelLow)
@@ -178,10 +199,22 @@ csComponent_observer(llzx80ula_observeIOWrite)
 		machineState->nmiIsEnabled = false;
 	}
 
+	// the NMI output changes accordingly on the next clock
+	if((~address&3) && machineState->machineType == LLZX8081MachineTypeZX81)
+	{
+		csFlatBus_scheduleEvent(machineState->bus, llzx81ula_nextClockEdge(machineState), llzx81ula_updateNMI, machineState);
+	}
+
 	if(!(address&4))
 	{
 	}
 
+	// a ZX81 with the NMI generator on is displaying something
+	if(machineState->nmiIsEnabled && machineState->fastExecutionCPU)
+	{
+		llz80_fast_setIsEnabled(machineState->fastExecutionCPU, false);
+	}
+
 	if((address&7) == 7)
 	{
 		if(!machineState->nmiIsEnabled)
@@ -203,15 +236,89 @@ csComponent_observer(llzx80ula_observeIOWrite)
 //	}
 }
 
+// The ZX81's horizontal sync comes from a 207-cycle counter, with sync active
+// while the count is from 16 to 31; the counter is reset by an interrupt
+// acknowledge. Rather than counting every cycle, we schedule events for
+// the ends of each period
+#define kLLZX81HSyncCounterLength	207
+#define kLLZX81HSyncStart			16
+#define kLLZX81HSyncEnd				32
+
+static void llzx81ula_startHSync(void *context, CSBusState *outputState, uint64_t halfCycleTime);
+static void llzx81ula_endHSync(void *context, CSBusState *outputState, uint64_t halfCycleTime)
+{
+	LLZX8081MachineState *const machineState = (LLZX8081MachineState *)context;
+	llz80ula_resetHsyncActive(machineState);
+	llzx81ula_setNMI(machineState, outputState);
+
+	// the counter runs on to its end, wraps to zero and then up to the start of sync
+	csFlatBus_scheduleEvent(
+		machineState->bus,
+		halfCycleTime + ((kLLZX81HSyncCounterLength - kLLZX81HSyncEnd + kLLZX81HSyncStart) << 1),
+		llzx81ula_startHSync,
+		machineState);
+}
+
+static void llzx81ula_startHSync(void *context, CSBusState *outputState, uint64_t halfCycleTime)
+{
+	LLZX8081MachineState *const machineState = (LLZX8081MachineState *)context;
+	llz80ula_setHsyncActive(machineState);
+	llzx81ula_setNMI(machineState, outputState);
+
+	csFlatBus_scheduleEvent(
+		machineState->bus,
+		halfCycleTime + ((kLLZX81HSyncEnd - kLLZX81HSyncStart) << 1),
+		llzx81ula_endHSync,
+		machineState);
+}
+
+// this occurs on the first clock after the counter is reset, at which point it
+// counts one, ending sync if it's active
+static void llzx81ula_restartHSync(void *context, CSBusState *outputState, uint64_t halfCycleTime)
+{
+	LLZX8081MachineState *const machineState = (LLZX8081MachineState *)context;
+	llz80ula_resetHsyncActive(machineState);
+	llzx81ula_setNMI(machineState, outputState);
+
+	csFlatBus_scheduleEvent(
+		machineState->bus,
+		halfCycleTime + ((kLLZX81HSyncStart - 1) << 1),
+		llzx81ula_startHSync,
+		machineState);
+}
+
+static void llzx81ula_resetHSyncCounter(LLZX8081MachineState *const machineState)
+{
+	csFlatBus_cancelEvents(machineState->bus, llzx81ula_restartHSync, machineState);
+	csFlatBus_cancelEvents(machineState->bus, llzx81ula_startHSync, machineState);
+	csFlatBus_cancelEvents(machineState->bus, llzx81ula_endHSync, machineState);
+	csFlatBus_scheduleEvent(machineState->bus, llzx81ula_nextClockEdge(machineState), llzx81ula_restartHSync, machineState);
+}
+
+// the display depends on seeing the processor's bus activity — video fetches,
+// and on a ZX80 the M1 cycles that follow an interrupt — so fast execution is
+// off for as long as it's on
+static void llzx8081_noteDisplayIsActive(LLZX8081MachineState *const machineState)
+{
+	machineState->displayWasActive = true;
+	if(machineState->fastExecutionCPU)
+		llz80_fast_setIsEnabled(machineState->fastExecutionCPU, false);
+}
+
 csComponent_observer(llzx80ula_observeIntAck)
 {
 	// This triggers on IO request + M1 active, i.e. interrupt acknowledge;
 	// we need to arrange for horizontal sync to occur; the ZX81 has a
 	// well-documented counter for the purpose and we'll need to count M1
-	// cycles on a ZX80 so the action is the same either way
-	((LLZX8081MachineState *)context)->hsyncCounter = 0;
-}
+	// cycles on a ZX80
+	LLZX8081MachineState *const machineState = (LLZX8081MachineState *)context;
+	if(machineState->machineType == LLZX8081MachineTypeZX81)
+		llzx81ula_resetHSyncCounter(machineState);
+	else
+		machineState->hsyncCounter = 0;
 
+	llzx8081_noteDisplayIsActive(machineState);
+}
 
 // This one is hooked up for the ZX80 only
 csComponent_observer(llzx80ula_observeMachineCycleOne)
@@ -237,43 +344,14 @@ csComponent_observer(llzx80ula_observeMachineCycleOne)
 	}
 }
 
-// This one is hooked up for the ZX81 only
-csComponent_observer(llzx80ula_observeClock)
+// This one is hooked up for the ZX81 only; the Z80 is held in WAIT while
+// NMI is requested, unless it's halted
+csComponent_observer(llzx81ula_observeNonMaskableInterrupt)
 {
-	LLZX8081MachineState *const restrict machineState = (LLZX8081MachineState *const)context;
-
-	// increment the hsync counter, check whether sync output is
-	// currently active as a result
-	machineState->hsyncCounter++;
-	if(machineState->hsyncCounter == 207)
-	{
-		machineState->hsyncCounter = 0;
-		llz80ula_resetHsyncActive(machineState);
-	}
-	else
-	{
-		if( (machineState->hsyncCounter >= 16) && (machineState->hsyncCounter < 32) )
-			llz80ula_setHsyncActive(machineState);
-		else
-			llz80ula_resetHsyncActive(machineState);
-	}
-
-	if(machineState->nmiIsEnabled && machineState->hsyncIsActive)
-	{
-		internalState->lineValues &= ~ LLZ80SignalNonMaskableInterruptRequest;
-
-		if(externalState.lineValues & LLZ80SignalHalt)
-			internalState->lineValues &= ~ LLZ80SignalWait;
-		else
-			internalState->lineValues |= LLZ80SignalWait;
-	}
+	if(conditionIsTrue)
+		internalState->lineValues &= ~LLZ80SignalWait;
 	else
-	{
-		internalState->lineValues |= LLZ80SignalWait | LLZ80SignalNonMaskableInterruptRequest;
-	}
-
-	// determine what to do about sync level output as a result
-//	llzx80ula_considerSync(machineState);
+		internalState->lineValues |= LLZ80SignalWait;
 }
 
 csComponent_observer(llzx80ula_observeVideoRead)
@@ -291,8 +369,11 @@ csComponent_observer(llzx80ula_observeVideoRead)
 											// in front of the ROM, for the duration of fetchVideoByte being true
 
 		machineState->fetchVideoByte = true;
+		csFlatBus_invalidateFilter(machineState->romFilter);
 		machineState->videoByteXorMask = (value&0x80) ? 0x00 : 0xff;
 
+		llzx8081_noteDisplayIsActive(machineState);
+
 		// force a NOP onto the data bus
 		internalState->lineValues &= ~CSBusStandardDataMask;
 	}
@@ -309,13 +390,73 @@ static CSBusState llzx80ula_romAddressShuffle(void *const context, CSBusState ex
 	{
 		// we replace the low 9 bits of the address, so...
 		externalState.lineValues =
-			(externalState.lineValues & ~(511u << CSBusStandardAddressShift)) |
+			(externalState.lineValues & ~(511llu << CSBusStandardAddressShift)) |
 			(uint64_t)(machineState->videoFetchAddress << CSBusStandardAddressShift);
 	}
 	
 	return externalState;
 }
 
+// fast execution is reconsidered once a frame, which is 65000 cycles
+// on either machine, give or take
+#define kLLZX8081FastExecutionPeriod	130000
+
+static void llzx8081_considerFastExecution(void *context, CSBusState *outputState, uint64_t halfCycleTime)
+{
+	LLZX8081MachineState *const machineState = (LLZX8081MachineState *)context;
+
+	llz80_fast_setIsEnabled(machineState->fastExecutionCPU, !machineState->displayWasActive && !machineState->nmiIsEnabled);
+	machineState->displayWasActive = false;
+
+	csFlatBus_scheduleEvent(machineState->bus, halfCycleTime + kLLZX8081FastExecutionPeriod, llzx8081_considerFastExecution, machineState);
+}
+
+void llzx8081_setFastExecutionCPU(LLZX8081MachineState *const machineState, void *const CPU)
+{
+	if(machineState->fastExecutionCPU)
+	{
+		llz80_fast_setIsEnabled(machineState->fastExecutionCPU, false);
+		csFlatBus_cancelEvents(machineState->bus, llzx8081_considerFastExecution, machineState);
+	}
+
+	machineState->fastExecutionCPU = CPU;
+	if(!CPU) return;
+
+	// map memory per the same rules as the bus; the ROM can't be
+	// written and anything in the top 32kb is executed only via
+	// the bus, as that's where the video is
+	uint8_t *const ROM = csStaticMemory_getStorage(machineState->ROM);
+	uint8_t *const RAM = csStaticMemory_getStorage(machineState->RAM);
+	const unsigned int romTop = (machineState->ramSize == LLZX8081RAMSize64Kb) ? 0x2000 : 0x4000;
+
+	for(unsigned int address = 0; address < 65536; address += kLLZ80FastModePageSize)
+	{
+		uint8_t *page = NULL;
+		bool isROM = false;
+
+		if(address < romTop)
+		{
+			page = &ROM[address & 0x1fff];
+			isROM = true;
+		}
+
+		if(address & 0x4000)
+		{
+			if(machineState->ramSize == LLZX8081RAMSize1Kb)
+			{
+				if(!(address & 0x3c00)) page = RAM;
+			}
+			else
+				page = &RAM[address & 0x3fff];
+		}
+
+		llz80_fast_setMemoryPage(CPU, (uint16_t)address, page, isROM ? NULL : page, page && address < 0x8000);
+	}
+
+	machineState->displayWasActive = true;
+	csFlatBus_scheduleEvent(machineState->bus, csFlatBus_getHalfCyclesToDate(machineState->bus) + kLLZX8081FastExecutionPeriod, llzx8081_considerFastExecution, machineState);
+}
+
 static void llzx8081_destroyMachineState(void *opaqueMachineState)
 {
 	LLZX8081MachineState *const machineState = (LLZX8081MachineState *const )opaqueMachineState;
@@ -333,6 +474,8 @@ LLZX8081MachineState *llzx8081_createMachineStateOnBus(void *bus, LLZX8081Machin
 	{
 		csObject_init(machineState);
 		machineState->referenceCountedObject.dealloc = llzx8081_destroyMachineState;
+		machineState->referenceCountedObject.type = "ZX80/81 ULA";
+		machineState->bus = bus;
 
 		// create a CRT
 		machineState->CRT = csObject_retain(CRT);
@@ -340,12 +483,26 @@ LLZX8081MachineState *llzx8081_createMachineStateOnBus(void *bus, LLZX8081Machin
 		// create a tape player
 		machineState->tapePlayer = csObject_retain(tapePlayer);
 
+		// the ULA's IO ports go on a bus of their own, selected by IORQ, so
+		// that they aren't considered during memory cycles. Memory itself
+		// stays on the main bus: it's selected for almost every cycle, so
+		// putting it behind a bridge would just add the cost of the bridge
+		void *ioBus = csFlatBus_create();
+		if(!ioBus)
+		{
+			csObject_release(machineState->CRT);
+			csObject_release(machineState->tapePlayer);
+			free(machineState);
+			return NULL;
+		}
+
 		// we can handle ROMs up to an amazing
 		// 8kb in size! ROM is triggered on
 		// the top two address lines being zero,
 		// memory request being active (ie, low) and
 		// write being inactive (ie, high)
-		csFlatBus_setModalComponentFilter(bus, llzx80ula_romAddressShuffle, machineState);
+		machineState->romFilter = csFlatBus_createFilter(bus, llzx80ula_romAddressShuffle, 511llu << CSBusStandardAddressShift, machineState);
+		csFlatBus_setModalComponentFilter(bus, machineState->romFilter);
 		if(ramSize != LLZX8081RAMSize64Kb)
 		{
 			// responds when the top two bits of the address bus are clear,
@@ -366,7 +523,7 @@ LLZX8081MachineState *llzx8081_createMachineStateOnBus(void *bus, LLZX8081Machin
 				csBus_impossibleCondition() 
 				);
 		}
-		csFlatBus_setModalComponentFilter(bus, NULL, NULL);
+		csFlatBus_setModalComponentFilter(bus, NULL);
 
 		// RAM can be up to 64kb! That's more than
 		// anybody could or would ever want
@@ -404,6 +561,7 @@ LLZX8081MachineState *llzx8081_createMachineStateOnBus(void *bus, LLZX8081Machin
 			csObject_release(machineState->tapePlayer);
 			csObject_release(machineState->ROM);
 			csObject_release(machineState->RAM);
+			csObject_release(ioBus);
 			free(machineState);
 			return NULL;
 		}
@@ -411,22 +569,26 @@ LLZX8081MachineState *llzx8081_createMachineStateOnBus(void *bus, LLZX8081Machin
 		// set no keys currently pressed
 		memset(machineState->keyLines, 0xff, 8);
 
-		// add machine emulation components to the bus
-		csFlatBus_createComponent(
-			bus,
+		// add machine emulation components to the bus, each of which
+		// is given a type of its own for the purposes of profiling
+		void *component;
+		component = csFlatBus_createComponent(
+			ioBus,
 			llzx80ula_observeIntAck,
 			csBus_resetCondition(LLZ80SignalMachineCycleOne | LLZ80SignalInputOutputRequest, true), 
 			0,
 			machineState);
+		csComponent_setType(component, "ZX80/81 ULA: interrupt acknowledge");
 
-		csFlatBus_createComponent(
+		component = csFlatBus_createComponent(
 			bus,
 			llzx80ula_observeRefresh,
 			csBus_resetCondition(LLZ80SignalRefresh, false), 
 			LLZ80SignalInterruptRequest,
 			machineState);
+		csComponent_setType(component, "ZX80/81 ULA: refresh");
 
-		csFlatBus_createComponent(
+		component = csFlatBus_createComponent(
 			bus,
 			llzx80ula_observeVideoRead,
 			csBus_testCondition(
@@ -435,42 +597,57 @@ LLZX8081MachineState *llzx8081_createMachineStateOnBus(void *bus, LLZX8081Machin
 				false),
 			CSBusStandardDataMask,
 			machineState);
+		csComponent_setType(component, "ZX80/81 ULA: video fetch");
 
-		csFlatBus_createComponent(
-			bus,
+		component = csFlatBus_createComponent(
+			ioBus,
 			llzx80ula_observeIORead,
 			csBus_resetCondition(LLZ80SignalInputOutputRequest | LLZ80SignalRead, false), 
 			CSBusStandardDataMask,
 			machineState);
+		csComponent_setType(component, "ZX80/81 ULA: IO read");
 
-		csFlatBus_createComponent(
-			bus,
+		component = csFlatBus_createComponent(
+			ioBus,
 			llzx80ula_observeIOWrite,
 			csBus_resetCondition(LLZ80SignalInputOutputRequest | LLZ80SignalWrite, true), 
 			0,
 			machineState);
+		csComponent_setType(component, "ZX80/81 ULA: IO write");
+
+		csFlatBus_createBridge(bus, ioBus, csBus_resetCondition(LLZ80SignalInputOutputRequest, false), CSBusStandardDataMask);
+		csObject_release(ioBus);
 
 		if(machineType == LLZX8081MachineTypeZX80)
 		{
 			// add M1 observer to get a ZX80
-			csFlatBus_createComponent(
+			component = csFlatBus_createComponent(
 				bus,
 				llzx80ula_observeMachineCycleOne,
 				csBus_resetCondition(LLZ80SignalMachineCycleOne, true), 
 				0,
 				machineState);
+			csComponent_setType(component, "ZX80 ULA: M1");
 		}
 		else
 		{
-			// add clock observer to get a ZX81
-			csFlatBus_createComponent(
+			// get a ZX81 by adding the hsync generator, and the wait
+			// generator that accompanies NMI
+			component = csFlatBus_createComponent(
 				bus,
-				llzx80ula_observeClock,
-				csBus_resetCondition(CSBusStandardClockLine, true), 
-				LLZ80SignalNonMaskableInterruptRequest | LLZ80SignalWait,
+				llzx81ula_observeNonMaskableInterrupt,
+				csBus_testCondition(LLZ80SignalNonMaskableInterruptRequest | LLZ80SignalHalt, LLZ80SignalHalt, false),
+				LLZ80SignalWait,
 				machineState);
+			csComponent_setType(component, "ZX81 ULA: NMI wait");
+
+			// NMI is driven from the hsync events rather than by a component,
+			// so tell the bus about it
+			csFlatBus_addEventOutputLines(bus, LLZ80SignalNonMaskableInterruptRequest);
+			llzx81ula_resetHSyncCounter(machineState);
 		}
 		machineState->machineType = machineType;
+		machineState->ramSize = ramSize;
 	}
 
 	return machineState;
@@ -36,12 +36,18 @@ typedef struct
 	uint8_t videoByteXorMask;
 	bool fetchVideoByte;
 
+	// the filter that substitutes the video fetch address
+	// in front of the ROM; it needs to be told whenever
+	// fetchVideoByte changes
+	void *romFilter;
+
 	// the current keyboard status; this is supplied by
 	// the machine specific stuff so we just cache it
 	uint8_t keyLines[8];
 
-	// the hsync counter is the 207-cycle counter on a
-	// ZX81 or the M1-clocked pulse counter on a ZX80
+	// the hsync counter is the M1-clocked pulse counter
+	// on a ZX80; the ZX81's 207-cycle counter is implied
+	// by the events scheduled on the bus
 	int hsyncCounter;
 
 	// we keep track of whether we're outputting
@@ -58,8 +64,15 @@ typedef struct
 	// and if it's a ZX81 we need to record whether NMIs
 	// are enabled
 	LLZX8081MachineType machineType;
+	LLZX8081RAMSize ramSize;
 	bool nmiIsEnabled;
 
+	// the CPU that's allowed fast execution, if any, and whether
+	// a video fetch or an interrupt has been seen since fast
+	// execution was last considered
+	void *fastExecutionCPU;
+	bool displayWasActive;
+
 } LLZX8081MachineState;
 
 LLZX8081MachineState *llzx8081_createMachineStateOnBus(
@@ -69,4 +82,10 @@ LLZX8081MachineState *llzx8081_createMachineStateOnBus(
 	void *CRT,
 	void *tapePlayer);
 
+// supplying a CPU maps memory into its fast mode, which is then enabled
+// whenever the display has been off for a whole frame — no video has been
+// fetched and, on a ZX81, the NMI generator has been off — and disabled as
+// soon as either changes; supply NULL to stop doing so. The CPU isn't retained
+void llzx8081_setFastExecutionCPU(LLZX8081MachineState *machineState, void *CPU);
+
 #endif
@@ -34,11 +34,11 @@ typedef struct
 
 	unsigned int currentPositionInLine;
 	unsigned int currentLine;
-	unsigned int currentTimeStamp;
+	uint64_t currentTimeStamp;
 
 	uint8_t currentLevel;
 
-	unsigned int lastSyncEventTime;
+	uint64_t lastSyncEventTime;
 	unsigned int syncChargeLevel;
 	bool syncActive;
 
@@ -221,10 +221,10 @@ static void llcrt_unsetSyncLevel(LLCRTState *crt)
 	crt->syncActive = false;
 }
 
-static void llcrt_runToTimeInternal(LLCRTState *crt, unsigned int timeStamp)
+static void llcrt_runToTimeInternal(LLCRTState *crt, uint64_t timeStamp)
 {
 	// work out how much time to run for
-	unsigned int timeToRunFor = timeStamp - crt->currentTimeStamp;
+	unsigned int timeToRunFor = (unsigned int)(timeStamp - crt->currentTimeStamp);
 
 	// decide whether to run to the end of this line
 	unsigned int timeToEndOfLine = crt->cyclesPerLine + kLLCRTLineSyncOverrun - crt->currentPositionInLine;
@@ -257,30 +257,30 @@ static void llcrt_runToTimeInternal(LLCRTState *crt, unsigned int timeStamp)
 	crt->currentTimeStamp = timeStamp;
 }
 
-void llcrt_runToTime(void *opaqueCrt, unsigned int timeStamp)
+void llcrt_runToTime(void *opaqueCrt, uint64_t timeStamp)
 {
 	LLCRTState *crt = (LLCRTState *)opaqueCrt;
 
-	// work out how much time to run for
-	unsigned int timeToRunFor = timeStamp - crt->currentTimeStamp;
-
-	// if time is seemingly negative, don't do anything
-	if(timeToRunFor > crt->cyclesPerLine * crt->linesPerField * 30)
+	// if time is negative, or implausibly far ahead, don't do anything
+	if(timeStamp < crt->currentTimeStamp || timeStamp - crt->currentTimeStamp > crt->cyclesPerLine * crt->linesPerField * 30)
 	{
 		return;
 	}
 
+	// work out how much time to run for
+	unsigned int timeToRunFor = (unsigned int)(timeStamp - crt->currentTimeStamp);
+
 	// check whether the vertical sync capacitor charged during
 	// this time window
 	if(crt->syncActive)
 	{
-		unsigned int baseTimeStamp = crt->currentTimeStamp;
+		uint64_t baseTimeStamp = crt->currentTimeStamp;
 		const unsigned int timeToChargeCapacitor = (crt->cyclesPerLine * 23) / 10;
 
 		while((crt->syncChargeLevel + timeToRunFor) >= timeToChargeCapacitor)
 		{
 			unsigned int timeUntilCharge = timeToChargeCapacitor - crt->syncChargeLevel;
-			unsigned int targetStamp = baseTimeStamp + timeUntilCharge;
+			uint64_t targetStamp = baseTimeStamp + timeUntilCharge;
 
 			llcrt_runToTimeInternal(crt, targetStamp);
 			llcrt_didDetectVSync(crt);
@@ -309,7 +309,7 @@ void llcrt_runToTime(void *opaqueCrt, unsigned int timeStamp)
 	llcrt_runToTimeInternal(crt, timeStamp);
 }
 
-void llcrt_setSyncLevel(void *opaqueCrt, unsigned int timeStamp)
+void llcrt_setSyncLevel(void *opaqueCrt, uint64_t timeStamp)
 {
 	LLCRTState *crt = (LLCRTState *)opaqueCrt;
 
@@ -330,7 +330,7 @@ void llcrt_setSyncLevel(void *opaqueCrt, unsigned int timeStamp)
 	crt->currentLevel = 0;
 }
 
-void llcrt_setLuminanceLevel(void *opaqueCrt, unsigned int timeStamp, uint8_t level)
+void llcrt_setLuminanceLevel(void *opaqueCrt, uint64_t timeStamp, uint8_t level)
 {
 	LLCRTState *crt = (LLCRTState *)opaqueCrt;
 
@@ -345,7 +345,7 @@ void llcrt_setLuminanceLevel(void *opaqueCrt, unsigned int timeStamp, uint8_t le
 	crt->currentLevel = level;
 }
 
-void llcrt_output1BitLuminanceByte(void *opaqueCrt, unsigned int timeStamp, uint8_t luminanceByte)
+void llcrt_output1BitLuminanceByte(void *opaqueCrt, uint64_t timeStamp, uint8_t luminanceByte)
 {
 	LLCRTState *crt = (LLCRTState *)opaqueCrt;
 
@@ -93,7 +93,7 @@ void llcrt_setEndOfFieldDelegate(void *crt, llcrt_endOfFieldDelegate delegate, v
 	CRT running.
 
 */
-void llcrt_runToTime(void *crt, unsigned int timeStamp);
+void llcrt_runToTime(void *crt, uint64_t timeStamp);
 
 /*
 
@@ -105,8 +105,8 @@ void llcrt_runToTime(void *crt, unsigned int timeStamp);
 	sync timings.
 
 */
-void llcrt_setLuminanceLevel(void *crt, unsigned int timeStamp, uint8_t level);
-void llcrt_setSyncLevel(void *crt, unsigned int timeStamp);
+void llcrt_setLuminanceLevel(void *crt, uint64_t timeStamp, uint8_t level);
+void llcrt_setSyncLevel(void *crt, uint64_t timeStamp);
 
 /*
 
@@ -124,7 +124,7 @@ void llcrt_setSyncLevel(void *crt, unsigned int timeStamp);
 	}
 
 */
-void llcrt_output1BitLuminanceByte(void *crt, unsigned int timeStamp, uint8_t luminanceByte);
+void llcrt_output1BitLuminanceByte(void *crt, uint64_t timeStamp, uint8_t luminanceByte);
 
 /*
 
@@ -23,7 +23,7 @@ typedef struct
 	void *audioCopyOfTape;
 
 	uint64_t tapeTime;
-	unsigned int currentTimeStamp;
+	uint64_t currentTimeStamp;
 	bool tapeIsRunning;
 
 	cstapePlayer_audioDelegate audioDelegate;
@@ -67,7 +67,7 @@ void *cstapePlayer_create(unsigned int sampleRate)
 	return player;
 }
 
-void cstapePlayer_setTape(void *opaquePlayer, void *tape, unsigned int timeStamp)
+void cstapePlayer_setTape(void *opaquePlayer, void *tape, uint64_t timeStamp)
 {
 	cstapePlayer_runToTime(opaquePlayer, timeStamp);
 
@@ -96,10 +96,10 @@ void *cstapePlayer_getTape(void *opaquePlayer)
 	return player->tape;
 }
 
-void cstapePlayer_runToTime(void *opaquePlayer, unsigned int timeStamp)
+void cstapePlayer_runToTime(void *opaquePlayer, uint64_t timeStamp)
 {
 	CSTapePlayer *player = (CSTapePlayer *)opaquePlayer;
-	unsigned int timeToRunFor = timeStamp - player->currentTimeStamp;
+	unsigned int timeToRunFor = (unsigned int)(timeStamp - player->currentTimeStamp);
 
 	if(player->audioDelegate && player->tape)
 	{
@@ -190,31 +190,31 @@ void cstapePlayer_runToTime(void *opaquePlayer, unsigned int timeStamp)
 	player->currentTimeStamp = timeStamp;
 }
 
-void cstapePlayer_setTapeTime(void *player, unsigned int timeStamp, uint64_t tapeTime)
+void cstapePlayer_setTapeTime(void *player, uint64_t timeStamp, uint64_t tapeTime)
 {
 	cstapePlayer_runToTime(player, timeStamp);
 	((CSTapePlayer *)player)->tapeTime = tapeTime;
 }
 
-uint64_t cstapePlayer_getTapeTime(void *player, unsigned int timeStamp)
+uint64_t cstapePlayer_getTapeTime(void *player, uint64_t timeStamp)
 {
 	cstapePlayer_runToTime(player, timeStamp);
 	return ((CSTapePlayer *)player)->tapeTime;
 }
 
-void cstapePlayer_play(void *player, unsigned int timeStamp)
+void cstapePlayer_play(void *player, uint64_t timeStamp)
 {
 	cstapePlayer_runToTime(player, timeStamp);
 	((CSTapePlayer *)player)->tapeIsRunning = true;
 }
 
-void cstapePlayer_pause(void *player, unsigned int timeStamp)
+void cstapePlayer_pause(void *player, uint64_t timeStamp)
 {
 	cstapePlayer_runToTime(player, timeStamp);
 	((CSTapePlayer *)player)->tapeIsRunning = false;
 }
 
-void cstapePlayer_rewindToStart(void *player, unsigned int timeStamp)
+void cstapePlayer_rewindToStart(void *player, uint64_t timeStamp)
 {
 	cstapePlayer_runToTime(player, timeStamp);
 	((CSTapePlayer *)player)->tapeTime = 0;
@@ -26,7 +26,7 @@ void *cstapePlayer_create(unsigned int sampleRate);
 	in this tape player.
 
 */
-void cstapePlayer_setTape(void *player, void *tape, unsigned int timeStamp);
+void cstapePlayer_setTape(void *player, void *tape, uint64_t timeStamp);
 void *cstapePlayer_getTape(void *player);
 
 /*
@@ -38,8 +38,8 @@ void *cstapePlayer_getTape(void *player);
 	tape for a waveform.
 
 */
-uint64_t cstapePlayer_getTapeTime(void *player, unsigned int timeStamp);
-void cstapePlayer_setTapeTime(void *player, unsigned int timeStamp, uint64_t tapeTime);
+uint64_t cstapePlayer_getTapeTime(void *player, uint64_t timeStamp);
+void cstapePlayer_setTapeTime(void *player, uint64_t timeStamp, uint64_t tapeTime);
 
 /*
 
@@ -47,12 +47,12 @@ void cstapePlayer_setTapeTime(void *player, unsigned int timeStamp, uint64_t tap
 	a pause button and a rewind-to-start button.
 
 */
-void cstapePlayer_play(void *player, unsigned int timeStamp);
-void cstapePlayer_pause(void *player, unsigned int timeStamp);
+void cstapePlayer_play(void *player, uint64_t timeStamp);
+void cstapePlayer_pause(void *player, uint64_t timeStamp);
 bool cstapePlayer_isTapePlaying(void *player);
-void cstapePlayer_rewindToStart(void *player, unsigned int timeStamp);
+void cstapePlayer_rewindToStart(void *player, uint64_t timeStamp);
 
-void cstapePlayer_runToTime(void *player, unsigned int timeStamp);
+void cstapePlayer_runToTime(void *player, uint64_t timeStamp);
 
 /*
 
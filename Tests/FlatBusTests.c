@@ -0,0 +1,140 @@
+//
+//  FlatBusTests.c
+//  Clock Signal
+//
+//  Created by Thomas Harte on 14/12/2011.
+//  Copyright 2011 Thomas Harte. All rights reserved.
+//
+
+/*
+
+	Checks of the flat bus that can be made without a machine
+	around it. Each sets up a small bus, runs it and compares
+	what its components saw against what they should have;
+	the exit status is non-zero if any check fails.
+
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+
+#include "ReferenceCountedObject.h"
+#include "BusState.h"
+#include "StandardBusLines.h"
+#include "Component.h"
+#include "FlatBus.h"
+
+#define kFlatBusTestsFilteredLine	(1llu << CSBusStandardAddressShift)
+
+typedef struct
+{
+	CSReferenceCountedObject referenceCountedObject;
+	unsigned int numberOfMessages;
+} FlatBusTestsCounter;
+
+static FlatBusTestsCounter *flatbustests_createCounter(void)
+{
+	FlatBusTestsCounter *counter = (FlatBusTestsCounter *)calloc(1, sizeof(FlatBusTestsCounter));
+	if(counter) csObject_init(counter);
+	return counter;
+}
+
+static void flatbustests_count(
+	void *const restrict context,
+	CSBusState *const restrict internalState,
+	const CSBusState externalState,
+	const bool conditionIsTrue,
+	const CSComponentNanoseconds timeSinceLaunch)
+{
+	((FlatBusTestsCounter *)context)->numberOfMessages++;
+}
+
+// a clocked component that never does anything but count, so
+// that the bus is free to skip as far ahead as it likes
+static unsigned int flatbustests_neverBusy(void *const restrict context, const CSBusState internalState, const CSBusState externalState)
+{
+	return UINT_MAX;
+}
+
+static void flatbustests_advance(void *const restrict context, const CSBusState externalState, const unsigned int halfCycles)
+{
+}
+
+// the filter holds its line low, which the bus otherwise never does
+static CSBusState flatbustests_holdLineLow(void *context, CSBusState busState)
+{
+	busState.lineValues &= ~kFlatBusTestsFilteredLine;
+	return busState;
+}
+
+static bool flatbustests_never(void *context)
+{
+	return false;
+}
+
+// a component that views the bus through a filter and is messaged on each
+// rising clock edge should be, whether or not the bus is able to skip ahead;
+// a stop predicate prevents the bus from doing so, so that gives the reference
+static unsigned int flatbustests_countFilteredClockEdges(unsigned int halfCycles, bool mayBulkAdvance)
+{
+	void *const bus = csFlatBus_create();
+	FlatBusTestsCounter *const ticker = flatbustests_createCounter();
+	FlatBusTestsCounter *const observer = flatbustests_createCounter();
+
+	void *const tickerComponent = csFlatBus_createComponent(
+		bus,
+		flatbustests_count,
+		csBus_maskCondition(CSBusStandardClockLine, 0, 0, false),
+		0,
+		ticker);
+	csComponent_setQuiescenceFunctions(tickerComponent, flatbustests_neverBusy, flatbustests_advance);
+
+	void *const filter = csFlatBus_createFilter(bus, flatbustests_holdLineLow, kFlatBusTestsFilteredLine, NULL);
+	csFlatBus_setModalComponentFilter(bus, filter);
+	csFlatBus_createComponent(
+		bus,
+		flatbustests_count,
+		csBus_testCondition(CSBusStandardClockLine | kFlatBusTestsFilteredLine, CSBusStandardClockLine, true),
+		0,
+		observer);
+	csFlatBus_setModalComponentFilter(bus, NULL);
+	csFlatBus_freeze(bus);
+
+	if(mayBulkAdvance)
+		csFlatBus_runForHalfCycles(bus, halfCycles);
+	else
+		csFlatBus_runUntilPredicate(bus, halfCycles, flatbustests_never, NULL);
+
+	const unsigned int numberOfMessages = observer->numberOfMessages;
+	csObject_release(ticker);
+	csObject_release(observer);
+	csObject_release(bus);
+	return numberOfMessages;
+}
+
+static bool flatbustests_testBulkAdvanceWithFilteredClockObserver(void)
+{
+	const unsigned int halfCycles = 1000;
+	const unsigned int expectedMessages = flatbustests_countFilteredClockEdges(halfCycles, false);
+	const unsigned int messages = flatbustests_countFilteredClockEdges(halfCycles, true);
+
+	if(expectedMessages != halfCycles / 2 || messages != expectedMessages)
+	{
+		printf("bulk advance with a filtered clock observer: %u messages, expected %u\n", messages, halfCycles / 2);
+		return false;
+	}
+
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	bool allPassed = true;
+
+	allPassed &= flatbustests_testBulkAdvanceWithFilteredClockObserver();
+
+	return allPassed ? 0 : 1;
+}
@@ -0,0 +1,401 @@
+//
+//  Z80Exerciser.c
+//  Clock Signal
+//
+//  Created by Thomas Harte on 14/12/2011.
+//  Copyright 2011 Thomas Harte. All rights reserved.
+//
+
+/*
+
+	A command-line harness for CP/M instruction exercisers,
+	such as ZEXDOC and ZEXALL, that puts a Z80 on a bus with
+	64kb of static RAM and nothing else.
+
+	Programs are loaded at 0x100 and run from there, per CP/M.
+	BDOS calls to output a character or a string are trapped
+	at 0x0005 and the output is collected; a jump to 0x0000,
+	CP/M's warm boot, ends the program.
+
+	Each line of output that ends in OK or that includes
+	ERROR is taken to be the result of a test group, named
+	by whatever precedes the run of dots that exercisers put
+	between the name and the result.
+
+	Usage:
+
+		z80exerciser [--json] [--fast] [--max-half-cycles n] program.com ...
+
+	--json replaces the program output and summary with a
+	JSON array that has an object per program; --fast runs
+	the Z80 in fast mode; --max-half-cycles stops any program
+	that hasn't finished after that many half cycles. The
+	exit status is 0 only if every program finished with
+	no failures.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "ReferenceCountedObject.h"
+#include "BusState.h"
+#include "FlatBus.h"
+#include "StaticMemory.h"
+#include "Z80.h"
+
+#define kZ80ExerciserLoadAddress		0x0100
+#define kZ80ExerciserBDOSAddress		0x0005
+#define kZ80ExerciserBDOSReturnAddress	0xfe00
+
+// programs are run in chunks of this many half cycles,
+// checking for completion in between
+#define kZ80ExerciserHalfCyclesPerRun	(1 << 20)
+
+typedef struct
+{
+	char *name;
+	bool passed;
+} Z80ExerciserGroup;
+
+typedef struct
+{
+	void *bus, *z80, *memory;
+	uint8_t *storage;
+	bool echoesOutput;
+
+	// output is collected a line at a time and considered
+	// for a test result at the end of each
+	char *line;
+	size_t lineLength, lineCapacity;
+
+	Z80ExerciserGroup *groups;
+	unsigned int numberOfGroups, numberOfPassedGroups;
+
+	bool hasFinished;
+} Z80ExerciserState;
+
+static double z80exerciser_getHostTime(void)
+{
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (double)time.tv_sec + (double)time.tv_nsec / 1e9;
+}
+
+static void z80exerciser_endLine(Z80ExerciserState *state)
+{
+	state->line[state->lineLength] = '\0';
+
+	// exercisers end each group with 'OK' or a message
+	// that includes 'ERROR'; anything else is commentary
+	char *const end = state->line + state->lineLength;
+	char *trimmedEnd = end;
+	while(trimmedEnd > state->line && (trimmedEnd[-1] == ' ' || trimmedEnd[-1] == '\r')) trimmedEnd--;
+
+	bool passed = (trimmedEnd - state->line >= 2) && !strncmp(trimmedEnd - 2, "OK", 2);
+	bool failed = !!strstr(state->line, "ERROR");
+
+	if(passed || failed)
+	{
+		// the name is whatever comes before the dots,
+		// or before the result if there aren't any
+		char *nameEnd = strstr(state->line, "..");
+		if(!nameEnd) nameEnd = failed ? strstr(state->line, "ERROR") : trimmedEnd - 2;
+		while(nameEnd > state->line && nameEnd[-1] == ' ') nameEnd--;
+
+		Z80ExerciserGroup *groups = realloc(state->groups, sizeof(Z80ExerciserGroup) * (state->numberOfGroups + 1));
+		if(groups)
+		{
+			state->groups = groups;
+			state->groups[state->numberOfGroups].name = strndup(state->line, (size_t)(nameEnd - state->line));
+			state->groups[state->numberOfGroups].passed = !failed;
+			state->numberOfGroups++;
+			if(!failed) state->numberOfPassedGroups++;
+		}
+	}
+
+	state->lineLength = 0;
+}
+
+static void z80exerciser_outputCharacter(Z80ExerciserState *state, uint8_t character)
+{
+	if(state->echoesOutput)
+	{
+		putchar(character);
+		if(character == '\n') fflush(stdout);
+	}
+
+	if(character == '\n')
+	{
+		z80exerciser_endLine(state);
+		return;
+	}
+
+	if(state->lineLength + 1 >= state->lineCapacity)
+	{
+		size_t newCapacity = state->lineCapacity ? state->lineCapacity * 2 : 256;
+		char *newLine = realloc(state->line, newCapacity);
+		if(!newLine) return;
+
+		state->line = newLine;
+		state->lineCapacity = newCapacity;
+	}
+	state->line[state->lineLength++] = (char)character;
+}
+
+// BDOS is entered with the function number in C; 2 outputs the
+// character in E and 9 the string at DE, which is terminated by
+// a '$'. Anything else is ignored. The call then continues to the
+// RET that the jump at 0x0005 leads to
+static void z80exerciser_trapBDOS(void *z80, void *context)
+{
+	Z80ExerciserState *state = (Z80ExerciserState *)context;
+
+	switch(llz80_monitor_getInternalValue(z80, LLZ80MonitorValueCRegister))
+	{
+		default: break;
+
+		case 2:
+			z80exerciser_outputCharacter(state, (uint8_t)llz80_monitor_getInternalValue(z80, LLZ80MonitorValueERegister));
+		break;
+
+		case 9:
+		{
+			uint16_t address = (uint16_t)llz80_monitor_getInternalValue(z80, LLZ80MonitorValueDERegister);
+			for(unsigned int count = 0; count < 65536 && state->storage[address] != '$'; count++)
+			{
+				z80exerciser_outputCharacter(state, state->storage[address]);
+				address++;
+			}
+		}
+		break;
+	}
+}
+
+static void z80exerciser_trapWarmBoot(void *z80, void *context)
+{
+	Z80ExerciserState *state = (Z80ExerciserState *)context;
+
+	// the processor then halts, which stops the bus
+	state->hasFinished = true;
+}
+
+static bool z80exerciser_createMachine(Z80ExerciserState *state, const uint8_t *program, size_t length, bool fastModeIsEnabled)
+{
+	state->bus = csFlatBus_create();
+	if(!state->bus) return false;
+
+	state->z80 = llz80_createOnBus(state->bus);
+	state->memory = csStaticMemory_createOnBus(
+		state->bus,
+		65536,
+		csBus_testCondition(LLZ80SignalMemoryRequest | LLZ80SignalWrite, LLZ80SignalWrite, false),
+		csBus_testCondition(LLZ80SignalMemoryRequest | LLZ80SignalWrite, 0, false));
+	if(!state->z80 || !state->memory) return false;
+
+	csFlatBus_freeze(state->bus);
+
+	// a HALT at the warm boot address, so that the processor stops there,
+	// a jump to a RET for BDOS calls — which also provides the top of
+	// memory at 0x0006, for the stack — and the program at 0x100
+	state->storage = csStaticMemory_getStorage(state->memory);
+	memset(state->storage, 0, 65536);
+	state->storage[0x0000] = 0x76;
+	state->storage[kZ80ExerciserBDOSAddress + 0] = 0xc3;
+	state->storage[kZ80ExerciserBDOSAddress + 1] = kZ80ExerciserBDOSReturnAddress & 0xff;
+	state->storage[kZ80ExerciserBDOSAddress + 2] = kZ80ExerciserBDOSReturnAddress >> 8;
+	state->storage[kZ80ExerciserBDOSReturnAddress] = 0xc9;
+	memcpy(&state->storage[kZ80ExerciserLoadAddress], program, length);
+
+	llz80_monitor_addTrap(state->z80, kZ80ExerciserBDOSAddress, z80exerciser_trapBDOS, state);
+	llz80_monitor_addTrap(state->z80, 0x0000, z80exerciser_trapWarmBoot, state);
+
+	// start at the program, with a return address of 0x0000 on the stack
+	llz80_monitor_setInternalValue(state->z80, LLZ80MonitorValuePCRegister, kZ80ExerciserLoadAddress);
+	llz80_monitor_setInternalValue(state->z80, LLZ80MonitorValueSPRegister, kZ80ExerciserBDOSReturnAddress - 2);
+
+	if(fastModeIsEnabled)
+	{
+		for(unsigned int address = 0; address < 65536; address += kLLZ80FastModePageSize)
+			llz80_fast_setMemoryPage(state->z80, (uint16_t)address, &state->storage[address], &state->storage[address], true);
+		llz80_fast_setIsEnabled(state->z80, true);
+	}
+
+	return true;
+}
+
+static void z80exerciser_destroyMachine(Z80ExerciserState *state)
+{
+	csObject_release(state->memory);
+	csObject_release(state->z80);
+	csObject_release(state->bus);
+
+	for(unsigned int group = 0; group < state->numberOfGroups; group++)
+		free(state->groups[group].name);
+	free(state->groups);
+	free(state->line);
+}
+
+static uint8_t *z80exerciser_readProgram(const char *path, size_t *length)
+{
+	FILE *file = fopen(path, "rb");
+	if(!file) return NULL;
+
+	// a program can occupy everything from the load address
+	// up to the BDOS return
+	const size_t maximumLength = kZ80ExerciserBDOSReturnAddress - kZ80ExerciserLoadAddress;
+	uint8_t *program = malloc(maximumLength + 1);
+	if(program)
+	{
+		*length = fread(program, 1, maximumLength + 1, file);
+		if(!*length || *length > maximumLength)
+		{
+			free(program);
+			program = NULL;
+		}
+	}
+
+	fclose(file);
+	return program;
+}
+
+static void z80exerciser_printJSONString(const char *string)
+{
+	putchar('"');
+	for(; *string; string++)
+	{
+		const unsigned char character = (unsigned char)*string;
+		if(character == '"' || character == '\\')
+			printf("\\%c", character);
+		else if(character < 0x20 || character >= 0x7f)
+			printf("\\u%04x", character);
+		else
+			putchar(character);
+	}
+	putchar('"');
+}
+
+int main(int argc, char *argv[])
+{
+	bool outputsJSON = false, fastModeIsEnabled = false;
+	uint64_t maximumHalfCycles = 0;
+	int firstProgram = 1;
+
+	for(; firstProgram < argc && !strncmp(argv[firstProgram], "--", 2); firstProgram++)
+	{
+		if(!strcmp(argv[firstProgram], "--json")) outputsJSON = true;
+		else if(!strcmp(argv[firstProgram], "--fast")) fastModeIsEnabled = true;
+		else if(!strcmp(argv[firstProgram], "--max-half-cycles") && firstProgram+1 < argc)
+			maximumHalfCycles = strtoull(argv[++firstProgram], NULL, 10);
+		else
+		{
+			firstProgram = argc;
+			break;
+		}
+	}
+
+	if(firstProgram >= argc)
+	{
+		fprintf(stderr, "usage: %s [--json] [--fast] [--max-half-cycles n] program.com ...\n", argv[0]);
+		return 2;
+	}
+
+	bool allPassed = true, isFirstResult = true;
+	if(outputsJSON) printf("[\n");
+
+	for(int argument = firstProgram; argument < argc; argument++)
+	{
+		const char *const path = argv[argument];
+
+		size_t length;
+		uint8_t *program = z80exerciser_readProgram(path, &length);
+		if(!program)
+		{
+			fprintf(stderr, "%s: couldn't load a program from %s\n", argv[0], path);
+			allPassed = false;
+			continue;
+		}
+
+		Z80ExerciserState state = {.echoesOutput = !outputsJSON};
+		if(!z80exerciser_createMachine(&state, program, length, fastModeIsEnabled))
+		{
+			fprintf(stderr, "%s: couldn't create a machine to run %s\n", argv[0], path);
+			z80exerciser_destroyMachine(&state);
+			free(program);
+			return 2;
+		}
+		free(program);
+
+		// run until the program finishes or the limit is reached; each run
+		// stops as soon as the processor halts, so that the host time and the
+		// half cycles counted cover the same period
+		const CSBusCondition haltCondition = csBus_maskCondition(LLZ80SignalHalt, LLZ80SignalHalt, 0, false);
+		const double startTime = z80exerciser_getHostTime();
+		while(!state.hasFinished)
+		{
+			unsigned int halfCycles = kZ80ExerciserHalfCyclesPerRun;
+			if(maximumHalfCycles)
+			{
+				const uint64_t halfCyclesToDate = csFlatBus_getHalfCyclesToDate(state.bus);
+				if(halfCyclesToDate >= maximumHalfCycles) break;
+				if(maximumHalfCycles - halfCyclesToDate < halfCycles) halfCycles = (unsigned int)(maximumHalfCycles - halfCyclesToDate);
+			}
+
+			csFlatBus_runUntil(state.bus, halfCycles, haltCondition);
+		}
+		const double hostSeconds = z80exerciser_getHostTime() - startTime;
+
+		// a partial line may still hold a result
+		if(state.lineLength) z80exerciser_endLine(&state);
+
+		const uint64_t halfCyclesRun = csFlatBus_getHalfCyclesToDate(state.bus);
+		const double halfCyclesPerSecond = hostSeconds > 0.0 ? (double)halfCyclesRun / hostSeconds : 0.0;
+		const unsigned int numberOfFailedGroups = state.numberOfGroups - state.numberOfPassedGroups;
+		if(!state.hasFinished || numberOfFailedGroups) allPassed = false;
+
+		if(outputsJSON)
+		{
+			printf("%s\t{\n\t\t\"program\": ", isFirstResult ? "" : ",\n");
+			z80exerciser_printJSONString(path);
+			printf(",\n");
+			printf("\t\t\"finished\": %s,\n", state.hasFinished ? "true" : "false");
+			printf("\t\t\"fast_mode\": %s,\n", fastModeIsEnabled ? "true" : "false");
+			printf("\t\t\"half_cycles\": %llu,\n", (unsigned long long)halfCyclesRun);
+			printf("\t\t\"host_seconds\": %.6f,\n", hostSeconds);
+			printf("\t\t\"half_cycles_per_second\": %.0f,\n", halfCyclesPerSecond);
+			printf("\t\t\"emulated_mhz\": %.3f,\n", halfCyclesPerSecond / 2e6);
+			printf("\t\t\"passed\": %u,\n", state.numberOfPassedGroups);
+			printf("\t\t\"failed\": %u,\n", numberOfFailedGroups);
+			printf("\t\t\"groups\": [");
+			for(unsigned int group = 0; group < state.numberOfGroups; group++)
+			{
+				printf("%s\n\t\t\t{\"name\": ", group ? "," : "");
+				z80exerciser_printJSONString(state.groups[group].name);
+				printf(", \"passed\": %s}", state.groups[group].passed ? "true" : "false");
+			}
+			printf("%s]\n", state.numberOfGroups ? "\n\t\t" : "");
+			printf("\t}");
+			isFirstResult = false;
+		}
+		else
+		{
+			printf("\n%s: %s; %u groups passed, %u failed\n", path, state.hasFinished ? "finished" : "stopped before finishing", state.numberOfPassedGroups, numberOfFailedGroups);
+			for(unsigned int group = 0; group < state.numberOfGroups; group++)
+			{
+				if(!state.groups[group].passed)
+					printf("\tfailed: %s\n", state.groups[group].name);
+			}
+			printf("%llu half cycles in %.3f seconds: %.0f half cycles per second, equivalent to %.3f MHz\n",
+				(unsigned long long)halfCyclesRun, hostSeconds, halfCyclesPerSecond, halfCyclesPerSecond / 2e6);
+		}
+
+		z80exerciser_destroyMachine(&state);
+	}
+
+	if(outputsJSON) printf("%s]\n", isFirstResult ? "" : "\n");
+	return allPassed ? 0 : 1;
+}
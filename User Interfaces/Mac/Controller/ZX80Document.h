@@ -12,6 +12,10 @@
 #define kZX80DocumentAudioStreamLength	1024
 #define kZX80DocumentAudioBufferLength	256
 
+// the debugger gives up on a step after a second of machine time; that's
+// 3.25 million cycles, or twice as many half cycles
+#define kZX80DocumentDebuggerHalfCycleLimit	6500000
+
 @interface ZX80Document : NSDocument 
 
 @end
@@ -57,10 +57,6 @@ typedef enum
 	short _audioStream[kZX80DocumentAudioStreamLength];
 	BOOL _isOutputtingAudio;
 
-	int _instructionRunningCount;
-	BOOL _atBreakpoint;
-	uint16_t _targetAddress;
-
 	float _speedMultiplier;
 	GLuint _textureID;
 
@@ -315,17 +311,6 @@ static CVReturn displayLinkCalback(
 #pragma mark -
 #pragma mark Z80 instruction observer
 
-- (void)z80WillFetchInstruction
-{
-	_instructionRunningCount--;
-	_atBreakpoint = (llz80_monitor_getInternalValue(llzx8081_getCPU(_ULA), LLZ80MonitorValuePCRegister) == _targetAddress);
-}
-
-static void ZX80DocumentInstructionObserverBreakIn(void *z80, void *context)
-{
-	[(__bridge ZX80Document *)context z80WillFetchInstruction];
-}
-
 /*static void llzx8081_Z80WillFetchNewInstruction(void *z80, void *context)
 {
 	LLZX80ULAState *ula = (LLZX80ULAState *)context;
@@ -367,15 +352,10 @@ static void ZX80DocumentInstructionObserverBreakIn(void *z80, void *context)
 	[self stopRunning];
 
 	[debugInterface addComment:@"----"];
-	_instructionRunningCount = 1;
 
-	void *instructionObserver = llz80_monitor_addInstructionObserver([self z80ForDebugInterface:debugInterface], ZX80DocumentInstructionObserverBreakIn, (__bridge void *)(self));
-	while(_instructionRunningCount)
-	{
-		llzx8081_runForHalfCycles(_ULA, 1);
-		[debugInterface updateBus];
-	}
-	llz80_monitor_removeInstructionObserver([self z80ForDebugInterface:debugInterface], instructionObserver);
+	// the step runs in one go, so the bus view isn't updated at each half
+	// cycle along the way; it gets only the final state, via refresh
+	llzx8081_runForInstructions(_ULA, 1, kZX80DocumentDebuggerHalfCycleLimit);
 
 	[debugInterface refresh];
 }
@@ -385,18 +365,9 @@ static void ZX80DocumentInstructionObserverBreakIn(void *z80, void *context)
 	[self stopRunning];
 
 	[debugInterface addComment:@"----"];
-	
-	_targetAddress = address;
-	_atBreakpoint = NO;
 
-	int maxCycles = 3250000;
-	void *instructionObserver = llz80_monitor_addInstructionObserver([self z80ForDebugInterface:debugInterface], ZX80DocumentInstructionObserverBreakIn, (__bridge void *)(self));
-	while(!_atBreakpoint && maxCycles--)
-	{
-		llzx8081_runForHalfCycles(_ULA, 1);
-		[debugInterface updateBus];
-	}
-	llz80_monitor_removeInstructionObserver([self z80ForDebugInterface:debugInterface], instructionObserver);
+	// as above, the bus view shows only where the run ended
+	llzx8081_runUntilAddress(_ULA, address, kZX80DocumentDebuggerHalfCycleLimit);
 
 	[debugInterface refresh];
 }
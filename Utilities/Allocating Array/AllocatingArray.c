@@ -67,8 +67,7 @@ void *csAllocatingArray_newObject(void *opaqueArray)
 
 		if(!newBuffer) return NULL;
 
-		uint32_t zero = 0;
-		memset_pattern4(&newBuffer[array->numberOfAllocatedObjects * array->objectSize], &zero, (newNumberOfAllocatedObjects - array->numberOfAllocatedObjects) * array->objectSize);
+		memset(&newBuffer[array->numberOfAllocatedObjects * array->objectSize], 0, (newNumberOfAllocatedObjects - array->numberOfAllocatedObjects) * array->objectSize);
 
 		array->objects = newBuffer;
 		array->numberOfAllocatedObjects = newNumberOfAllocatedObjects;
@@ -0,0 +1,279 @@
+//
+//  BusTraceConverter.c
+//  Clock Signal
+//
+//  Created by Thomas Harte on 03/12/2011.
+//  Copyright 2011 Thomas Harte. All rights reserved.
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "BusTraceConverter.h"
+#include "BusTraceRecorder.h"
+#include "StandardBusLines.h"
+#include "Z80.h"
+
+// each named signal occupies a contiguous run of lines
+typedef struct
+{
+	uint64_t mask;
+	const char *name;
+} CSBusTraceSignal;
+
+static const CSBusTraceSignal csBusTrace_namedSignals[] =
+{
+	{CSBusStandardDataMask,					"D"},
+	{CSBusStandardAddressMask,				"A"},
+	{LLZ80SignalInputOutputRequest,			"IORQ"},
+	{LLZ80SignalMachineCycleOne,			"M1"},
+	{LLZ80SignalRead,						"RD"},
+	{LLZ80SignalWrite,						"WR"},
+	{LLZ80SignalMemoryRequest,				"MREQ"},
+	{LLZ80SignalRefresh,					"RFSH"},
+	{LLZ80SignalBusAcknowledge,				"BUSAK"},
+	{LLZ80SignalHalt,						"HALT"},
+	{LLZ80SignalInterruptRequest,			"INT"},
+	{LLZ80SignalNonMaskableInterruptRequest,	"NMI"},
+	{LLZ80SignalReset,						"RESET"},
+	{LLZ80SignalWait,						"WAIT"},
+	{LLZ80SignalBusRequest,					"BUSRQ"},
+};
+
+#define kCSBusTraceNumberOfNamedSignals	(sizeof(csBusTrace_namedSignals) / sizeof(csBusTrace_namedSignals[0]))
+
+// the named signals, any unnamed lines that change and the clock
+#define kCSBusTraceMaximumNumberOfSignals	(kCSBusTraceNumberOfNamedSignals + 64)
+
+typedef struct
+{
+	const uint8_t *cursor, *end;
+	uint64_t halfCycle, lineValues;
+} CSBusTraceReader;
+
+static bool csBusTrace_readRecord(CSBusTraceReader *const reader)
+{
+	// read the time delta; a truncated record is treated as the end of the trace
+	uint64_t halfCycles = 0;
+	int shift = 0;
+	while(1)
+	{
+		if(reader->cursor == reader->end || shift > 63) return false;
+		const uint8_t byte = *reader->cursor++;
+		halfCycles |= (uint64_t)(byte & 0x7f) << shift;
+		if(!(byte & 0x80)) break;
+		shift += 7;
+	}
+
+	// then the changes
+	if(reader->cursor == reader->end) return false;
+	const uint8_t changedBytes = *reader->cursor++;
+	uint64_t changedLines = 0;
+	for(int byte = 0; byte < 8; byte++)
+	{
+		if(changedBytes & (1 << byte))
+		{
+			if(reader->cursor == reader->end) return false;
+			changedLines |= (uint64_t)(*reader->cursor++) << (byte << 3);
+		}
+	}
+
+	reader->halfCycle += halfCycles;
+	reader->lineValues ^= changedLines;
+	return true;
+}
+
+static void csBusTrace_resetReader(CSBusTraceReader *const reader, const uint8_t *trace, size_t length)
+{
+	reader->cursor = trace + kCSBusTraceHeaderLength;
+	reader->end = trace + length;
+	reader->halfCycle = 0;
+	reader->lineValues = ~CSBusStandardClockLine;
+}
+
+// VCD identifiers are short strings of printable characters
+static void csBusTrace_getIdentifier(char *identifier, unsigned int index)
+{
+	do
+	{
+		*identifier++ = (char)('!' + (index % 94));
+		index /= 94;
+	}
+	while(index);
+	*identifier = '\0';
+}
+
+static void csBusTrace_writeValue(FILE *const vcd, const CSBusTraceSignal *const signal, const char *identifier, const uint64_t lineValues)
+{
+	const int lowestLine = __builtin_ctzll(signal->mask);
+	const int highestLine = 63 - __builtin_clzll(signal->mask);
+
+	if(lowestLine == highestLine)
+	{
+		fprintf(vcd, "%c%s\n", (lineValues & signal->mask) ? '1' : '0', identifier);
+		return;
+	}
+
+	fputc('b', vcd);
+	for(int line = highestLine; line >= lowestLine; line--)
+		fputc(((lineValues >> line)&1) ? '1' : '0', vcd);
+	fprintf(vcd, " %s\n", identifier);
+}
+
+// if the bus's rate is known then times are given in picoseconds; otherwise
+// each half cycle is given a nominal nanosecond
+static uint64_t csBusTrace_getTime(const uint64_t halfCycle, const uint32_t ticksPerSecond)
+{
+	if(!ticksPerSecond) return halfCycle;
+	return (uint64_t)(((long double)halfCycle * 500000000000.0L) / (long double)ticksPerSecond);
+}
+
+static bool csBusTrace_writeVCD(FILE *const vcd, const uint8_t *const trace, const size_t length)
+{
+	const uint8_t clockPhase = trace[5];
+	const uint32_t ticksPerSecond =
+		(uint32_t)trace[8] | ((uint32_t)trace[9] << 8) | ((uint32_t)trace[10] << 16) | ((uint32_t)trace[11] << 24);
+
+	// run through the trace once to find out which lines change
+	CSBusTraceReader reader;
+	uint64_t changedLines = 0;
+	csBusTrace_resetReader(&reader, trace, length);
+	while(1)
+	{
+		const uint64_t lastLineValues = reader.lineValues;
+		if(!csBusTrace_readRecord(&reader)) break;
+		changedLines |= reader.lineValues ^ lastLineValues;
+	}
+
+	// build the list of signals: everything named, plus any unnamed line that changes
+	CSBusTraceSignal signals[kCSBusTraceMaximumNumberOfSignals];
+	char names[64][8];
+	unsigned int numberOfSignals = 0;
+	uint64_t namedLines = CSBusStandardClockLine;
+
+	for(unsigned int index = 0; index < kCSBusTraceNumberOfNamedSignals; index++)
+	{
+		signals[numberOfSignals++] = csBusTrace_namedSignals[index];
+		namedLines |= csBusTrace_namedSignals[index].mask;
+	}
+
+	for(int line = 0; line < 64; line++)
+	{
+		const uint64_t mask = 1llu << line;
+		if((changedLines & mask) && !(namedLines & mask))
+		{
+			snprintf(names[line], sizeof(names[line]), "L%d", line);
+			signals[numberOfSignals].mask = mask;
+			signals[numberOfSignals].name = names[line];
+			numberOfSignals++;
+		}
+	}
+
+	// the clock comes last
+	const CSBusTraceSignal clock = {CSBusStandardClockLine, "CLK"};
+	char clockIdentifier[4];
+	csBusTrace_getIdentifier(clockIdentifier, numberOfSignals);
+
+	// write the header
+	fprintf(vcd, "$version Clock Signal bus trace $end\n");
+	fprintf(vcd, "$timescale %s $end\n", ticksPerSecond ? "1 ps" : "1 ns");
+	fprintf(vcd, "$scope module bus $end\n");
+	for(unsigned int index = 0; index < numberOfSignals; index++)
+	{
+		char identifier[4];
+		csBusTrace_getIdentifier(identifier, index);
+
+		const int lowestLine = __builtin_ctzll(signals[index].mask);
+		const int highestLine = 63 - __builtin_clzll(signals[index].mask);
+		if(lowestLine == highestLine)
+			fprintf(vcd, "$var wire 1 %s %s $end\n", identifier, signals[index].name);
+		else
+			fprintf(vcd, "$var wire %d %s %s [%d:0] $end\n", highestLine - lowestLine + 1, identifier, signals[index].name, highestLine - lowestLine);
+	}
+	fprintf(vcd, "$var wire 1 %s %s $end\n", clockIdentifier, clock.name);
+	fprintf(vcd, "$upscope $end\n");
+	fprintf(vcd, "$enddefinitions $end\n");
+
+	if(clockPhase == kCSBusTraceClockPhaseUnknown) return !ferror(vcd);
+
+	// then the values; the first record supplies the initial values of everything,
+	// after which the clock is toggled every half cycle and other signals are
+	// output only when they change
+	csBusTrace_resetReader(&reader, trace, length);
+	if(!csBusTrace_readRecord(&reader)) return !ferror(vcd);
+
+	fprintf(vcd, "#%llu\n$dumpvars\n", (unsigned long long)csBusTrace_getTime(reader.halfCycle, ticksPerSecond));
+	for(unsigned int index = 0; index < numberOfSignals; index++)
+	{
+		char identifier[4];
+		csBusTrace_getIdentifier(identifier, index);
+		csBusTrace_writeValue(vcd, &signals[index], identifier, reader.lineValues);
+	}
+	fprintf(vcd, "%c%s\n$end\n", (clockPhase ^ (reader.halfCycle&1)) ? '1' : '0', clockIdentifier);
+
+	while(1)
+	{
+		const uint64_t lastHalfCycle = reader.halfCycle;
+		const uint64_t lastLineValues = reader.lineValues;
+		if(!csBusTrace_readRecord(&reader)) break;
+
+		for(uint64_t halfCycle = lastHalfCycle+1; halfCycle <= reader.halfCycle; halfCycle++)
+		{
+			fprintf(vcd, "#%llu\n%c%s\n",
+				(unsigned long long)csBusTrace_getTime(halfCycle, ticksPerSecond),
+				(clockPhase ^ (halfCycle&1)) ? '1' : '0',
+				clockIdentifier);
+		}
+
+		const uint64_t recordChangedLines = reader.lineValues ^ lastLineValues;
+		for(unsigned int index = 0; index < numberOfSignals; index++)
+		{
+			if(recordChangedLines & signals[index].mask)
+			{
+				char identifier[4];
+				csBusTrace_getIdentifier(identifier, index);
+				csBusTrace_writeValue(vcd, &signals[index], identifier, reader.lineValues);
+			}
+		}
+	}
+
+	return !ferror(vcd);
+}
+
+bool csBusTrace_convertToVCD(const char *tracePath, const char *vcdPath)
+{
+	const int fileDescriptor = open(tracePath, O_RDONLY);
+	if(fileDescriptor < 0) return false;
+
+	struct stat status;
+	if(fstat(fileDescriptor, &status) || status.st_size < kCSBusTraceHeaderLength)
+	{
+		close(fileDescriptor);
+		return false;
+	}
+
+	const size_t length = (size_t)status.st_size;
+	void *const mapping = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	close(fileDescriptor);
+	if(mapping == MAP_FAILED) return false;
+
+	const uint8_t *const trace = (const uint8_t *)mapping;
+	bool succeeded = false;
+	if(!memcmp(trace, "CSBT", 4) && trace[4] == kCSBusTraceVersion)
+	{
+		FILE *const vcd = fopen(vcdPath, "w");
+		if(vcd)
+		{
+			succeeded = csBusTrace_writeVCD(vcd, trace, length);
+			if(fclose(vcd)) succeeded = false;
+		}
+	}
+
+	munmap(mapping, length);
+	return succeeded;
+}
@@ -0,0 +1,21 @@
+//
+//  BusTraceConverter.h
+//  Clock Signal
+//
+//  Created by Thomas Harte on 03/12/2011.
+//  Copyright 2011 Thomas Harte. All rights reserved.
+//
+
+#ifndef ClockSignal_BusTraceConverter_h
+#define ClockSignal_BusTraceConverter_h
+
+#include "stdbool.h"
+
+// converts a trace written by a bus trace recorder into a VCD file, as
+// understood by GTKWave and most other waveform viewers. The data and address
+// lines, the clock and the Z80's signals are named; any other line is
+// included under its number if it ever changes. Z80 signals are active low,
+// as on the bus. Returns false if the trace can't be read or the VCD written
+bool csBusTrace_convertToVCD(const char *tracePath, const char *vcdPath);
+
+#endif
@@ -0,0 +1,129 @@
+//
+//  PoolAllocator.c
+//  Clock Signal
+//
+//  Created by Thomas Harte on 04/12/2011.
+//  Copyright 2011 Thomas Harte. All rights reserved.
+//
+
+#include "PoolAllocator.h"
+#include "ReferenceCountedObject.h"
+#include <stdint.h>
+#include <string.h>
+
+// the first chunk is small, as plenty of pools never get beyond a
+// handful of objects; each after that doubles, up to a limit
+#define kCSPoolAllocatorMinimumChunkLength	4
+#define kCSPoolAllocatorMaximumChunkLength	256
+
+typedef struct
+{
+	CSReferenceCountedObject referenceCountedObject;
+
+	size_t slotSize;
+	bool shouldFinaliseObjects;
+
+	// every chunk allocated so far, and how many slots
+	// of the most recent are still unused
+	uint8_t **chunks;
+	unsigned int numberOfChunks;
+	unsigned int nextChunkLength;
+	uint8_t *nextSlot;
+	unsigned int numberOfFreeSlots;
+
+	// the list of all objects, in order of allocation
+	void **objects;
+	unsigned int numberOfObjects, numberOfAllocatedObjects;
+
+} CSPoolAllocator;
+
+static void csPoolAllocator_destroy(void *opaquePool)
+{
+	CSPoolAllocator *pool = (CSPoolAllocator *)opaquePool;
+
+	if(pool->shouldFinaliseObjects)
+	{
+		for(unsigned int index = 0; index < pool->numberOfObjects; index++)
+		{
+			CSReferenceCountedObject *object = (CSReferenceCountedObject *)pool->objects[index];
+			if(object->dealloc) object->dealloc(object);
+		}
+	}
+
+	for(unsigned int index = 0; index < pool->numberOfChunks; index++)
+		free(pool->chunks[index]);
+	free(pool->chunks);
+	free(pool->objects);
+}
+
+void *csPoolAllocator_createWithObjectSize(size_t objectSize, bool shouldFinaliseObjects)
+{
+	CSPoolAllocator *pool = (CSPoolAllocator *)calloc(1, sizeof(CSPoolAllocator));
+
+	if(pool)
+	{
+		csObject_init(pool);
+		pool->referenceCountedObject.dealloc = csPoolAllocator_destroy;
+
+		// round the size up so that every slot starts on a cache line
+		pool->slotSize = (objectSize + kCSPoolAllocatorAlignment - 1) &~ (size_t)(kCSPoolAllocatorAlignment - 1);
+		if(!pool->slotSize) pool->slotSize = kCSPoolAllocatorAlignment;
+		pool->shouldFinaliseObjects = shouldFinaliseObjects;
+		pool->nextChunkLength = kCSPoolAllocatorMinimumChunkLength;
+	}
+
+	return pool;
+}
+
+static bool csPoolAllocator_addChunk(CSPoolAllocator *pool)
+{
+	uint8_t **newChunks = (uint8_t **)realloc(pool->chunks, sizeof(uint8_t *) * (pool->numberOfChunks + 1));
+	if(!newChunks) return false;
+	pool->chunks = newChunks;
+
+	void *chunk;
+	if(posix_memalign(&chunk, kCSPoolAllocatorAlignment, pool->slotSize * pool->nextChunkLength)) return false;
+	memset(chunk, 0, pool->slotSize * pool->nextChunkLength);
+
+	pool->chunks[pool->numberOfChunks++] = (uint8_t *)chunk;
+	pool->nextSlot = (uint8_t *)chunk;
+	pool->numberOfFreeSlots = pool->nextChunkLength;
+
+	if(pool->nextChunkLength < kCSPoolAllocatorMaximumChunkLength)
+		pool->nextChunkLength <<= 1;
+
+	return true;
+}
+
+void *csPoolAllocator_newObject(void *opaquePool)
+{
+	CSPoolAllocator *pool = (CSPoolAllocator *)opaquePool;
+
+	// make sure there's room in the list first, so that a failure
+	// there doesn't waste a slot
+	if(pool->numberOfObjects == pool->numberOfAllocatedObjects)
+	{
+		unsigned int newNumberOfAllocatedObjects = (pool->numberOfAllocatedObjects << 1) + kCSPoolAllocatorMinimumChunkLength;
+		void **newObjects = (void **)realloc(pool->objects, sizeof(void *) * newNumberOfAllocatedObjects);
+		if(!newObjects) return NULL;
+
+		pool->objects = newObjects;
+		pool->numberOfAllocatedObjects = newNumberOfAllocatedObjects;
+	}
+
+	if(!pool->numberOfFreeSlots && !csPoolAllocator_addChunk(pool)) return NULL;
+
+	void *newObject = pool->nextSlot;
+	pool->nextSlot += pool->slotSize;
+	pool->numberOfFreeSlots--;
+
+	pool->objects[pool->numberOfObjects++] = newObject;
+	return newObject;
+}
+
+void **csPoolAllocator_getObjects(void *opaquePool, unsigned int *numberOfObjects)
+{
+	CSPoolAllocator *const pool = (CSPoolAllocator *)opaquePool;
+	*numberOfObjects = pool->numberOfObjects;
+	return pool->objects;
+}
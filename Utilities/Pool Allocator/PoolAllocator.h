@@ -0,0 +1,36 @@
+//
+//  PoolAllocator.h
+//  Clock Signal
+//
+//  Created by Thomas Harte on 04/12/2011.
+//  Copyright 2011 Thomas Harte. All rights reserved.
+//
+
+#ifndef ClockSignal_PoolAllocator_h
+#define ClockSignal_PoolAllocator_h
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+// A pool allocator hands out zeroed blocks of a fixed size that never
+// move once allocated; it can only be added to, and everything it has
+// allocated is freed when it is released.
+//
+// Blocks are carved from chunks of increasing size and each begins on
+// a cache line boundary, so no two share a line. A list of all blocks,
+// in the order they were allocated, is kept contiguously for the
+// benefit of anything that wants to iterate over them; that list may
+// move as blocks are added but the blocks themselves won't.
+//
+// If asked to finalise its objects then the pool assumes that each
+// block begins with a CSReferenceCountedObject and calls its dealloc
+// function, if any, before freeing it.
+
+#define kCSPoolAllocatorAlignment	64
+
+void *csPoolAllocator_createWithObjectSize(size_t objectSize, bool shouldFinaliseObjects);
+
+void *csPoolAllocator_newObject(void *pool);
+void **csPoolAllocator_getObjects(void *pool, unsigned int *numberOfObjects);
+
+#endif
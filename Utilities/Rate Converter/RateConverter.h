@@ -37,6 +37,20 @@ typedef struct
 			state.accumulatedError -= state.adjustmentDown;\
 		}\
 	}
+// this is the same as performing csRateConverter_advance the given number
+// of times; the error term stays in the range (-adjustmentDown, 0] so however
+// far above zero it now is says how many extra spots we've moved
+#define csRateConverter_advanceBy(state, steps) \
+	{\
+		state.timeToNow += state.wholeStep * (uint64_t)(steps); \
+		state.accumulatedError += state.adjustmentUp * (int64_t)(steps); \
+		if(state.accumulatedError > 0) \
+		{\
+			int64_t extraSteps = (state.accumulatedError + state.adjustmentDown - 1) / state.adjustmentDown;\
+			state.timeToNow += (uint64_t)extraSteps;\
+			state.accumulatedError -= extraSteps * state.adjustmentDown;\
+		}\
+	}
 #define csRateConverter_getLocation(state) state.timeToNow
 #define csRateConverter_decreaseLocation(state, x) state.timeToNow -= x
 